@@ -0,0 +1,209 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "acceptor.hpp"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "codes.hpp"
+
+namespace sbt {
+
+const int Acceptor::DEFAULT_BACKLOG;
+const size_t Acceptor::MAX_PENDING;
+const uint64_t Acceptor::ACCEPT_BACKOFF;
+
+// what a handshake has to start with: <19>"BitTorrent protocol"
+static const char PROTOCOL[] = "\x13" "BitTorrent protocol";
+static const size_t PROTOCOL_LENGTH = 20;
+static const size_t INFOHASH_OFFSET = 28;
+static const size_t INFOHASH_END = 48;
+static const size_t HANDSHAKE_LENGTH = 68;
+
+Acceptor::Acceptor(util::EventLoop& loop, const Filter& filter, const Handler& handler,
+                   uint64_t timeoutMs)
+  : m_loop(loop)
+  , m_filter(filter)
+  , m_handler(handler)
+  , m_timeout(timeoutMs)
+  , m_sockfd(-1)
+  , m_resumeTimer(0)
+  , m_nRejected(0)
+{
+}
+
+Acceptor::~Acceptor()
+{
+  while (!m_pending.empty()) {
+    int sockfd = m_pending.begin()->first;
+    release(sockfd);
+    close(sockfd);
+  }
+
+  if (m_resumeTimer != 0)
+    m_loop.cancel(m_resumeTimer);
+  else if (m_sockfd != -1)
+    m_loop.remove(m_sockfd);
+
+  if (m_sockfd != -1)
+    close(m_sockfd);
+}
+
+int
+Acceptor::listen(const std::string& ip, const std::string& port, bool reusePort, int backlog)
+{
+  m_sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (m_sockfd == -1)
+    return RC_CLIENT_CONNECTION_FAILED;
+
+  int yes = 1;
+  if (setsockopt(m_sockfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) == -1 ||
+      (reusePort && setsockopt(m_sockfd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(int)) == -1)) {
+    fprintf(stderr, "Could not set socket options\n");
+    close(m_sockfd);
+    m_sockfd = -1;
+    return RC_CLIENT_CONNECTION_FAILED;
+  }
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(atoi(port.c_str()));
+  addr.sin_addr.s_addr = inet_addr(ip.c_str());
+
+  if (bind(m_sockfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+      ::listen(m_sockfd, backlog) == -1) {
+    fprintf(stderr, "Cannot listen on port: %s\n", port.c_str());
+    close(m_sockfd);
+    m_sockfd = -1;
+    return RC_CLIENT_CONNECTION_FAILED;
+  }
+
+  watch();
+  return 0;
+}
+
+void
+Acceptor::watch()
+{
+  m_loop.add(m_sockfd, EPOLLIN, [this] (uint32_t) { onAcceptable(); });
+}
+
+uint16_t
+Acceptor::getPort() const
+{
+  sockaddr_in addr;
+  socklen_t length = sizeof(addr);
+  if (getsockname(m_sockfd, reinterpret_cast<sockaddr*>(&addr), &length) == -1)
+    return 0;
+
+  return ntohs(addr.sin_port);
+}
+
+void
+Acceptor::onAcceptable()
+{
+  // drain the backlog
+  while (true) {
+    sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    int sockfd = accept4(m_sockfd, reinterpret_cast<sockaddr*>(&addr), &length,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (sockfd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+
+      // the listening socket is level-triggered and stays readable, so rather than
+      // spin until a descriptor is freed, stop watching it for a while
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+        fprintf(stderr, "Cannot accept peers: %s\n", strerror(errno));
+        m_loop.remove(m_sockfd);
+        m_resumeTimer = m_loop.schedule(ACCEPT_BACKOFF, [this] {
+          m_resumeTimer = 0;
+          watch();
+        });
+      }
+      return;
+    }
+
+    if (m_pending.size() >= MAX_PENDING) {
+      m_nRejected++;
+      close(sockfd);
+      continue;
+    }
+
+    Pending& pending = m_pending[sockfd];
+    pending.addr = addr;
+    pending.received = 0;
+    pending.timer = m_loop.schedule(m_timeout, [this, sockfd] { reject(sockfd); });
+
+    m_loop.add(sockfd, EPOLLIN, [this, sockfd] (uint32_t) { onReadable(sockfd); });
+  }
+}
+
+void
+Acceptor::onReadable(int sockfd)
+{
+  Pending& pending = m_pending[sockfd];
+  size_t before = pending.received;
+
+  ssize_t n = recv(sockfd, pending.handshake + before, HANDSHAKE_LENGTH - before, 0);
+  if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return;
+  if (n <= 0) {
+    reject(sockfd);
+    return;
+  }
+  pending.received += n;
+
+  if (before < PROTOCOL_LENGTH && pending.received >= PROTOCOL_LENGTH &&
+      memcmp(pending.handshake, PROTOCOL, PROTOCOL_LENGTH) != 0) {
+    reject(sockfd);
+    return;
+  }
+
+  if (before < INFOHASH_END && pending.received >= INFOHASH_END &&
+      !m_filter(pending.handshake + INFOHASH_OFFSET)) {
+    reject(sockfd);
+    return;
+  }
+
+  if (pending.received < HANDSHAKE_LENGTH)
+    return;
+
+  msg::HandShake handshake;
+  handshake.decode(std::make_shared<Buffer>(pending.handshake, HANDSHAKE_LENGTH));
+  sockaddr_in addr = pending.addr;
+
+  release(sockfd);
+  m_handler(sockfd, addr, handshake);
+}
+
+void
+Acceptor::release(int sockfd)
+{
+  auto it = m_pending.find(sockfd);
+  m_loop.cancel(it->second.timer);
+  m_loop.remove(sockfd);
+  m_pending.erase(it);
+}
+
+void
+Acceptor::reject(int sockfd)
+{
+  release(sockfd);
+  close(sockfd);
+  m_nRejected++;
+}
+
+} // namespace sbt
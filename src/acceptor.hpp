@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_ACCEPTOR_HPP
+#define SBT_ACCEPTOR_HPP
+
+#include "msg/handshake.hpp"
+#include "util/event-loop.hpp"
+
+#include <netinet/in.h>
+
+#include <unordered_map>
+
+namespace sbt {
+
+/**
+ * @brief Accepts inbound peer connections and reads their handshakes
+ *
+ * Connections are accepted non-blocking and read on the event loop until the 68-byte
+ * handshake is complete, then handed to the handler, which owns the socket from then
+ * on.  A connection is closed as soon as it is known to be unwanted: a wrong protocol
+ * string after 20 bytes, an info hash the filter rejects after 48, or no complete
+ * handshake within the timeout.
+ */
+class Acceptor
+{
+public:
+  /**
+   * @returns whether the 20-byte @p infoHash is served here
+   */
+  typedef function<bool(const uint8_t* infoHash)> Filter;
+
+  typedef function<void(int sockfd, const sockaddr_in& addr,
+                        msg::HandShake& handshake)> Handler;
+
+  static const int DEFAULT_BACKLOG = 1024;
+
+  // connections allowed to be mid-handshake at once; more are closed right away
+  static const size_t MAX_PENDING = 256;
+
+  // how long to stop accepting when out of file descriptors (ms)
+  static const uint64_t ACCEPT_BACKOFF = 1000;
+
+public:
+  Acceptor(util::EventLoop& loop, const Filter& filter, const Handler& handler,
+           uint64_t timeoutMs = 10000);
+
+  ~Acceptor();
+
+  /**
+   * @brief Bind to @p ip and @p port (0 for any) and start accepting
+   * @param reusePort  share the port with other acceptors through SO_REUSEPORT
+   * @returns 0 or RC_CLIENT_CONNECTION_FAILED
+   */
+  int
+  listen(const std::string& ip, const std::string& port, bool reusePort = false,
+         int backlog = DEFAULT_BACKLOG);
+
+  /**
+   * @brief Port actually bound, in host order
+   */
+  uint16_t
+  getPort() const;
+
+  size_t
+  getPendingCount() const
+  {
+    return m_pending.size();
+  }
+
+  size_t
+  getRejectedCount() const
+  {
+    return m_nRejected;
+  }
+
+private:
+  struct Pending
+  {
+    sockaddr_in addr;
+    uint8_t handshake[68];
+    size_t received;
+    util::TimerWheel::TimerId timer;
+  };
+
+  void
+  onAcceptable();
+
+  /**
+   * @brief Start watching the listening socket
+   */
+  void
+  watch();
+
+  void
+  onReadable(int sockfd);
+
+  /**
+   * @brief Stop watching @p sockfd and forget it, leaving it open
+   */
+  void
+  release(int sockfd);
+
+  void
+  reject(int sockfd);
+
+private:
+  util::EventLoop& m_loop;
+  Filter m_filter;
+  Handler m_handler;
+  uint64_t m_timeout;
+
+  int m_sockfd;
+  // set while accepting is backed off
+  util::TimerWheel::TimerId m_resumeTimer;
+  std::unordered_map<int, Pending> m_pending;
+  size_t m_nRejected;
+};
+
+} // namespace sbt
+
+#endif // SBT_ACCEPTOR_HPP
@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "announce-builder.hpp"
+
+#include "http/url-encoding.hpp"
+
+namespace sbt {
+
+// longest counter and event parts of a request
+static const size_t MAX_COUNTERS_LENGTH = sizeof("&uploaded=&downloaded=&left=&compact=1") + 3 * 20 +
+                                          sizeof("&event=completed");
+
+/**
+ * Append the decimal digits of @p value to @p out
+ */
+static void
+appendNumber(std::string& out, uint64_t value)
+{
+  char digits[20];
+  char* p = digits + sizeof(digits);
+  do {
+    *--p = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  out.append(p, digits + sizeof(digits) - p);
+}
+
+AnnounceBuilder::AnnounceBuilder(const std::string& host, const std::string& port,
+                                 const std::string& path)
+  : m_path(path)
+  , m_port(0)
+  , m_nEncodes(0)
+{
+  m_headers = " HTTP/1.1\r\n"
+              "Host: " + host + ":" + port + "\r\n"
+              "Connection: keep-alive\r\n"
+              "Accept-Language: en-US\r\n"
+              "\r\n";
+}
+
+const std::string&
+AnnounceBuilder::build(const AnnounceRequest& request)
+{
+  // by value: the same hash may come in a new buffer every time
+  if (!m_infoHash || *request.infoHash != *m_infoHash || request.peerId != m_peerId ||
+      request.port != m_port)
+    encodeStatic(request);
+
+  m_request.assign(m_static);
+  m_request.append("&uploaded=");
+  appendNumber(m_request, request.uploaded);
+  m_request.append("&downloaded=");
+  appendNumber(m_request, request.downloaded);
+  m_request.append("&left=");
+  appendNumber(m_request, request.left);
+  m_request.append("&compact=1");
+
+  switch (request.event) {
+  case AnnounceRequest::EVENT_STARTED:
+    m_request.append("&event=started");
+    break;
+  case AnnounceRequest::EVENT_COMPLETED:
+    m_request.append("&event=completed");
+    break;
+  case AnnounceRequest::EVENT_STOPPED:
+    m_request.append("&event=stopped");
+    break;
+  case AnnounceRequest::EVENT_NONE:
+    break;
+  }
+
+  m_request.append(m_headers);
+  return m_request;
+}
+
+void
+AnnounceBuilder::encodeStatic(const AnnounceRequest& request)
+{
+  m_infoHash = request.infoHash;
+  m_peerId = request.peerId;
+  m_port = request.port;
+  m_nEncodes++;
+
+  m_static = "GET /" + m_path;
+  m_static += "?info_hash=";
+  m_static += url::encode(m_infoHash->buf(), m_infoHash->size());
+  m_static += "&peer_id=";
+  m_static += url::encode(reinterpret_cast<const uint8_t*>(m_peerId.data()), m_peerId.size());
+  m_static += "&port=";
+  appendNumber(m_static, m_port);
+
+  m_request.reserve(m_static.size() + MAX_COUNTERS_LENGTH + m_headers.size());
+}
+
+} // namespace sbt
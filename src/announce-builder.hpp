@@ -0,0 +1,66 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_ANNOUNCE_BUILDER_HPP
+#define SBT_ANNOUNCE_BUILDER_HPP
+
+#include "announce-request.hpp"
+
+namespace sbt {
+
+/**
+ * @brief Formats the HTTP GET of announces to one tracker
+ *
+ * The request line up to the counters (path, info_hash, peer_id and port) and the
+ * headers are encoded once; each build only appends the counters and the event into
+ * a buffer that keeps its capacity, so announces after the first do not allocate.
+ */
+class AnnounceBuilder
+{
+public:
+  /**
+   * @param path announce path without the leading '/'
+   */
+  AnnounceBuilder(const std::string& host, const std::string& port, const std::string& path);
+
+  /**
+   * @brief Format @p request
+   * @returns the complete request, valid until the next call
+   */
+  const std::string&
+  build(const AnnounceRequest& request);
+
+  /**
+   * @brief Number of times the static part was encoded
+   */
+  size_t
+  getEncodeCount() const
+  {
+    return m_nEncodes;
+  }
+
+private:
+  void
+  encodeStatic(const AnnounceRequest& request);
+
+private:
+  std::string m_path;
+  std::string m_headers;   // " HTTP/1.1\r\n" up to the empty line
+
+  // what the static part was encoded from
+  ConstBufferPtr m_infoHash;
+  std::string m_peerId;
+  uint16_t m_port;
+
+  std::string m_static;    // "GET /<path>?info_hash=...&peer_id=...&port=<port>"
+  std::string m_request;
+  size_t m_nEncodes;
+};
+
+} // namespace sbt
+
+#endif // SBT_ANNOUNCE_BUILDER_HPP
@@ -0,0 +1,40 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_ANNOUNCE_REQUEST_HPP
+#define SBT_ANNOUNCE_REQUEST_HPP
+
+#include "common.hpp"
+#include "util/buffer.hpp"
+
+namespace sbt {
+
+/**
+ * @brief What we tell a tracker in an announce, whatever protocol carries it
+ */
+struct AnnounceRequest
+{
+  // numbered as on the wire of the UDP tracker protocol (BEP 15)
+  enum Event {
+    EVENT_NONE = 0,
+    EVENT_COMPLETED = 1,
+    EVENT_STARTED = 2,
+    EVENT_STOPPED = 3
+  };
+
+  ConstBufferPtr infoHash; // 20 bytes
+  std::string peerId;      // 20 bytes
+  uint16_t port;
+  uint64_t uploaded;
+  uint64_t downloaded;
+  uint64_t left;
+  Event event;
+};
+
+} // namespace sbt
+
+#endif // SBT_ANNOUNCE_REQUEST_HPP
@@ -23,5 +23,7 @@ const int RC_GET_ADDRESS_INFO_FAILED      = -1007;
 const int RC_FILE_ALLOCATE_FAILED         = -1008;
 const int RC_FILE_OPEN_FAILED             = -1009;
 const int RC_PIECE_NOT_VALID              = -1010;
+const int RC_PEER_TIMEOUT                 = -1011;
+const int RC_MALFORMED_MESSAGE            = -1012;
 
 #endif // CODES_HPP
@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "http-header-index.hpp"
+
+#include <string.h>
+
+namespace sbt {
+
+const size_t HttpHeaderIndex::MAX_FIELDS;
+const size_t HttpHeaderIndex::N_SLOTS;
+
+static inline char
+toLower(char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline bool
+isSpace(char c)
+{
+  return c == ' ' || c == '\t';
+}
+
+HttpHeaderIndex::HttpHeaderIndex()
+{
+  clear();
+}
+
+void
+HttpHeaderIndex::clear()
+{
+  memset(m_slots, 0, sizeof(m_slots));
+  m_nFields = 0;
+}
+
+const char*
+HttpHeaderIndex::parse(const char* buffer, size_t size)
+{
+  const char* pos = buffer;
+  const char* end = buffer + size;
+  Field* last = nullptr;
+
+  while (true) {
+    const char* endline = static_cast<const char*>(memmem(pos, end - pos, "\r\n", 2));
+    if (endline == nullptr)
+      throw ParseError("Parsed buffer does not contain \\r\\n");
+
+    if (endline == pos)
+      return endline + 2;
+
+    const char* valueEnd = endline;
+    while (valueEnd != pos && isSpace(valueEnd[-1]))
+      valueEnd--;
+
+    if (isSpace(*pos)) { // multi-line header, the value runs on over the line break
+      if (last == nullptr)
+        throw ParseError("Multi-line header without actual header");
+
+      if (valueEnd != pos)
+        last->value = View(last->value.data(), valueEnd - last->value.data());
+    }
+    else {
+      const char* colon = static_cast<const char*>(memchr(pos, ':', endline - pos));
+      if (colon == nullptr)
+        throw ParseError("HTTP header doesn't contain ':'");
+
+      View key(pos, colon - pos);
+      const char* value = colon + 1;
+      while (value < valueEnd && isSpace(*value))
+        value++;
+
+      size_t slot = lookup(key);
+      if (m_slots[slot] != 0) {
+        last = &m_fields[m_slots[slot] - 1];
+      }
+      else {
+        if (m_nFields == MAX_FIELDS)
+          throw ParseError("Too many HTTP headers");
+
+        last = &m_fields[m_nFields++];
+        last->key = key;
+        m_slots[slot] = m_nFields;
+      }
+      last->value = View(value, valueEnd - value);
+    }
+
+    pos = endline + 2;
+  }
+}
+
+HttpHeaderIndex::View
+HttpHeaderIndex::find(View key) const
+{
+  uint8_t slot = m_slots[lookup(key)];
+  return slot != 0 ? m_fields[slot - 1].value : View();
+}
+
+bool
+HttpHeaderIndex::equalsIgnoreCase(View a, View b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (size_t i = 0; i < a.size(); i++) {
+    if (toLower(a[i]) != toLower(b[i]))
+      return false;
+  }
+  return true;
+}
+
+size_t
+HttpHeaderIndex::lookup(View key) const
+{
+  // FNV-1a over the lowercased key
+  uint32_t hash = 2166136261u;
+  for (char c : key)
+    hash = (hash ^ static_cast<uint8_t>(toLower(c))) * 16777619u;
+
+  // linear probing; the table is never more than half full, so a free slot is found
+  size_t slot = hash & (N_SLOTS - 1);
+  while (m_slots[slot] != 0 && !equalsIgnoreCase(m_fields[m_slots[slot] - 1].key, key))
+    slot = (slot + 1) & (N_SLOTS - 1);
+
+  return slot;
+}
+
+} // namespace sbt
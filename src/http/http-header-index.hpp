@@ -0,0 +1,104 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_HTTP_HEADER_INDEX_HPP
+#define SBT_HTTP_HEADER_INDEX_HPP
+
+#include "http-headers.hpp"
+
+#include <boost/utility/string_ref.hpp>
+
+namespace sbt {
+
+/**
+ * @brief Received HTTP headers, looked up without copying them
+ *
+ * Keys and values are views into the parsed buffer, which must outlive the index.
+ * Lookups are case-insensitive and go through a small open-addressed hash table, so
+ * neither parsing nor finding a header allocates.
+ */
+class HttpHeaderIndex
+{
+public:
+  typedef boost::string_ref View;
+
+  static const size_t MAX_FIELDS = 64;
+
+  HttpHeaderIndex();
+
+  /**
+   * @brief Index the header lines at @p buffer, up to and including the empty line
+   *
+   * A repeated header replaces the earlier value, as HttpHeaders::parseHeaders does.
+   * @returns one past the empty line
+   * @throws ParseError if the headers are malformed or there are more than MAX_FIELDS
+   */
+  const char*
+  parse(const char* buffer, size_t size);
+
+  void
+  clear();
+
+  /**
+   * @brief Value of header @p key, with surrounding whitespace removed
+   * @returns an empty view if there is no such header
+   */
+  View
+  find(View key) const;
+
+  bool
+  has(View key) const
+  {
+    return m_slots[lookup(key)] != 0;
+  }
+
+  size_t
+  size() const
+  {
+    return m_nFields;
+  }
+
+  View
+  getKey(size_t index) const
+  {
+    return m_fields[index].key;
+  }
+
+  View
+  getValue(size_t index) const
+  {
+    return m_fields[index].value;
+  }
+
+  static bool
+  equalsIgnoreCase(View a, View b);
+
+private:
+  /**
+   * @brief Slot holding @p key, or the free slot where it would go
+   */
+  size_t
+  lookup(View key) const;
+
+private:
+  struct Field
+  {
+    View key;
+    View value;
+  };
+
+  // a power of two, twice MAX_FIELDS so that probe sequences stay short
+  static const size_t N_SLOTS = 128;
+
+  Field m_fields[MAX_FIELDS];
+  uint8_t m_slots[N_SLOTS];  // 1 + index into m_fields, 0 if free
+  size_t m_nFields;
+};
+
+} // namespace sbt
+
+#endif // SBT_HTTP_HEADER_INDEX_HPP
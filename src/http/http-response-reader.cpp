@@ -0,0 +1,251 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "http-response-reader.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+namespace sbt {
+
+static const size_t MAX_HEADER_LENGTH = 65536;
+static const size_t MAX_LINE_LENGTH = 1024;
+// far more than any tracker response; the body is only stored as it arrives
+static const size_t MAX_BODY_LENGTH = 4 * 1024 * 1024;
+
+HttpResponseReader::HttpResponseReader()
+{
+  reset();
+}
+
+void
+HttpResponseReader::reset()
+{
+  m_state = STATE_HEADERS;
+  m_header.clear();
+  m_version = HttpHeaderIndex::View();
+  m_statusCode = HttpHeaderIndex::View();
+  m_headers.clear();
+  m_line.clear();
+  m_body.clear();
+  m_remaining = 0;
+  m_isUntilClose = false;
+  m_isKeepAlive = false;
+}
+
+size_t
+HttpResponseReader::feed(const char* data, size_t size)
+{
+  const char* pos = data;
+  const char* end = data + size;
+
+  while (pos != end && m_state != STATE_DONE) {
+    switch (m_state) {
+    case STATE_HEADERS: {
+      size_t oldLength = m_header.size();
+      m_header.append(pos, end);
+
+      // the terminator may straddle two reads
+      size_t found = m_header.find("\r\n\r\n", oldLength >= 3 ? oldLength - 3 : 0);
+      if (found == std::string::npos) {
+        if (m_header.size() > MAX_HEADER_LENGTH)
+          throw ParseError("HTTP headers are too long");
+        pos = end;
+        break;
+      }
+
+      size_t headerLength = found + 4;
+      pos += headerLength - oldLength;
+      m_header.resize(headerLength);
+      onHeaders();
+      break;
+    }
+
+    case STATE_BODY: {
+      size_t n = end - pos;
+      if (!m_isUntilClose)
+        n = std::min(n, m_remaining);
+      else if (m_body.size() + n > MAX_BODY_LENGTH)
+        throw ParseError("HTTP body is too long");
+
+      m_body.insert(m_body.end(), pos, pos + n);
+      pos += n;
+
+      if (!m_isUntilClose) {
+        m_remaining -= n;
+        if (m_remaining == 0)
+          m_state = STATE_DONE;
+      }
+      break;
+    }
+
+    case STATE_CHUNK_SIZE: {
+      if (!readLine(pos, end))
+        break;
+
+      HttpHeaderIndex::View size(m_line);
+      size = size.substr(0, size.find(';')); // drop chunk extensions
+      while (!size.empty() && (size.front() == ' ' || size.front() == '\t'))
+        size.remove_prefix(1);
+      while (!size.empty() && (size.back() == ' ' || size.back() == '\t'))
+        size.remove_suffix(1);
+      if (size.empty() || size.size() > 15 ||
+          size.find_first_not_of("0123456789abcdefABCDEF") != HttpHeaderIndex::View::npos)
+        throw ParseError("Bad chunk size");
+
+      m_remaining = strtoull(size.data(), nullptr, 16);
+      m_line.clear();
+
+      if (m_remaining > MAX_BODY_LENGTH - m_body.size())
+        throw ParseError("HTTP body is too long");
+
+      m_state = m_remaining == 0 ? STATE_TRAILERS : STATE_CHUNK_DATA;
+      break;
+    }
+
+    case STATE_CHUNK_DATA: {
+      size_t n = std::min(static_cast<size_t>(end - pos), m_remaining);
+      m_body.insert(m_body.end(), pos, pos + n);
+      pos += n;
+      m_remaining -= n;
+
+      if (m_remaining == 0) {
+        m_remaining = 2;
+        m_state = STATE_CHUNK_CRLF;
+      }
+      break;
+    }
+
+    case STATE_CHUNK_CRLF: {
+      if (*pos != (m_remaining == 2 ? '\r' : '\n'))
+        throw ParseError("Chunk data does not end with \\r\\n");
+
+      pos++;
+      if (--m_remaining == 0)
+        m_state = STATE_CHUNK_SIZE;
+      break;
+    }
+
+    case STATE_TRAILERS: {
+      if (!readLine(pos, end))
+        break;
+
+      if (m_line.empty())
+        m_state = STATE_DONE;
+      m_line.clear();
+      break;
+    }
+
+    case STATE_DONE:
+      break;
+    }
+  }
+
+  return pos - data;
+}
+
+void
+HttpResponseReader::finish()
+{
+  if (m_state == STATE_BODY && m_isUntilClose)
+    m_state = STATE_DONE;
+
+  if (m_state != STATE_DONE)
+    throw ParseError("Connection closed before the response was complete");
+}
+
+void
+HttpResponseReader::onHeaders()
+{
+  const char* headers = parseStatusLine();
+  m_headers.parse(headers, m_header.data() + m_header.size() - headers);
+
+  HttpHeaderIndex::View connection = m_headers.find("Connection");
+  m_isKeepAlive = (m_version == "1.1" && !HttpHeaderIndex::equalsIgnoreCase(connection, "close")) ||
+                  (m_version == "1.0" && HttpHeaderIndex::equalsIgnoreCase(connection, "keep-alive"));
+
+  if (m_statusCode == "204" || m_statusCode == "304" || m_statusCode[0] == '1') {
+    m_state = STATE_DONE;
+    return;
+  }
+
+  // chunked is always the last transfer coding applied
+  HttpHeaderIndex::View encoding = m_headers.find("Transfer-Encoding");
+  if (encoding.size() >= 7 &&
+      HttpHeaderIndex::equalsIgnoreCase(encoding.substr(encoding.size() - 7), "chunked")) {
+    m_state = STATE_CHUNK_SIZE;
+    return;
+  }
+
+  HttpHeaderIndex::View length = m_headers.find("Content-Length");
+  if (!length.empty()) {
+    if (length.size() > 18 || length.find_first_not_of("0123456789") != HttpHeaderIndex::View::npos)
+      throw ParseError("Bad Content-Length");
+
+    m_remaining = 0;
+    for (char digit : length)
+      m_remaining = m_remaining * 10 + (digit - '0');
+
+    if (m_remaining > MAX_BODY_LENGTH)
+      throw ParseError("HTTP body is too long");
+
+    m_state = m_remaining > 0 ? STATE_BODY : STATE_DONE;
+    return;
+  }
+
+  // the body runs until the server closes the connection
+  m_isUntilClose = true;
+  m_isKeepAlive = false;
+  m_state = STATE_BODY;
+}
+
+const char*
+HttpResponseReader::parseStatusLine()
+{
+  const char* line = m_header.data();
+  const char* endline = static_cast<const char*>(memmem(line, m_header.size(), "\r\n", 2));
+
+  HttpHeaderIndex::View status(line, endline - line);
+  if (!status.starts_with("HTTP/"))
+    throw ParseError("Incorrectly formatted HTTP response");
+
+  size_t space = status.find(' ');
+  if (space == HttpHeaderIndex::View::npos)
+    throw ParseError("Incorrectly formatted response");
+  m_version = status.substr(5, space - 5);
+
+  status.remove_prefix(space + 1);
+  space = status.find(' ');
+  if (space == HttpHeaderIndex::View::npos || space == 0)
+    throw ParseError("Incorrectly formatted response");
+  m_statusCode = status.substr(0, space);
+
+  return endline + 2;
+}
+
+bool
+HttpResponseReader::readLine(const char*& pos, const char* end)
+{
+  const char* newline = std::find(pos, end, '\n');
+  m_line.append(pos, newline);
+
+  if (m_line.size() > MAX_LINE_LENGTH)
+    throw ParseError("HTTP line is too long");
+
+  if (newline == end) {
+    pos = end;
+    return false;
+  }
+
+  pos = newline + 1;
+  if (!m_line.empty() && m_line[m_line.size() - 1] == '\r')
+    m_line.resize(m_line.size() - 1);
+
+  return true;
+}
+
+} // namespace sbt
@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_HTTP_RESPONSE_READER_HPP
+#define SBT_HTTP_RESPONSE_READER_HPP
+
+#include "http-header-index.hpp"
+#include "../util/buffer.hpp"
+
+namespace sbt {
+
+/**
+ * @brief Incremental HTTP/1.1 response parser
+ *
+ * Bytes are fed as they arrive from the socket.  The status line and headers are
+ * indexed in place once complete, without copying them; the body is then collected
+ * according to Content-Length, Transfer-Encoding: chunked, or until the connection
+ * closes.  The body is kept as raw bytes, so binary content (e.g., compact peer lists)
+ * survives intact.
+ *
+ * Example:
+ * HttpResponseReader reader;
+ * while (!reader.isComplete()) {
+ *   n = recv(fd, buf, sizeof(buf), 0);
+ *   if (n == 0) { reader.finish(); break; }
+ *   reader.feed(buf, n);
+ * }
+ */
+class HttpResponseReader
+{
+public:
+  HttpResponseReader();
+
+  /**
+   * @brief Forget the current response and get ready for the next one
+   */
+  void
+  reset();
+
+  /**
+   * @brief Consume bytes of the response
+   *
+   * @returns number of bytes consumed; anything after the end of the response is
+   *          left to the caller (it belongs to the next response)
+   * @throws ParseError if the response is malformed, or its body is over 4 MiB
+   */
+  size_t
+  feed(const char* data, size_t size);
+
+  /**
+   * @brief Signal that the connection was closed
+   *
+   * Completes a response whose body is delimited by the end of the connection.
+   * @throws ParseError if the response was cut short
+   */
+  void
+  finish();
+
+  bool
+  isComplete() const
+  {
+    return m_state == STATE_DONE;
+  }
+
+  /**
+   * @brief Whether the connection can carry another request after this response
+   */
+  bool
+  isKeepAlive() const
+  {
+    return m_isKeepAlive;
+  }
+
+  /**
+   * @brief HTTP version of the response (e.g., "1.1"), empty until the headers are in
+   */
+  HttpHeaderIndex::View
+  getVersion() const
+  {
+    return m_version;
+  }
+
+  /**
+   * @brief Status code of the response (e.g., "200"), empty until the headers are in
+   */
+  HttpHeaderIndex::View
+  getStatusCode() const
+  {
+    return m_statusCode;
+  }
+
+  /**
+   * @brief Headers of the response, valid until reset()
+   */
+  const HttpHeaderIndex&
+  getHeaders() const
+  {
+    return m_headers;
+  }
+
+  /**
+   * @brief Body of the response, with any chunked framing removed
+   */
+  const Buffer&
+  getBody() const
+  {
+    return m_body;
+  }
+
+private:
+  enum State {
+    STATE_HEADERS,
+    STATE_BODY,        // Content-Length or close-delimited
+    STATE_CHUNK_SIZE,
+    STATE_CHUNK_DATA,
+    STATE_CHUNK_CRLF,
+    STATE_TRAILERS,
+    STATE_DONE
+  };
+
+  void
+  onHeaders();
+
+  /**
+   * @brief Parse "HTTP/<version> <code> <message>\r\n" at the start of m_header
+   * @returns one past the status line
+   */
+  const char*
+  parseStatusLine();
+
+  /**
+   * @brief Accumulate a CRLF-terminated line into m_line
+   * @returns true once the line is complete (without CRLF)
+   */
+  bool
+  readLine(const char*& pos, const char* end);
+
+private:
+  State m_state;
+  std::string m_header; // status line and headers, which the views below point into
+  HttpHeaderIndex::View m_version;
+  HttpHeaderIndex::View m_statusCode;
+  HttpHeaderIndex m_headers;
+  std::string m_line;
+  Buffer m_body;
+  size_t m_remaining;   // bytes left of the body or the current chunk
+  bool m_isUntilClose;
+  bool m_isKeepAlive;
+};
+
+} // namespace sbt
+
+#endif // SBT_HTTP_RESPONSE_READER_HPP
@@ -20,8 +20,10 @@
  */
 
 #include "url-encoding.hpp"
-#include "../util/buffer-stream.hpp"
-#include <sstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace sbt {
 namespace url {
@@ -54,48 +56,140 @@ const uint8_t DEC[] = {
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10 - 0x1F
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20 - 0x2F
   0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 0, 0, 0, 0, 0, // 0x30 - 0x3F
-  0, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0  // 0x40 - 0x4F
+  0, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x40 - 0x4F
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x50 - 0x5F
+  0, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x60 - 0x6F
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x70 - 0x7F
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x80 - 0x8F
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x90 - 0x9F
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xA0 - 0xAF
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xB0 - 0xBF
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xC0 - 0xCF
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xD0 - 0xDF
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xE0 - 0xEF
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0  // 0xF0 - 0xFF
 };
 
-std::string
-encode(const uint8_t* buf, size_t size)
+#ifdef __SSE2__
+/**
+ * 0xFF in every lane of @p x holding a byte NO_ESCAPE lets through, 0x00 elsewhere
+ */
+static inline __m128i
+noEscape(__m128i x)
+{
+  // bytes from 0x80 up are negative, so none of the signed ranges below match them
+  __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+  __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('0' - 1)),
+                                _mm_cmplt_epi8(x, _mm_set1_epi8('9' + 1)));
+  __m128i mark = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('-')),
+                                           _mm_cmpeq_epi8(x, _mm_set1_epi8('.'))),
+                              _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('_')),
+                                           _mm_cmpeq_epi8(x, _mm_set1_epi8('~'))));
+  return _mm_or_si128(_mm_or_si128(alpha, digit), mark);
+}
+#endif // __SSE2__
+
+char*
+encodeTo(const uint8_t* buf, size_t size, char* output)
 {
-  std::stringstream ss;
+  const uint8_t* end = buf + size;
 
-  for (size_t i = 0; i < size; i++) {
-    if (NO_ESCAPE[buf[i]])
-      ss << buf[i];
-    else
-      ss << '%' << HEX[buf[i] >> 4] << HEX[buf[i] & 0x0F];
+  while (buf != end) {
+#ifdef __SSE2__
+    // copy runs of unescaped bytes 16 at a time; the output has room for 3 * 16 bytes
+    // whenever 16 input bytes are left, so the full store never overruns it
+    while (end - buf >= 16) {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output), x);
+
+      unsigned int mask = _mm_movemask_epi8(noEscape(x));
+      if (mask == 0xFFFF) {
+        buf += 16;
+        output += 16;
+        continue;
+      }
+
+      unsigned int run = __builtin_ctz(~mask);
+      buf += run;
+      output += run;
+      break;
+    }
+    if (buf == end)
+      break;
+#endif // __SSE2__
+
+    uint8_t c = *buf++;
+    if (NO_ESCAPE[c]) {
+      *output++ = c;
+    }
+    else {
+      output[0] = '%';
+      output[1] = HEX[c >> 4];
+      output[2] = HEX[c & 0x0F];
+      output += 3;
+    }
   }
 
-  return ss.str();
+  return output;
 }
 
-ConstBufferPtr
-decode(const std::string& input)
+uint8_t*
+decodeTo(const char* input, size_t size, uint8_t* output)
 {
-  OBufferStream os;
-
-  auto it = input.begin();
-  while (it != input.end()) {
-    if (*it == '%') {
-      uint8_t c = 0;
-      it++;
-      c |= (DEC[(size_t)*it] << 4);
-      it++;
-      c |= DEC[(size_t)*it];
-
-      os.put(c);
+  const char* end = input + size;
+
+  while (input != end) {
+#ifdef __SSE2__
+    // copy everything up to the next '%' 16 bytes at a time; the output never gets
+    // ahead of the input, so the full store stays within its @p size bytes
+    while (end - input >= 16) {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output), x);
+
+      unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('%')));
+      if (mask == 0) {
+        input += 16;
+        output += 16;
+        continue;
+      }
+
+      unsigned int run = __builtin_ctz(mask);
+      input += run;
+      output += run;
+      break;
+    }
+    if (input == end)
+      break;
+#endif // __SSE2__
+
+    if (*input == '%' && end - input >= 3) {
+      *output++ = (DEC[static_cast<uint8_t>(input[1])] << 4) | DEC[static_cast<uint8_t>(input[2])];
+      input += 3;
     }
     else {
-      os.put(*it);
+      *output++ = *input++;
     }
-
-    it++;
   }
 
-  return os.buf();
+  return output;
+}
+
+std::string
+encode(const uint8_t* buf, size_t size)
+{
+  std::string output(3 * size, '\0');
+  output.resize(encodeTo(buf, size, &output[0]) - output.data());
+  return output;
+}
+
+ConstBufferPtr
+decode(const std::string& input)
+{
+  auto output = make_shared<Buffer>(input.size());
+  output->resize(decodeTo(input.data(), input.size(), output->buf()) - output->buf());
+  return output;
 }
 
 } // namespace url
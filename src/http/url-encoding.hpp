@@ -35,6 +35,25 @@ encode(const uint8_t* buf, size_t size);
 ConstBufferPtr
 decode(const std::string& input);
 
+/**
+ * @brief Percent-encode @p size bytes of @p buf into @p output
+ *
+ * @p output must have room for 3 * @p size chars.
+ * @returns one past the last char written
+ */
+char*
+encodeTo(const uint8_t* buf, size_t size, char* output);
+
+/**
+ * @brief Percent-decode @p size chars of @p input into @p output
+ *
+ * @p output must have room for @p size bytes.  A '%' not followed by two more
+ * chars is kept as is.
+ * @returns one past the last byte written
+ */
+uint8_t*
+decodeTo(const char* input, size_t size, uint8_t* output);
+
 } // namespace url
 } // namespace sbt
 
@@ -21,7 +21,7 @@
 
 #include <time.h>
 
-#include "client.hpp"
+#include "session.hpp"
 
 int
 main(int argc, char** argv)
@@ -32,14 +32,22 @@ main(int argc, char** argv)
   try
   {
     // Check command line arguments.
-    if (argc != 3)
+    if (argc < 3)
     {
-      std::cerr << "Usage: simple-bt <port> <torrent_file>\n";
+      std::cerr << "Usage: simple-bt <port> <torrent_file> [<torrent_file>...]\n";
       return 1;
     }
 
-    // Initialise the client.
-    sbt::Client client(argv[1], argv[2]);
+    // Initialise the session, with one reactor per core, and every torrent it runs.
+    sbt::Session session(argv[1], 0, std::thread::hardware_concurrency());
+    session.listen();
+    for (int i = 2; i < argc; i++)
+    {
+      if (session.addTorrent(argv[i]) == nullptr)
+        std::cerr << "Skipping duplicate torrent: " << argv[i] << "\n";
+    }
+
+    session.run();
   }
   catch (std::exception& e)
   {
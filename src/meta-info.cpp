@@ -30,6 +30,7 @@ using std::dynamic_pointer_cast;
 namespace sbt {
 
 const std::string MetaInfo::ANNOUNCE("announce");
+const std::string MetaInfo::ANNOUNCE_LIST("announce-list");
 const std::string MetaInfo::INFO("info");
 const std::string MetaInfo::NAME("name");
 const std::string MetaInfo::PIECE_LENGTH("piece length");
@@ -122,6 +123,49 @@ MetaInfo::getAnnounce()
     return string();
 }
 
+void
+MetaInfo::setAnnounceList(const std::vector<std::vector<std::string>>& tiers)
+{
+  auto list = make_shared<bencoding::List>();
+
+  for (const auto& tier : tiers) {
+    auto t = make_shared<bencoding::List>();
+    for (const auto& url : tier)
+      t->append(make_shared<bencoding::String>(url));
+    list->append(t);
+  }
+
+  m_root.insert(ANNOUNCE_LIST, list);
+}
+
+std::vector<std::vector<std::string>>
+MetaInfo::getAnnounceList()
+{
+  std::vector<std::vector<std::string>> result;
+  auto i = m_root.get(ANNOUNCE_LIST);
+
+  if (static_cast<bool>(i) && i->getType() == bencoding::TYPE_LIST) {
+    for (const auto& t : *dynamic_pointer_cast<bencoding::List>(i)) {
+      if (t->getType() != bencoding::TYPE_LIST)
+        continue;
+
+      std::vector<std::string> tier;
+      for (const auto& url : *dynamic_pointer_cast<bencoding::List>(t)) {
+        if (url->getType() == bencoding::TYPE_STRING)
+          tier.push_back(dynamic_pointer_cast<bencoding::String>(url)->toString());
+      }
+
+      if (!tier.empty())
+        result.push_back(tier);
+    }
+  }
+
+  if (result.empty() && !getAnnounce().empty())
+    result.push_back(std::vector<std::string>(1, getAnnounce()));
+
+  return result;
+}
+
 void
 MetaInfo::setName(const std::string& name)
 {
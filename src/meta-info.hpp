@@ -68,6 +68,17 @@ public:
   std::string
   getAnnounce();
 
+  void
+  setAnnounceList(const std::vector<std::vector<std::string>>& tiers);
+
+  /**
+   * @brief Tracker tiers from announce-list (BEP 12), in file order
+   *
+   * Falls back to a single tier holding announce when there is no announce-list.
+   */
+  std::vector<std::vector<std::string>>
+  getAnnounceList();
+
   void
   setName(const std::string& name);
 
@@ -109,6 +120,7 @@ public:
 
 private:
   static const std::string ANNOUNCE;
+  static const std::string ANNOUNCE_LIST;
   static const std::string INFO;
   static const std::string NAME;
   static const std::string PIECE_LENGTH;
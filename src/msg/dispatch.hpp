@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_MSG_DISPATCH_HPP
+#define SBT_MSG_DISPATCH_HPP
+
+#include "wire.hpp"
+
+namespace sbt {
+namespace msg {
+
+/**
+ * @brief Decode the framed message @p msg straight into a call on @p handler
+ *
+ * The message id selects the handler method at compile time: no MsgBase object,
+ * virtual call or exception is involved.  Handler has to provide
+ *
+ *     void onKeepAlive();
+ *     void onChoke();
+ *     void onUnchoke();
+ *     void onInterested();
+ *     void onNotInterested();
+ *     void onHave(uint32_t index);
+ *     void onBitfield(const BufferView& bitfield);
+ *     void onRequest(uint32_t index, uint32_t begin, uint32_t length);
+ *     void onPiece(uint32_t index, uint32_t begin, const BufferView& block);
+ *     void onCancel(uint32_t index, uint32_t begin, uint32_t length);
+ *     void onPort(uint16_t port);
+ *
+ * Views passed on share the owner of @p msg.  Messages with unknown ids are skipped.
+ *
+ * @returns false, without calling the handler, if @p msg is not a well-formed message
+ */
+template<class Handler>
+inline bool
+dispatch(const BufferView& msg, Handler& handler)
+{
+  if (msg.size() < 4)
+    return false;
+
+  const uint8_t* p = msg.data();
+  uint32_t length = wire::getUint32(p);
+  if (length != msg.size() - 4)
+    return false;
+  if (length == 0) {
+    handler.onKeepAlive();
+    return true;
+  }
+
+  p += 5;
+  switch (msg.data()[4]) {
+  case MSG_ID_CHOKE:
+    if (length != 1)
+      return false;
+    handler.onChoke();
+    return true;
+  case MSG_ID_UNCHOKE:
+    if (length != 1)
+      return false;
+    handler.onUnchoke();
+    return true;
+  case MSG_ID_INTERESTED:
+    if (length != 1)
+      return false;
+    handler.onInterested();
+    return true;
+  case MSG_ID_NOT_INTERESTED:
+    if (length != 1)
+      return false;
+    handler.onNotInterested();
+    return true;
+  case MSG_ID_HAVE:
+    if (length != 5)
+      return false;
+    handler.onHave(wire::getUint32(p));
+    return true;
+  case MSG_ID_BITFIELD:
+    handler.onBitfield(msg.sub(5, length - 1));
+    return true;
+  case MSG_ID_REQUEST:
+    if (length != 13)
+      return false;
+    handler.onRequest(wire::getUint32(p), wire::getUint32(p + 4), wire::getUint32(p + 8));
+    return true;
+  case MSG_ID_PIECE:
+    if (length < 9)
+      return false;
+    handler.onPiece(wire::getUint32(p), wire::getUint32(p + 4), msg.sub(13, length - 9));
+    return true;
+  case MSG_ID_CANCEL:
+    if (length != 13)
+      return false;
+    handler.onCancel(wire::getUint32(p), wire::getUint32(p + 4), wire::getUint32(p + 8));
+    return true;
+  case MSG_ID_PORT:
+    if (length != 3)
+      return false;
+    handler.onPort((p[0] << 8) | p[1]);
+    return true;
+  default:
+    return true;
+  }
+}
+
+} // namespace msg
+} // namespace sbt
+
+#endif // SBT_MSG_DISPATCH_HPP
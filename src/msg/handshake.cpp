@@ -48,7 +48,7 @@ HandShake::HandShake(ConstBufferPtr infoHash, std::string peerId)
 ConstBufferPtr
 HandShake::encode()
 {
-  OBufferStream os;
+  OBufferStream os(HANDSHAKE_LENGTH);
 
   os.write(reinterpret_cast<const char*>(&PSTR_LENGTH), 1);
   os.write(&PSTR.front(), PSTR.size());
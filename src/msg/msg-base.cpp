@@ -20,6 +20,7 @@
  */
 
 #include "msg-base.hpp"
+#include "wire.hpp"
 #include "../util/buffer-stream.hpp"
 #include <arpa/inet.h>
 
@@ -49,8 +50,6 @@ MsgBase::encode()
 {
   encodePayload();
 
-  OBufferStream os;
-
   if (m_id == MSG_ID_KEEP_ALIVE)
     return std::make_shared<Buffer>(4, 0);
 
@@ -60,6 +59,7 @@ MsgBase::encode()
   else
     hLength = 1;
 
+  OBufferStream os(4 + hLength);
   encodeUint32(os, hLength);
   os.put(m_id);
 
@@ -221,10 +221,25 @@ Piece::Piece(uint32_t index, uint32_t begin, ConstBufferPtr block)
 {
 }
 
+ConstBufferPtr
+Piece::encode()
+{
+  size_t blockSize = static_cast<bool>(m_block) ? m_block->size() : 0;
+  uint8_t header[wire::MAX_LENGTH];
+  size_t length = wire::encodePieceHeader(header, m_index, m_begin, blockSize);
+
+  auto msg = make_shared<Buffer>();
+  msg->reserve(length + blockSize);
+  msg->insert(msg->end(), header, header + length);
+  if (static_cast<bool>(m_block))
+    msg->insert(msg->end(), m_block->begin(), m_block->end());
+  return msg;
+}
+
 void
 Piece::encodePayload()
 {
-  OBufferStream os;
+  OBufferStream os(8 + (m_block ? m_block->size() : 0));
 
   encodeUint32(os, m_index);
   encodeUint32(os, m_begin);
@@ -244,6 +259,23 @@ Piece::decodePayload()
   m_index = decodeUint32(payload);
   m_begin = decodeUint32(payload + 4);
   m_block = make_shared<Buffer>(payload + 8, getPayload()->size() - 8);
+  m_blockView = BufferView(m_block);
+}
+
+void
+Piece::decodeView(const BufferView& msg)
+{
+  if (msg.size() < PAYLOAD_OFFSET + 8 || decodeUint32(msg.data()) != msg.size() - 4 ||
+      msg.data()[ID_OFFSET] != MSG_ID_PIECE)
+    throw Error("Wrong piece message!");
+
+  const uint8_t* payload = msg.data() + PAYLOAD_OFFSET;
+  m_id = MSG_ID_PIECE;
+  m_payload = nullptr;
+  m_index = decodeUint32(payload);
+  m_begin = decodeUint32(payload + 4);
+  m_block = nullptr;
+  m_blockView = msg.sub(PAYLOAD_OFFSET + 8, msg.size() - PAYLOAD_OFFSET - 8);
 }
 
 Cancel::Cancel()
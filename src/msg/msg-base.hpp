@@ -22,7 +22,7 @@
 #ifndef SBT_MSG_BASE_HPP
 #define SBT_MSG_BASE_HPP
 
-#include "../util/buffer.hpp"
+#include "../util/buffer-view.hpp"
 
 namespace sbt {
 namespace msg {
@@ -87,7 +87,7 @@ public:
     m_payload = payload;
   }
 
-  ConstBufferPtr
+  virtual ConstBufferPtr
   encode();
 
   void
@@ -347,6 +347,9 @@ public:
     m_begin = begin;
   }
 
+  /**
+   * @brief The block to encode, or the one decode() copied out
+   */
   ConstBufferPtr
   getBlock() const
   {
@@ -359,6 +362,31 @@ public:
     m_block = block;
   }
 
+  /**
+   * @brief The block as decoded by either decode() or decodeView()
+   */
+  const BufferView&
+  getBlockView() const
+  {
+    return m_blockView;
+  }
+
+  /**
+   * @brief Decode a whole framed Piece message without copying its block
+   *
+   * Afterwards only getBlockView() has the block, pointing into @p msg.
+   * @throws Error if @p msg is not a well-formed Piece
+   */
+  void
+  decodeView(const BufferView& msg);
+
+  /**
+   * @brief Write the header and the block straight into the message, copying the
+   *        block once
+   */
+  virtual ConstBufferPtr
+  encode();
+
   virtual void
   encodePayload();
 
@@ -369,6 +397,7 @@ private:
   uint32_t m_index;
   uint32_t m_begin;
   ConstBufferPtr m_block;
+  BufferView m_blockView;
 };
 
 class Cancel : public MsgBase
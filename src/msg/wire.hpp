@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_MSG_WIRE_HPP
+#define SBT_MSG_WIRE_HPP
+
+#include "msg-base.hpp"
+
+namespace sbt {
+namespace msg {
+
+/**
+ * @brief Peer messages as raw wire bytes, without MsgBase objects
+ *
+ * The messages without payload never change and are kept pre-encoded.  Those with a
+ * few integer fields are encoded by the functions below into a caller's buffer of
+ * MAX_LENGTH bytes, typically on the stack; they return the bytes written.
+ */
+namespace wire {
+
+// a length prefix, an id and three integers: Request and Cancel
+static const size_t MAX_LENGTH = 17;
+
+const uint8_t KEEP_ALIVE[] = {0, 0, 0, 0};
+const uint8_t CHOKE[] = {0, 0, 0, 1, MSG_ID_CHOKE};
+const uint8_t UNCHOKE[] = {0, 0, 0, 1, MSG_ID_UNCHOKE};
+const uint8_t INTERESTED[] = {0, 0, 0, 1, MSG_ID_INTERESTED};
+const uint8_t NOT_INTERESTED[] = {0, 0, 0, 1, MSG_ID_NOT_INTERESTED};
+
+inline uint8_t*
+putUint32(uint8_t* out, uint32_t value)
+{
+  out[0] = value >> 24;
+  out[1] = value >> 16;
+  out[2] = value >> 8;
+  out[3] = value;
+  return out + 4;
+}
+
+inline uint32_t
+getUint32(const uint8_t* in)
+{
+  return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | in[3];
+}
+
+inline size_t
+encodeHave(uint8_t* out, uint32_t index)
+{
+  uint8_t* p = putUint32(out, 5);
+  *p++ = MSG_ID_HAVE;
+  putUint32(p, index);
+  return 9;
+}
+
+inline size_t
+encodeRequest(uint8_t* out, uint32_t index, uint32_t begin, uint32_t length,
+              uint8_t id = MSG_ID_REQUEST)
+{
+  uint8_t* p = putUint32(out, 13);
+  *p++ = id;
+  p = putUint32(p, index);
+  p = putUint32(p, begin);
+  putUint32(p, length);
+  return 17;
+}
+
+inline size_t
+encodeCancel(uint8_t* out, uint32_t index, uint32_t begin, uint32_t length)
+{
+  return encodeRequest(out, index, begin, length, MSG_ID_CANCEL);
+}
+
+/**
+ * @brief Everything of a Piece but the block, which is sent from where it is
+ */
+inline size_t
+encodePieceHeader(uint8_t* out, uint32_t index, uint32_t begin, uint32_t blockLength)
+{
+  uint8_t* p = putUint32(out, 9 + blockLength);
+  *p++ = MSG_ID_PIECE;
+  p = putUint32(p, index);
+  putUint32(p, begin);
+  return 13;
+}
+
+} // namespace wire
+} // namespace msg
+} // namespace sbt
+
+#endif // SBT_MSG_WIRE_HPP
@@ -0,0 +1,68 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "peer-connection.hpp"
+
+#include <sys/epoll.h>
+
+#include <algorithm>
+
+namespace sbt {
+
+PeerConnection::PeerConnection(int sockfd, uint64_t serial)
+  : sockfd(sockfd)
+  , serial(serial)
+  , peerId(0)
+  , phase(PHASE_HANDSHAKE)
+  , amChoking(true)
+  , amInterested(false)
+  , peerChoking(true)
+  , peerInterested(false)
+  , pipeline(0)
+  , isSnubbed(false)
+  , events(EPOLLIN)
+  , snubTimer(0)
+  , keepAliveTimer(0)
+  , lastSent(0)
+  , downloaded(0)
+  , uploaded(0)
+{
+}
+
+PeerTable::PeerTable()
+  : m_nextSerial(1)
+{
+}
+
+PeerConnection&
+PeerTable::add(int sockfd)
+{
+  if (static_cast<size_t>(sockfd) >= m_bySocket.size())
+    m_bySocket.resize(sockfd + 1, nullptr);
+
+  m_connections.push_back(unique_ptr<PeerConnection>(new PeerConnection(sockfd, m_nextSerial++)));
+  m_bySocket[sockfd] = m_connections.back().get();
+  return *m_connections.back();
+}
+
+void
+PeerTable::remove(int sockfd)
+{
+  PeerConnection* peer = find(sockfd);
+  if (peer == nullptr)
+    return;
+
+  m_bySocket[sockfd] = nullptr;
+
+  // order doesn't matter, so the last connection takes the place of this one
+  auto it = std::find_if(m_connections.begin(), m_connections.end(),
+                         [peer] (const unique_ptr<PeerConnection>& p) { return p.get() == peer; });
+  std::swap(*it, m_connections.back());
+  m_connections.pop_back();
+}
+
+} // namespace sbt
@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_PEER_CONNECTION_HPP
+#define SBT_PEER_CONNECTION_HPP
+
+#include "common.hpp"
+#include "util/outbound-queue.hpp"
+#include "util/receive-buffer.hpp"
+#include "util/timer-wheel.hpp"
+
+#include <vector>
+
+namespace sbt {
+
+/**
+ * @brief Everything known about one connection to a peer
+ *
+ * Blocks requested from the peer are tracked by the PiecePicker, under the socket.
+ */
+struct PeerConnection
+{
+  enum Phase {
+    // handshakes are being exchanged
+    PHASE_HANDSHAKE,
+    // handshakes are done; the peer may send its bitfield, as its first message only
+    PHASE_BITFIELD,
+    PHASE_TRANSFER
+  };
+
+  PeerConnection(int sockfd, uint64_t serial);
+
+  int sockfd;
+  // tells connections apart that got the same socket number in turn
+  uint64_t serial;
+  // the peer's id in the torrent's PeerRegistry
+  uint32_t peerId;
+
+  Phase phase;
+  bool amChoking;
+  bool amInterested;
+  bool peerChoking;
+  bool peerInterested;
+
+  // the peer's bitfield, padded to the size of ours; empty until it sends one
+  std::vector<uint8_t> bitfield;
+
+  // blocks we keep requested from the peer, 1 while it is snubbed
+  size_t pipeline;
+  bool isSnubbed;
+
+  // requests waiting on the upload limit or the disk, by upload tag; the Piece
+  // is only sent if its request is still here by then
+  std::vector<uint64_t> uploads;
+
+  util::OutboundQueue output;
+  util::ReceiveBuffer input;
+  // the events the socket is watched for, EPOLLOUT only while output is not empty
+  uint32_t events;
+
+  // 0 when not scheduled
+  util::TimerWheel::TimerId snubTimer;
+  util::TimerWheel::TimerId keepAliveTimer;
+
+  uint64_t lastSent;
+  uint64_t downloaded;
+  uint64_t uploaded;
+};
+
+/**
+ * @brief The connections of one torrent, indexed by socket
+ *
+ * Sockets are small integers, so find() is an index into a table rather than a search.
+ */
+class PeerTable
+{
+public:
+  typedef std::vector<unique_ptr<PeerConnection>>::const_iterator const_iterator;
+
+public:
+  PeerTable();
+
+  PeerTable(const PeerTable&) = delete;
+
+  PeerTable&
+  operator=(const PeerTable&) = delete;
+
+  /**
+   * @brief Start keeping a connection for @p sockfd, which must not have one yet
+   */
+  PeerConnection&
+  add(int sockfd);
+
+  /**
+   * @returns the connection on @p sockfd, or nullptr
+   */
+  PeerConnection*
+  find(int sockfd) const
+  {
+    if (sockfd < 0 || static_cast<size_t>(sockfd) >= m_bySocket.size())
+      return nullptr;
+    return m_bySocket[sockfd];
+  }
+
+  /**
+   * @returns the connection on @p sockfd if it is still the one numbered @p serial
+   */
+  PeerConnection*
+  find(int sockfd, uint64_t serial) const
+  {
+    PeerConnection* peer = find(sockfd);
+    return peer != nullptr && peer->serial == serial ? peer : nullptr;
+  }
+
+  /**
+   * @brief Forget the connection on @p sockfd; references to it become dangling
+   */
+  void
+  remove(int sockfd);
+
+  size_t
+  size() const
+  {
+    return m_connections.size();
+  }
+
+  bool
+  empty() const
+  {
+    return m_connections.empty();
+  }
+
+  const_iterator
+  begin() const
+  {
+    return m_connections.begin();
+  }
+
+  const_iterator
+  end() const
+  {
+    return m_connections.end();
+  }
+
+private:
+  std::vector<unique_ptr<PeerConnection>> m_connections;
+  std::vector<PeerConnection*> m_bySocket;
+  uint64_t m_nextSerial;
+};
+
+} // namespace sbt
+
+#endif // SBT_PEER_CONNECTION_HPP
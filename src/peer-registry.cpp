@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "peer-registry.hpp"
+
+#include <arpa/inet.h>
+
+namespace sbt {
+
+const PeerRegistry::PeerId PeerRegistry::INVALID_ID = 0xFFFFFFFF;
+const int PeerRegistry::NO_SOCKET;
+
+static_assert(sizeof(PeerEndpoint) == 20, "PeerEndpoint must have no padding to be used as a key");
+
+PeerRegistry::PeerId
+PeerRegistry::intern(const PeerEndpoint& endpoint)
+{
+  auto inserted = m_index.insert(std::make_pair(makeKey(endpoint), m_endpoints.size()));
+  if (inserted.second) {
+    m_endpoints.push_back(endpoint);
+    m_sockets.push_back(NO_SOCKET);
+  }
+
+  return inserted.first->second;
+}
+
+PeerRegistry::PeerId
+PeerRegistry::find(const PeerEndpoint& endpoint) const
+{
+  auto it = m_index.find(makeKey(endpoint));
+  return it == m_index.end() ? INVALID_ID : it->second;
+}
+
+PeerEndpoint
+PeerRegistry::makeEndpoint(const std::string& ip, uint16_t port)
+{
+  PeerEndpoint endpoint;
+  memset(&endpoint, 0, sizeof(endpoint));
+  endpoint.family = AF_INET;
+  endpoint.port = htons(port);
+  inet_pton(AF_INET, ip.c_str(), endpoint.addr);
+  return endpoint;
+}
+
+PeerRegistry::Key
+PeerRegistry::makeKey(const PeerEndpoint& endpoint)
+{
+  Key key;
+  memcpy(&key, &endpoint, sizeof(endpoint));
+  return key;
+}
+
+size_t
+PeerRegistry::KeyHash::operator()(const Key& key) const
+{
+  // the address bytes that differ between peers are spread over all three words
+  uint64_t h = key.words[0] * 0x9E3779B97F4A7C15ULL;
+  h ^= (key.words[1] + (h << 6) + (h >> 2)) * 0xC2B2AE3D27D4EB4FULL;
+  h ^= (key.last + (h << 6) + (h >> 2)) * 0x165667B19E3779F9ULL;
+  return h ^ (h >> 32);
+}
+
+} // namespace sbt
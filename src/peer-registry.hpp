@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_PEER_REGISTRY_HPP
+#define SBT_PEER_REGISTRY_HPP
+
+#include "common.hpp"
+#include "tracker-response.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace sbt {
+
+/**
+ * @brief Numbers every peer endpoint a torrent has come across
+ *
+ * Each (family, address, port) gets the next id the first time it is seen and keeps
+ * it, so ids are dense and per-peer data is kept in tables indexed by id rather than
+ * in maps keyed by address strings.  Endpoints are looked up by their raw bytes.
+ */
+class PeerRegistry
+{
+public:
+  typedef uint32_t PeerId;
+
+  static const PeerId INVALID_ID;
+
+  // socket of a peer we are not connected to
+  static const int NO_SOCKET = -1;
+
+public:
+  /**
+   * @returns the id of @p endpoint, a new one if it has none yet
+   */
+  PeerId
+  intern(const PeerEndpoint& endpoint);
+
+  /**
+   * @returns the id of @p endpoint, or INVALID_ID
+   */
+  PeerId
+  find(const PeerEndpoint& endpoint) const;
+
+  const PeerEndpoint&
+  getEndpoint(PeerId id) const
+  {
+    return m_endpoints[id];
+  }
+
+  /**
+   * @brief The socket of the connection to the peer, or NO_SOCKET
+   */
+  int
+  getSocket(PeerId id) const
+  {
+    return m_sockets[id];
+  }
+
+  void
+  setSocket(PeerId id, int sockfd)
+  {
+    m_sockets[id] = sockfd;
+  }
+
+  size_t
+  size() const
+  {
+    return m_endpoints.size();
+  }
+
+  /**
+   * @brief An IPv4 endpoint from a dotted-quad address and a port in host byte order
+   */
+  static PeerEndpoint
+  makeEndpoint(const std::string& ip, uint16_t port);
+
+private:
+  struct Key
+  {
+    uint64_t words[2];
+    uint32_t last;
+
+    bool
+    operator==(const Key& other) const
+    {
+      return words[0] == other.words[0] && words[1] == other.words[1] && last == other.last;
+    }
+  };
+
+  struct KeyHash
+  {
+    size_t
+    operator()(const Key& key) const;
+  };
+
+  static Key
+  makeKey(const PeerEndpoint& endpoint);
+
+private:
+  std::unordered_map<Key, PeerId, KeyHash> m_index;
+
+  // indexed by id
+  std::vector<PeerEndpoint> m_endpoints;
+  std::vector<int> m_sockets;
+};
+
+} // namespace sbt
+
+#endif // SBT_PEER_REGISTRY_HPP
@@ -0,0 +1,238 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "piece-picker.hpp"
+
+#include <algorithm>
+
+namespace sbt {
+
+const uint32_t PiecePicker::BLOCK_SIZE = 16384;
+
+PiecePicker::PiecePicker(uint32_t pieceCount, uint32_t pieceLength, uint64_t totalLength)
+  : m_pieceLength(pieceLength)
+  , m_totalLength(totalLength)
+  , m_pieces(pieceCount)
+  , m_nHave(0)
+  , m_nMissingBlocks(0)
+{
+  for (uint32_t i = 0; i < pieceCount; i++) {
+    size_t nBlocks = (getPieceLength(i) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    m_pieces[i].blocks.resize(nBlocks);
+    m_nMissingBlocks += nBlocks;
+  }
+}
+
+uint32_t
+PiecePicker::getPieceLength(uint32_t index) const
+{
+  uint64_t begin = static_cast<uint64_t>(index) * m_pieceLength;
+  if (begin + m_pieceLength > m_totalLength)
+    return m_totalLength - begin;
+
+  return m_pieceLength;
+}
+
+void
+PiecePicker::setHave(uint32_t index)
+{
+  PieceInfo& piece = m_pieces[index];
+  if (piece.have)
+    return;
+
+  for (uint32_t j = 0; j < piece.blocks.size(); j++) {
+    BlockInfo& block = piece.blocks[j];
+    if (block.state == BLOCK_MISSING)
+      m_nMissingBlocks--;
+
+    block.state = BLOCK_RECEIVED;
+    clearOwners(index, j);
+  }
+
+  piece.have = true;
+  piece.nReceived = piece.blocks.size();
+  m_nHave++;
+}
+
+std::vector<PiecePicker::Block>
+PiecePicker::pick(const uint8_t* bitfield, size_t size, int peer, size_t max)
+{
+  std::vector<Block> picked;
+
+  // first pass: blocks nobody has been asked for yet
+  for (uint32_t i = 0; i < m_pieces.size() && picked.size() < max && m_nMissingBlocks > 0; i++) {
+    PieceInfo& piece = m_pieces[i];
+    if (piece.have || !peerHasPiece(bitfield, size, i))
+      continue;
+
+    for (uint32_t j = 0; j < piece.blocks.size() && picked.size() < max; j++) {
+      BlockInfo& block = piece.blocks[j];
+      if (block.state != BLOCK_MISSING)
+        continue;
+
+      block.state = BLOCK_REQUESTED;
+      block.owners.push_back(peer);
+      m_nMissingBlocks--;
+      picked.push_back(makeBlock(i, j));
+      m_outstanding[peer].push_back(picked.back());
+    }
+  }
+
+  if (!isEndgame())
+    return picked;
+
+  // endgame: duplicate requests for blocks still outstanding at other peers
+  for (uint32_t i = 0; i < m_pieces.size() && picked.size() < max; i++) {
+    PieceInfo& piece = m_pieces[i];
+    if (piece.have || !peerHasPiece(bitfield, size, i))
+      continue;
+
+    for (uint32_t j = 0; j < piece.blocks.size() && picked.size() < max; j++) {
+      BlockInfo& block = piece.blocks[j];
+      if (block.state != BLOCK_REQUESTED ||
+          std::find(block.owners.begin(), block.owners.end(), peer) != block.owners.end())
+        continue;
+
+      block.owners.push_back(peer);
+      picked.push_back(makeBlock(i, j));
+      m_outstanding[peer].push_back(picked.back());
+    }
+  }
+
+  return picked;
+}
+
+PiecePicker::ReceiveResult
+PiecePicker::markReceived(const Block& block, int peer, std::vector<int>& cancels)
+{
+  cancels.clear();
+
+  if (block.index >= m_pieces.size() || block.begin % BLOCK_SIZE != 0)
+    return RECEIVE_REJECTED;
+
+  PieceInfo& piece = m_pieces[block.index];
+  uint32_t j = block.begin / BLOCK_SIZE;
+  if (piece.have || j >= piece.blocks.size() || block.length != makeBlock(block.index, j).length)
+    return RECEIVE_REJECTED;
+
+  // never requested, or a late duplicate from endgame
+  BlockInfo& info = piece.blocks[j];
+  if (info.state != BLOCK_REQUESTED)
+    return RECEIVE_REJECTED;
+
+  for (int owner : info.owners) {
+    if (owner != peer)
+      cancels.push_back(owner);
+  }
+
+  info.state = BLOCK_RECEIVED;
+  clearOwners(block.index, j);
+  piece.nReceived++;
+
+  return piece.nReceived == piece.blocks.size() ? RECEIVE_PIECE_DONE : RECEIVE_ACCEPTED;
+}
+
+std::vector<PiecePicker::Block>
+PiecePicker::abortPeer(int peer)
+{
+  std::vector<Block> aborted;
+
+  auto it = m_outstanding.find(peer);
+  if (it == m_outstanding.end())
+    return aborted;
+  aborted.swap(it->second);
+  m_outstanding.erase(it);
+
+  for (const Block& b : aborted) {
+    BlockInfo& block = m_pieces[b.index].blocks[b.begin / BLOCK_SIZE];
+    block.owners.erase(std::find(block.owners.begin(), block.owners.end(), peer));
+    releaseBlock(block);
+  }
+
+  return aborted;
+}
+
+void
+PiecePicker::pieceFailed(uint32_t index)
+{
+  PieceInfo& piece = m_pieces[index];
+
+  for (uint32_t j = 0; j < piece.blocks.size(); j++) {
+    BlockInfo& block = piece.blocks[j];
+    if (block.state != BLOCK_MISSING)
+      m_nMissingBlocks++;
+
+    block.state = BLOCK_MISSING;
+    clearOwners(index, j);
+  }
+
+  piece.have = false;
+  piece.nReceived = 0;
+}
+
+bool
+PiecePicker::isEndgame() const
+{
+  return m_nMissingBlocks == 0 && !isComplete();
+}
+
+bool
+PiecePicker::peerHasPiece(const uint8_t* bitfield, size_t size, uint32_t index)
+{
+  if (bitfield == nullptr || index / 8 >= size)
+    return false;
+
+  return (bitfield[index / 8] >> (7 - index % 8)) & 1;
+}
+
+PiecePicker::Block
+PiecePicker::makeBlock(uint32_t index, uint32_t block) const
+{
+  Block b;
+  b.index = index;
+  b.begin = block * BLOCK_SIZE;
+  b.length = std::min(BLOCK_SIZE, getPieceLength(index) - b.begin);
+  return b;
+}
+
+void
+PiecePicker::releaseBlock(BlockInfo& info)
+{
+  if (info.owners.empty()) {
+    info.state = BLOCK_MISSING;
+    m_nMissingBlocks++;
+  }
+}
+
+void
+PiecePicker::forgetRequest(int peer, uint32_t index, uint32_t begin)
+{
+  auto it = m_outstanding.find(peer);
+  if (it == m_outstanding.end())
+    return;
+
+  // a pipeline's worth of blocks, order doesn't matter
+  std::vector<Block>& blocks = it->second;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    if (blocks[i].index == index && blocks[i].begin == begin) {
+      blocks[i] = blocks.back();
+      blocks.pop_back();
+      break;
+    }
+  }
+}
+
+void
+PiecePicker::clearOwners(uint32_t index, uint32_t block)
+{
+  BlockInfo& info = m_pieces[index].blocks[block];
+  for (int owner : info.owners)
+    forgetRequest(owner, index, block * BLOCK_SIZE);
+  info.owners.clear();
+}
+
+} // namespace sbt
@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_PIECE_PICKER_HPP
+#define SBT_PIECE_PICKER_HPP
+
+#include "common.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace sbt {
+
+/**
+ * @brief Keeps track of which blocks of the torrent are missing, requested or received
+ *
+ * Pieces are split into blocks of BLOCK_SIZE bytes which are requested independently.
+ * Peers are identified by an opaque integer handle (the client uses the peer socket).
+ *
+ * Once every missing block has been requested at least once the picker enters endgame
+ * mode: blocks that are still outstanding may be handed out again to other peers, and
+ * markReceived() reports which peers should be sent a CANCEL for a block that arrived.
+ */
+class PiecePicker
+{
+public:
+  static const uint32_t BLOCK_SIZE;
+
+  struct Block
+  {
+    uint32_t index;
+    uint32_t begin;
+    uint32_t length;
+  };
+
+  enum ReceiveResult {
+    // not a block we asked for, or not as we asked for it
+    RECEIVE_REJECTED,
+    RECEIVE_ACCEPTED,
+    // accepted, and it completed its piece
+    RECEIVE_PIECE_DONE
+  };
+
+public:
+  PiecePicker(uint32_t pieceCount, uint32_t pieceLength, uint64_t totalLength);
+
+  /**
+   * @brief Mark a piece as verified and stored
+   */
+  void
+  setHave(uint32_t index);
+
+  bool
+  hasPiece(uint32_t index) const
+  {
+    return index < m_pieces.size() && m_pieces[index].have;
+  }
+
+  /**
+   * @brief Length of the piece, the last one may be shorter
+   */
+  uint32_t
+  getPieceLength(uint32_t index) const;
+
+  /**
+   * @brief Pick up to @p max blocks that @p peer has and we are missing
+   *
+   * @param bitfield the peer's bitfield, high bit of the first byte is piece 0
+   * @param size     size of the bitfield in bytes
+   * @returns blocks that have been marked as requested from @p peer
+   */
+  std::vector<Block>
+  pick(const uint8_t* bitfield, size_t size, int peer, size_t max);
+
+  /**
+   * @brief Record that @p block has been received from @p peer
+   *
+   * Only a block that is outstanding, at any peer, and has exactly the offset and
+   * length it was requested with is accepted.
+   *
+   * @param cancels [out] other peers the block is still outstanding at
+   */
+  ReceiveResult
+  markReceived(const Block& block, int peer, std::vector<int>& cancels);
+
+  /**
+   * @brief Return every block outstanding at @p peer to the pool of missing blocks
+   *
+   * @returns the blocks that were outstanding at @p peer
+   */
+  std::vector<Block>
+  abortPeer(int peer);
+
+  /**
+   * @brief Reset all blocks of a piece that failed its hash check
+   */
+  void
+  pieceFailed(uint32_t index);
+
+  /**
+   * @brief Number of blocks currently requested from @p peer
+   */
+  size_t
+  getOutstanding(int peer) const
+  {
+    auto it = m_outstanding.find(peer);
+    return it == m_outstanding.end() ? 0 : it->second.size();
+  }
+
+  bool
+  isEndgame() const;
+
+  bool
+  isComplete() const
+  {
+    return m_nHave == m_pieces.size();
+  }
+
+private:
+  enum BlockState : uint8_t {
+    BLOCK_MISSING = 0,
+    BLOCK_REQUESTED = 1,
+    BLOCK_RECEIVED = 2
+  };
+
+  struct BlockInfo
+  {
+    BlockInfo()
+      : state(BLOCK_MISSING)
+    {
+    }
+
+    BlockState state;
+    std::vector<int> owners; // peers the block is requested from
+  };
+
+  struct PieceInfo
+  {
+    PieceInfo()
+      : have(false)
+      , nReceived(0)
+    {
+    }
+
+    bool have;
+    uint32_t nReceived;
+    std::vector<BlockInfo> blocks;
+  };
+
+  static bool
+  peerHasPiece(const uint8_t* bitfield, size_t size, uint32_t index);
+
+  Block
+  makeBlock(uint32_t index, uint32_t block) const;
+
+  void
+  releaseBlock(BlockInfo& info);
+
+  /**
+   * @brief Take the block at @p begin of piece @p index off the requests of @p peer
+   */
+  void
+  forgetRequest(int peer, uint32_t index, uint32_t begin);
+
+  /**
+   * @brief Take a block off the requests of all its owners and clear them
+   */
+  void
+  clearOwners(uint32_t index, uint32_t block);
+
+private:
+  uint32_t m_pieceLength;
+  uint64_t m_totalLength;
+  std::vector<PieceInfo> m_pieces;
+  size_t m_nHave;
+  size_t m_nMissingBlocks; // blocks in BLOCK_MISSING state of pieces we don't have
+
+  // the blocks requested from each peer, so that nothing per peer scans every block
+  std::unordered_map<int, std::vector<Block>> m_outstanding;
+};
+
+} // namespace sbt
+
+#endif // SBT_PIECE_PICKER_HPP
@@ -0,0 +1,313 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "scrape-client.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "codes.hpp"
+#include "tracker-set.hpp"
+#include "http/url-encoding.hpp"
+#include "util/bencoding.hpp"
+
+namespace sbt {
+
+const size_t ScrapeClient::MAX_HTTP_BATCH;
+
+static bool
+isKey(const uint8_t* key, size_t size, const char* expected)
+{
+  return size == strlen(expected) && memcmp(key, expected, size) == 0;
+}
+
+ScrapeClient::ScrapeClient(util::EventLoop& loop, util::Resolver& resolver, uint64_t ttlMs)
+  : m_loop(loop)
+  , m_resolver(resolver)
+  , m_ttl(ttlMs)
+  , m_nRequests(0)
+{
+}
+
+void
+ScrapeClient::scrape(const std::string& announceUrl, const std::vector<ConstBufferPtr>& infoHashes,
+                     const Callback& callback)
+{
+  auto job = std::make_shared<Job>();
+  job->infoHashes = infoHashes;
+  job->entries.resize(infoHashes.size());
+  job->nPending = 0;
+  job->rc = 0;
+  job->callback = callback;
+
+  std::string url;
+  std::shared_ptr<Tracker> tracker;
+  if (getScrapeUrl(announceUrl, url)) {
+    auto it = m_trackers.find(url);
+    if (it != m_trackers.end())
+      tracker = it->second;
+    else {
+      tracker = std::make_shared<Tracker>();
+      if (TrackerSet::parseUrl(url, tracker->host, tracker->port, tracker->path)) {
+        tracker->url = url;
+        tracker->isBusy = false;
+        if (url.compare(0, 6, "udp://") == 0)
+          tracker->udp = std::make_shared<UdpTrackerConnection>(m_loop, m_resolver,
+                                                                tracker->host, tracker->port);
+        else
+          tracker->connection = std::make_shared<TrackerConnection>(m_loop, m_resolver,
+                                                                    tracker->host, tracker->port);
+        m_trackers[url] = tracker;
+      }
+      else
+        tracker.reset();
+    }
+  }
+
+  if (!tracker) {
+    m_loop.post([job] { job->callback(RC_INVALID_URL, std::vector<Entry>()); });
+    return;
+  }
+
+  // answer what we can from the cache, and batch up the rest
+  uint64_t now = util::steadyNow();
+  size_t batchSize = tracker->udp ? UdpTrackerConnection::MAX_SCRAPE : MAX_HTTP_BATCH;
+  for (size_t i = 0; i < infoHashes.size(); i++) {
+    auto cached = m_cache.find(getCacheKey(url, infoHashes[i]));
+    if (cached != m_cache.end()) {
+      if (cached->second.expiresAt > now) {
+        job->entries[i] = cached->second.entry;
+        continue;
+      }
+      m_cache.erase(cached);
+    }
+
+    if (tracker->queue.empty() || tracker->queue.back().job != job ||
+        tracker->queue.back().indices.size() == batchSize) {
+      tracker->queue.push_back(Batch{job, std::vector<size_t>()});
+      job->nPending++;
+    }
+    tracker->queue.back().indices.push_back(i);
+  }
+
+  if (job->nPending == 0) {
+    m_loop.post([job] { job->callback(0, job->entries); });
+    return;
+  }
+
+  pump(*tracker);
+}
+
+bool
+ScrapeClient::getScrapeUrl(const std::string& announceUrl, std::string& scrapeUrl)
+{
+  if (announceUrl.compare(0, 6, "udp://") == 0) {
+    scrapeUrl = announceUrl;
+    return true;
+  }
+
+  size_t query = announceUrl.find('?');
+  size_t slash = announceUrl.rfind('/', query);
+  if (slash == std::string::npos || announceUrl.compare(slash + 1, 8, "announce") != 0)
+    return false;
+
+  scrapeUrl = announceUrl;
+  scrapeUrl.replace(slash + 1, 8, "scrape");
+  return true;
+}
+
+bool
+ScrapeClient::decodeFiles(const uint8_t* body, size_t size,
+                          const std::vector<ConstBufferPtr>& infoHashes, std::vector<Entry>& entries)
+{
+  entries.assign(infoHashes.size(), Entry{0, 0, 0});
+
+  bencoding::Reader reader(body, size);
+  reader.enterDictionary();
+  while (!reader.isEnd()) {
+    size_t keySize;
+    const uint8_t* key = reader.readString(keySize);
+
+    if (isKey(key, keySize, "failure reason")) {
+      size_t reasonSize;
+      const uint8_t* reason = reader.readString(reasonSize);
+      fprintf(stderr, "Fail:%.*s\n", static_cast<int>(reasonSize), reason);
+      return false;
+    }
+
+    if (!isKey(key, keySize, "files")) {
+      reader.skip();
+      continue;
+    }
+
+    reader.enterDictionary();
+    while (!reader.isEnd()) {
+      size_t hashSize;
+      const uint8_t* hash = reader.readString(hashSize);
+
+      Entry* entry = nullptr;
+      for (size_t i = 0; i < infoHashes.size(); i++) {
+        if (infoHashes[i]->size() == hashSize && memcmp(infoHashes[i]->buf(), hash, hashSize) == 0)
+          entry = &entries[i];
+      }
+      if (entry == nullptr) {
+        reader.skip();
+        continue;
+      }
+
+      reader.enterDictionary();
+      while (!reader.isEnd()) {
+        size_t nameSize;
+        const uint8_t* name = reader.readString(nameSize);
+
+        if (isKey(name, nameSize, "complete"))
+          entry->seeders = reader.readInteger();
+        else if (isKey(name, nameSize, "downloaded"))
+          entry->completed = reader.readInteger();
+        else if (isKey(name, nameSize, "incomplete"))
+          entry->leechers = reader.readInteger();
+        else
+          reader.skip();
+      }
+      reader.leave();
+    }
+    reader.leave();
+  }
+  reader.leave();
+
+  return true;
+}
+
+void
+ScrapeClient::pump(Tracker& tracker)
+{
+  if (tracker.isBusy || tracker.queue.empty())
+    return;
+
+  std::vector<ConstBufferPtr> infoHashes = getInfoHashes(tracker.queue.front());
+
+  tracker.isBusy = true;
+  m_nRequests++;
+
+  Tracker* t = &tracker;
+  if (tracker.udp) {
+    tracker.udp->scrape(infoHashes, [this, t] (int rc, const std::vector<Entry>& entries) {
+      onBatch(*t, rc, entries);
+    });
+  }
+  else {
+    tracker.connection->announce(formatRequest(tracker, infoHashes),
+                                 [this, t] (int rc, const HttpResponseReader& reader) {
+                                   onHttpScrape(*t, rc, reader);
+                                 });
+  }
+}
+
+void
+ScrapeClient::onHttpScrape(Tracker& tracker, int rc, const HttpResponseReader& reader)
+{
+  std::vector<Entry> entries;
+  if (rc < 0) {
+    fprintf(stderr, "Failed to receive a response from tracker %s\n", tracker.url.c_str());
+    onBatch(tracker, rc, entries);
+    return;
+  }
+
+  std::vector<ConstBufferPtr> infoHashes = getInfoHashes(tracker.queue.front());
+
+  try {
+    const Buffer& body = reader.getBody();
+    if (!decodeFiles(body.buf(), body.size(), infoHashes, entries))
+      rc = RC_TRACKER_RESPONSE_FAILED;
+  }
+  catch (bencoding::Error& e) {
+    fprintf(stderr, "Bad response from tracker %s: %s\n", tracker.url.c_str(), e.what());
+    rc = RC_TRACKER_RESPONSE_FAILED;
+  }
+
+  onBatch(tracker, rc, entries);
+}
+
+void
+ScrapeClient::onBatch(Tracker& tracker, int rc, const std::vector<Entry>& entries)
+{
+  Batch batch = tracker.queue.front();
+  tracker.queue.pop_front();
+  tracker.isBusy = false;
+
+  // a short datagram carries fewer entries than torrents asked about
+  if (rc >= 0 && entries.size() != batch.indices.size()) {
+    fprintf(stderr, "Tracker %s answered for %zu of %zu torrents\n", tracker.url.c_str(),
+            entries.size(), batch.indices.size());
+    rc = RC_TRACKER_RESPONSE_FAILED;
+  }
+
+  Job& job = *batch.job;
+  if (rc < 0)
+    job.rc = rc;
+  else {
+    uint64_t expiresAt = util::steadyNow() + m_ttl;
+    for (size_t i = 0; i < batch.indices.size(); i++) {
+      size_t index = batch.indices[i];
+      job.entries[index] = entries[i];
+      m_cache[getCacheKey(tracker.url, job.infoHashes[index])] = CacheEntry{entries[i], expiresAt};
+    }
+  }
+
+  if (--job.nPending == 0)
+    job.callback(job.rc, job.rc < 0 ? std::vector<Entry>() : job.entries);
+
+  pump(tracker);
+}
+
+std::string
+ScrapeClient::formatRequest(const Tracker& tracker, const std::vector<ConstBufferPtr>& infoHashes)
+{
+  std::string request;
+  request.reserve(tracker.path.size() + infoHashes.size() * (11 + 3 * 20) + tracker.host.size() + 96);
+
+  request += "GET /";
+  request += tracker.path;
+  char separator = tracker.path.find('?') == std::string::npos ? '?' : '&';
+  for (const auto& infoHash : infoHashes) {
+    request += separator;
+    request += "info_hash=";
+    size_t length = request.size();
+    request.resize(length + 3 * infoHash->size());
+    char* end = url::encodeTo(infoHash->buf(), infoHash->size(), &request[length]);
+    request.resize(end - request.data());
+    separator = '&';
+  }
+
+  request += " HTTP/1.1\r\n"
+             "Host: " + tracker.host + ":" + tracker.port + "\r\n"
+             "Connection: keep-alive\r\n"
+             "Accept-Language: en-US\r\n"
+             "\r\n";
+  return request;
+}
+
+std::vector<ConstBufferPtr>
+ScrapeClient::getInfoHashes(const Batch& batch)
+{
+  std::vector<ConstBufferPtr> infoHashes;
+  infoHashes.reserve(batch.indices.size());
+  for (size_t i : batch.indices)
+    infoHashes.push_back(batch.job->infoHashes[i]);
+  return infoHashes;
+}
+
+std::string
+ScrapeClient::getCacheKey(const std::string& url, const ConstBufferPtr& infoHash)
+{
+  std::string key(url);
+  key += '\n';
+  key.append(reinterpret_cast<const char*>(infoHash->buf()), infoHash->size());
+  return key;
+}
+
+} // namespace sbt
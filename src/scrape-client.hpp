@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_SCRAPE_CLIENT_HPP
+#define SBT_SCRAPE_CLIENT_HPP
+
+#include "tracker-connection.hpp"
+#include "udp-tracker-connection.hpp"
+
+#include <deque>
+#include <map>
+#include <unordered_map>
+
+namespace sbt {
+
+/**
+ * @brief Swarm statistics of many torrents, fetched in batches and cached
+ *
+ * The scrape URL is derived from the announce URL (BEP 48).  Torrents that are not in
+ * the cache are scraped with as few requests as possible: up to MAX_HTTP_BATCH
+ * info_hash parameters per HTTP request, or MAX_SCRAPE per UDP datagram.  Requests
+ * to the same tracker are sent one after the other over one connection.  Results are
+ * cached for the given TTL.
+ */
+class ScrapeClient
+{
+public:
+  typedef UdpTrackerConnection::ScrapeEntry Entry;
+
+  /**
+   * @param rc       0 on success or one of the RC_* codes
+   * @param entries  one per info hash, in the order asked for; a torrent the tracker
+   *                 does not know reports zeros
+   */
+  typedef function<void(int rc, const std::vector<Entry>& entries)> Callback;
+
+  // info hashes per HTTP request, which keeps the URL within common server limits
+  static const size_t MAX_HTTP_BATCH = 64;
+
+public:
+  ScrapeClient(util::EventLoop& loop, util::Resolver& resolver, uint64_t ttlMs = 600000);
+
+  /**
+   * @brief Scrape @p infoHashes from the tracker behind @p announceUrl
+   *
+   * @p callback is always called from the event loop, even when every torrent is
+   * answered from the cache.
+   */
+  void
+  scrape(const std::string& announceUrl, const std::vector<ConstBufferPtr>& infoHashes,
+         const Callback& callback);
+
+  /**
+   * @brief Number of cached results, expired ones included
+   */
+  size_t
+  getCacheSize() const
+  {
+    return m_cache.size();
+  }
+
+  /**
+   * @brief Number of requests sent to trackers so far
+   */
+  size_t
+  getRequestCount() const
+  {
+    return m_nRequests;
+  }
+
+  /**
+   * @brief Derive the scrape URL from an announce URL
+   *
+   * For HTTP the last path component has to start with "announce", which is replaced
+   * by "scrape".  UDP trackers scrape on the announce endpoint.
+   * @returns false if the tracker does not support scraping
+   */
+  static bool
+  getScrapeUrl(const std::string& announceUrl, std::string& scrapeUrl);
+
+  /**
+   * @brief Fill @p entries from the "files" dictionary of an HTTP scrape response
+   *
+   * @returns false if the tracker sent a failure reason
+   * @throws bencoding::Error if the response is malformed
+   */
+  static bool
+  decodeFiles(const uint8_t* body, size_t size, const std::vector<ConstBufferPtr>& infoHashes,
+              std::vector<Entry>& entries);
+
+private:
+  struct Job
+  {
+    std::vector<ConstBufferPtr> infoHashes;
+    std::vector<Entry> entries;
+    size_t nPending;  // batches not answered yet
+    int rc;
+    Callback callback;
+  };
+
+  struct Batch
+  {
+    std::shared_ptr<Job> job;
+    std::vector<size_t> indices; // into the job's infoHashes
+  };
+
+  struct Tracker
+  {
+    std::string url;
+    std::string host;
+    std::string port;
+    std::string path;
+    std::shared_ptr<TrackerConnection> connection;  // http:// trackers
+    std::shared_ptr<UdpTrackerConnection> udp;      // udp:// trackers
+    std::deque<Batch> queue;                        // front is in flight when busy
+    bool isBusy;
+  };
+
+  struct CacheEntry
+  {
+    Entry entry;
+    uint64_t expiresAt; // steady clock, ms
+  };
+
+  /**
+   * @brief Send the next queued batch of @p tracker, unless one is in flight
+   */
+  void
+  pump(Tracker& tracker);
+
+  void
+  onHttpScrape(Tracker& tracker, int rc, const HttpResponseReader& reader);
+
+  /**
+   * @brief Finish the batch in flight on @p tracker and move on to the next one
+   */
+  void
+  onBatch(Tracker& tracker, int rc, const std::vector<Entry>& entries);
+
+  static std::string
+  formatRequest(const Tracker& tracker, const std::vector<ConstBufferPtr>& infoHashes);
+
+  static std::vector<ConstBufferPtr>
+  getInfoHashes(const Batch& batch);
+
+  static std::string
+  getCacheKey(const std::string& url, const ConstBufferPtr& infoHash);
+
+private:
+  util::EventLoop& m_loop;
+  util::Resolver& m_resolver;
+  uint64_t m_ttl;
+
+  std::map<std::string, std::shared_ptr<Tracker>> m_trackers; // by scrape URL
+  std::unordered_map<std::string, CacheEntry> m_cache;        // by scrape URL and info hash
+  size_t m_nRequests;
+};
+
+} // namespace sbt
+
+#endif // SBT_SCRAPE_CLIENT_HPP
@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "session.hpp"
+
+#include "codes.hpp"
+
+namespace sbt {
+
+static std::string
+toKey(const uint8_t* infoHash)
+{
+  return std::string(reinterpret_cast<const char*>(infoHash), PIECE_HASH);
+}
+
+Session::Session(const std::string& port, uint64_t uploadRate, size_t nShards)
+  : m_port(port)
+  , m_peerId(generatePeerId())
+  , m_blockPool(PiecePicker::BLOCK_SIZE, BLOCK_POOL_BYTES)
+  , m_chunkPool(util::ReceiveBuffer::CHUNK_SIZE, CHUNK_POOL_BYTES)
+  , m_uploadLimiter(uploadRate)
+  , m_nextShard(0)
+{
+  if (nShards == 0)
+    nShards = 1;
+
+  for (size_t i = 0; i < nShards; i++) {
+    m_shards.push_back(std::unique_ptr<Shard>(new Shard(i,
+      [this] (const uint8_t* infoHash) { return findTorrent(infoHash) != nullptr; },
+      [this, i] (int sockfd, const sockaddr_in& addr, msg::HandShake& handshake) {
+        onHandshake(*m_shards[i], sockfd, addr, handshake);
+      },
+      m_blockPool, m_chunkPool, m_uploadLimiter, m_uploadMutex)));
+  }
+}
+
+Session::~Session()
+{
+  for (auto& shard : m_shards)
+    shard->stop();
+
+  m_torrents.clear();
+}
+
+int
+Session::listen()
+{
+  // with port 0 the first shard picks one, and the others join it
+  std::string port = m_port;
+  for (auto& shard : m_shards) {
+    int rc = shard->getAcceptor().listen(CLIENT_IP, port, true);
+    if (rc < 0)
+      return rc;
+    port = std::to_string(shard->getAcceptor().getPort());
+  }
+
+  return 0;
+}
+
+Torrent*
+Session::addTorrent(const std::string& file)
+{
+  Shard* shard;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    shard = m_shards[m_nextShard++ % m_shards.size()].get();
+  }
+
+  std::unique_ptr<Torrent> torrent(new Torrent(*this, *shard, file));
+  std::string key = toKey(torrent->getHash()->buf());
+  Torrent* added = torrent.get();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_torrents.count(key) != 0)
+      return nullptr;
+
+    Entry& entry = m_torrents[key];
+    entry.torrent = std::move(torrent);
+    entry.shard = shard;
+  }
+
+  shard->getLoop().post([added] { added->start(); });
+  return added;
+}
+
+Torrent*
+Session::findTorrent(const uint8_t* infoHash) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_torrents.find(toKey(infoHash));
+  return it == m_torrents.end() ? nullptr : it->second.torrent.get();
+}
+
+size_t
+Session::getTorrentCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_torrents.size();
+}
+
+void
+Session::onHandshake(Shard& shard, int sockfd, const sockaddr_in& addr,
+                     msg::HandShake& handshake)
+{
+  Shard* owner = nullptr;
+  Torrent* torrent = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_torrents.find(toKey(handshake.getInfoHash()->buf()));
+    if (it != m_torrents.end()) {
+      owner = it->second.shard;
+      torrent = it->second.torrent.get();
+    }
+  }
+
+  if (torrent == nullptr) {
+    close(sockfd);
+    return;
+  }
+
+  std::string ip = inet_ntoa(addr.sin_addr);
+  uint16_t port = ntohs(addr.sin_port);
+  if (owner == &shard) {
+    torrent->addIncomingPeer(sockfd, ip, port, handshake);
+    return;
+  }
+
+  // accepted by another shard than the torrent's, so the connection moves over
+  msg::HandShake moved = handshake;
+  owner->getLoop().post([torrent, sockfd, ip, port, moved] () mutable {
+    torrent->addIncomingPeer(sockfd, ip, port, moved);
+  });
+}
+
+void
+Session::run()
+{
+  for (size_t i = 1; i < m_shards.size(); i++)
+    m_shards[i]->start();
+
+  m_shards[0]->run();
+
+  for (size_t i = 1; i < m_shards.size(); i++)
+    m_shards[i]->stop();
+}
+
+void
+Session::stop()
+{
+  m_shards[0]->stop();
+}
+
+void
+Session::setUploadRate(uint64_t bytesPerSecond)
+{
+  std::lock_guard<std::mutex> lock(m_uploadMutex);
+  m_uploadLimiter.setRate(bytesPerSecond);
+}
+
+std::string
+Session::generatePeerId()
+{
+  std::string peerId = PEER_ID_PREFIX;
+  for (int i = 0; i < 12; i++)
+    peerId += std::to_string(rand() % 10);
+
+  return SIMPLEBT_TEST ? TEST_PEER_ID : peerId;
+}
+
+} // namespace sbt
@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_SESSION_HPP
+#define SBT_SESSION_HPP
+
+#include "shard.hpp"
+#include "torrent.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+#define SIMPLEBT_TEST true
+#define PEER_ID_PREFIX "-CC0001-"
+#define TEST_PEER_ID "SIMPLEBT.TEST.PEERID"
+
+// ceilings on the pooled block and receive buffers of all shards together (bytes);
+// past them buffers come from the heap and are freed after use
+#define BLOCK_POOL_BYTES (64 << 20)
+#define CHUNK_POOL_BYTES (64 << 20)
+
+namespace sbt {
+
+/**
+ * @brief Many torrents run by one process over several reactor threads
+ *
+ * The session is split into shards, each a reactor thread with its own loop, resolver,
+ * disk pool, lease on the upload rate and SO_REUSEPORT acceptor.  Every torrent is
+ * pinned to one shard and only ever touched from its thread, so the per-message paths
+ * take no locks.  Only the rare operations that cross shards go through the loops'
+ * post() queues: handing over a connection accepted by another shard and starting a
+ * torrent.
+ *
+ * The upload limit is one token bucket for the whole session, which the shards draw
+ * from a lease at a time, so a busy shard may use what idle ones leave.
+ *
+ * Torrents are keyed by info hash, which is how an incoming handshake finds its
+ * torrent; those for torrents we do not run are turned away by the acceptor.
+ *
+ * Block and receive buffers come from pools shared by the shards, whose ceilings
+ * bound the memory they take.
+ */
+class Session
+{
+public:
+  /**
+   * @param uploadRate  bytes per second over all torrents, 0 for no limit
+   * @param nShards     reactor threads, at least one
+   */
+  explicit
+  Session(const std::string& port, uint64_t uploadRate = 0, size_t nShards = 1);
+
+  ~Session();
+
+  /**
+   * @brief Accept peers on CLIENT_IP and the session's port, in every shard
+   * @returns 0 or RC_CLIENT_CONNECTION_FAILED
+   */
+  int
+  listen();
+
+  /**
+   * @brief Load the torrent in @p file and start announcing it on its shard
+   *
+   * Safe to call from any thread, also while the session runs.
+   * @returns nullptr if a torrent with the same info hash is already running
+   */
+  Torrent*
+  addTorrent(const std::string& file);
+
+  /**
+   * @brief Torrent with the 20-byte @p infoHash, or nullptr; safe from any thread
+   */
+  Torrent*
+  findTorrent(const uint8_t* infoHash) const;
+
+  /**
+   * @brief Run the first shard on the calling thread and the others on their own
+   * threads, until stop()
+   */
+  void
+  run();
+
+  /**
+   * @brief Make run() return; safe to call from any thread
+   */
+  void
+  stop();
+
+  /**
+   * @brief Change the upload limit over all shards; safe to call from any thread
+   */
+  void
+  setUploadRate(uint64_t bytesPerSecond);
+
+  size_t
+  getShardCount() const
+  {
+    return m_shards.size();
+  }
+
+  Shard&
+  getShard(size_t index)
+  {
+    return *m_shards[index];
+  }
+
+  const std::string&
+  getPort() const
+  {
+    return m_port;
+  }
+
+  const std::string&
+  getPeerId() const
+  {
+    return m_peerId;
+  }
+
+  size_t
+  getTorrentCount() const;
+
+  /**
+   * @brief 16 KiB blocks read for uploading
+   */
+  util::SlabPool&
+  getBlockPool()
+  {
+    return m_blockPool;
+  }
+
+  /**
+   * @brief Chunks peer messages are received into
+   */
+  util::SlabPool&
+  getChunkPool()
+  {
+    return m_chunkPool;
+  }
+
+  /**
+   * @brief Azureus-style peer id, or the fixed test id for SIMPLEBT_TEST builds
+   */
+  static std::string
+  generatePeerId();
+
+private:
+  struct Entry
+  {
+    std::unique_ptr<Torrent> torrent;
+    Shard* shard;
+  };
+
+  void
+  onHandshake(Shard& shard, int sockfd, const sockaddr_in& addr, msg::HandShake& handshake);
+
+private:
+  std::string m_port;
+  std::string m_peerId;
+  // declared before the shards, so that they outlive their caches
+  util::SlabPool m_blockPool;
+  util::SlabPool m_chunkPool;
+  util::RateLimiter m_uploadLimiter;
+  std::mutex m_uploadMutex;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  size_t m_nextShard;
+
+  // declared after the shards so that torrents go before the loops they use
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, Entry> m_torrents;
+};
+
+} // namespace sbt
+
+#endif // SBT_SESSION_HPP
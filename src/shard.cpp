@@ -0,0 +1,50 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "shard.hpp"
+
+namespace sbt {
+
+Shard::Shard(size_t index, const Acceptor::Filter& filter, const Acceptor::Handler& handler,
+             util::SlabPool& blockPool, util::SlabPool& chunkPool,
+             util::RateLimiter& uploadLimiter, std::mutex& uploadMutex)
+  : m_index(index)
+  , m_resolver(m_loop)
+  , m_diskPool(m_loop)
+  , m_uploadLimiter(uploadLimiter, uploadMutex)
+  , m_blockCache(blockPool)
+  , m_chunkCache(chunkPool)
+  , m_acceptor(m_loop, filter, handler)
+{
+}
+
+Shard::~Shard()
+{
+  stop();
+}
+
+void
+Shard::start()
+{
+  m_thread = std::thread([this] { m_loop.run(); });
+}
+
+void
+Shard::run()
+{
+  m_loop.run();
+}
+
+void
+Shard::stop()
+{
+  m_loop.post([this] { m_loop.stop(); });
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+} // namespace sbt
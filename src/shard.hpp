@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_SHARD_HPP
+#define SBT_SHARD_HPP
+
+#include "acceptor.hpp"
+#include "util/disk-pool.hpp"
+#include "util/rate-limiter.hpp"
+#include "util/resolver.hpp"
+#include "util/slab-pool.hpp"
+
+#include <thread>
+
+namespace sbt {
+
+/**
+ * @brief One reactor thread of a Session
+ *
+ * Everything in a shard belongs to its loop thread: the loop itself, the resolver,
+ * the disk pool, its lease on the session's upload limiter, its caches of the session's
+ * buffer pools and an acceptor bound with SO_REUSEPORT, so the kernel spreads incoming
+ * connections over the shards.  Other threads only reach a shard through
+ * getLoop().post().
+ */
+class Shard
+{
+public:
+  /**
+   * @param blockPool  16 KiB blocks, for the upload path
+   * @param chunkPool  receive chunks, for framing peer messages
+   * @param uploadLimiter  the session's upload limit, guarded by @p uploadMutex
+   */
+  Shard(size_t index, const Acceptor::Filter& filter, const Acceptor::Handler& handler,
+        util::SlabPool& blockPool, util::SlabPool& chunkPool,
+        util::RateLimiter& uploadLimiter, std::mutex& uploadMutex);
+
+  /**
+   * @brief Stop and join the thread if start() was called
+   */
+  ~Shard();
+
+  /**
+   * @brief Run the loop on a thread of its own
+   */
+  void
+  start();
+
+  /**
+   * @brief Run the loop on the calling thread until stop()
+   */
+  void
+  run();
+
+  /**
+   * @brief Stop the loop and join its thread; safe to call from any thread
+   */
+  void
+  stop();
+
+  size_t
+  getIndex() const
+  {
+    return m_index;
+  }
+
+  util::EventLoop&
+  getLoop()
+  {
+    return m_loop;
+  }
+
+  util::Resolver&
+  getResolver()
+  {
+    return m_resolver;
+  }
+
+  util::DiskPool&
+  getDiskPool()
+  {
+    return m_diskPool;
+  }
+
+  util::RateLease&
+  getUploadLimiter()
+  {
+    return m_uploadLimiter;
+  }
+
+  Acceptor&
+  getAcceptor()
+  {
+    return m_acceptor;
+  }
+
+  util::SlabPool::Cache&
+  getBlockCache()
+  {
+    return m_blockCache;
+  }
+
+  util::SlabPool::Cache&
+  getChunkCache()
+  {
+    return m_chunkCache;
+  }
+
+private:
+  size_t m_index;
+  util::EventLoop m_loop;
+  util::Resolver m_resolver;
+  util::DiskPool m_diskPool;
+  util::RateLease m_uploadLimiter;
+  util::SlabPool::Cache m_blockCache;
+  util::SlabPool::Cache m_chunkCache;
+  Acceptor m_acceptor;
+  std::thread m_thread;
+};
+
+} // namespace sbt
+
+#endif // SBT_SHARD_HPP
@@ -0,0 +1,1108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @date 1/24/2015
+ * @author Soomin Jeong <sjeongus@ucla.edu>
+ * @author Jeffrey Wang <oojeffree@g.ucla.edu>
+ * @author James Wu <wuzhonglin@ucla.edu>
+ */
+
+#include "torrent.hpp"
+#include "session.hpp"
+
+using namespace std;
+
+namespace sbt {
+
+Torrent::Torrent(Session& session, Shard& shard, const std::string& torrent)
+  : nSession(session)
+  , nShard(shard) {
+  nPort = session.getPort();
+  nPeerId = session.getPeerId();
+  nDownloaded = 0;
+  nUploaded = 0;
+
+  nInfo = new MetaInfo();
+  nTrackers = NULL;
+  nLoop = &shard.getLoop();
+  nChokerTimer = 0;
+
+  // Read the torrent file into a filestream and decode
+  ifstream torrentStream(torrent, ifstream::in);
+  nInfo->wireDecode(torrentStream);
+  // MetaInfo::getHash() encodes and hashes the info dictionary on every call
+  nInfoHash = nInfo->getHash();
+
+  // Initialize bitfield
+  initBitfield();
+
+  nRemaining = nInfo->getLength();
+  fck();
+  nFileFd = open(nInfo->getName().c_str(), O_RDWR | O_CLOEXEC);
+  nPiecePool = make_shared<util::SlabPool>(nInfo->getPieceLength());
+
+  // Seed the piece picker with the pieces that survived the file check
+  nPicker = new PiecePicker(nPieceCount, nInfo->getPieceLength(), nInfo->getLength());
+  for (unsigned int i = 0; i < nPieceCount; i++) {
+    if (getBit(nBitfield, i)) {
+      nPicker->setHave(i);
+    }
+  }
+}
+
+/*
+ * The loop outlives the torrent, so everything the torrent left on it
+ * (peer sockets, timers) is taken off first.
+ */
+Torrent::~Torrent() {
+  while (!nPeers.empty()) {
+    disconnectPeer((*nPeers.begin())->sockfd);
+  }
+  if (nChokerTimer != 0) {
+    nLoop->cancel(nChokerTimer);
+  }
+
+  delete nTrackers;
+  delete nInfo;
+  delete nPicker;
+  delete [] nBitfield;
+
+  if (nFileFd != -1) {
+    close(nFileFd);
+  }
+}
+
+ConstBufferPtr Torrent::getHash() const {
+  return nInfoHash;
+}
+
+/*
+ * Checks if file exists or not. If it doesn't, allocates space for it.
+ * If it does, checks existing file against pieces and rellaocate as necessary.
+ */
+int Torrent::fck() {
+  struct stat buffer;
+  FILE *fd;
+
+  vector<uint8_t>::iterator begin, end;
+  vector<uint8_t> pieces = nInfo->getPieces();
+
+  fd = fopen((nInfo->getName()).c_str(), "a+");
+  if (fd) {
+    stat((nInfo->getName()).c_str(), &buffer);
+    int size = nInfo->getLength() > nDownloaded ? nInfo->getLength() : nDownloaded;
+
+    if (buffer.st_size < size) {
+      if (ftruncate(fileno(fd), size) != 0) {
+        fprintf(stderr, "File truncation failed: %d\n", errno);
+        return RC_FILE_ALLOCATE_FAILED;
+      }
+    }
+
+    // go through each piece in the file and compare the hash
+    begin = pieces.begin();
+    end = begin + PIECE_HASH;
+
+    int piece_hash_count = pieces.size() / PIECE_HASH;
+    int pieces_left = piece_hash_count;
+    nPieceCount = piece_hash_count;
+
+    char *piece = new char[nInfo->getPieceLength()];
+    while (pieces_left > 0 && !feof(fd)) {
+      int index = piece_hash_count - pieces_left;
+      vector<uint8_t> c_piece(begin, end);
+      size_t length = fread(piece, sizeof(char), nInfo->getPieceLength(), fd);
+      ConstBufferPtr piece_hash = util::sha1(make_shared<sbt::Buffer>(piece, length));
+
+      if (*piece_hash == c_piece) {
+        fprintf(stderr, "Piece %d validated\n", index);
+        int byte = index / 8;
+        int offset = index % 8;
+        uint8_t mask = 1;
+        nBitfield[byte] |= mask << (7 - offset);
+      }
+
+      pieces_left--;
+      begin += PIECE_HASH;
+      end += PIECE_HASH;
+    }
+    delete [] piece;
+    fclose(fd);
+  } else {
+    fprintf(stderr, "File allocate error: %d\n", errno);
+    return RC_FILE_ALLOCATE_FAILED;
+  }
+
+  return 0;
+}
+
+/*
+ * Hashes a downloaded piece on the session's disk pool, off the event loop,
+ * and only marks it as ours once it checks out.
+ */
+void Torrent::verifyPiece(unsigned int index, int length) {
+  string file = nInfo->getName();
+  uint64_t offset = (uint64_t)index * nInfo->getPieceLength();
+  vector<uint8_t> pieces = nInfo->getPieces();
+  vector<uint8_t> expected(pieces.begin() + index * PIECE_HASH,
+                           pieces.begin() + (index + 1) * PIECE_HASH);
+
+  // the job only sees copies, never the torrent itself
+  shared_ptr<bool> valid = make_shared<bool>(false);
+  shared_ptr<util::SlabPool> piecePool = nPiecePool;
+  nShard.getDiskPool().submit([file, offset, length, expected, valid, piecePool] {
+    *valid = checkPiece(file, offset, length, expected, *piecePool);
+  }, [this, index, length, valid] {
+    onPieceVerified(index, length, *valid);
+  });
+}
+
+/*
+ * Reads a piece back from the file and compares its hash. Runs on a disk
+ * pool thread.
+ */
+bool Torrent::checkPiece(const string& file, uint64_t offset, int length,
+                         const vector<uint8_t>& expected, util::SlabPool& piecePool) {
+  ifstream fp;
+  fp.open(file, ios::in | ios::binary);
+  fp.seekg(offset);
+
+  util::SlabPool::Slab piece = piecePool.acquire();
+  fp.read((char *)piece.get(), length);
+  if (fp.gcount() != length) {
+    return false;
+  }
+
+  return util::sha1(piece.get(), length) == expected;
+}
+
+void Torrent::onPieceVerified(unsigned int index, int length, bool valid) {
+  if (!valid) {
+    fprintf(stderr, "Piece hash check failed\n");
+    fprintf(stderr, "Piece validation failed: %d\n", RC_PIECE_NOT_VALID);
+    nPicker->pieceFailed(index);
+    return;
+  }
+
+  fprintf(stderr, "Piece %d validated\n", index);
+  int byte = index / 8;
+  int offset = index % 8;
+  uint8_t mask = 1;
+  nBitfield[byte] |= mask << (7 - offset);
+
+  nPicker->setHave(index);
+  nDownloaded += length;
+  nRemaining -= length;
+  fprintf(stderr, "We received %d\n", length);
+
+  // now we have the piece, so we send a have to everyone
+  PeerTable::const_iterator iter = nPeers.begin();
+  for (; iter != nPeers.end(); iter++) {
+    sendHave(**iter, index);
+  }
+}
+
+/*
+ * Initializes the client's bitfield to all zeroes. Requires that the torrent
+ * metainfo have been parsed first.
+ */
+void Torrent::initBitfield() {
+  int file_length = nInfo->getLength();
+  int pieces_length = nInfo->getPieceLength();
+  int piece_count = (file_length + pieces_length - 1) / pieces_length;
+
+  nFieldSize = (piece_count + 7) / 8;
+  nBitfield = new uint8_t[nFieldSize];
+  memset(nBitfield, 0, nFieldSize);
+}
+
+/*
+ * Returns the bit for the given piece index, high bit of the first byte first.
+ */
+uint8_t Torrent::getBit(uint8_t* array, int index) {
+  return (array[index / 8] >> (7 - index % 8)) & 1;
+}
+
+/*
+ * Starts announcing to every tracker. Announces, re-announces, choker
+ * rounds, keep-alives and request timeouts all run off the session's
+ * loop, so a slow tracker never stalls the peers or the other torrents.
+ */
+int Torrent::start() {
+  nTrackers = new TrackerSet(*nLoop, nShard.getResolver(), nInfo->getAnnounceList(),
+    [this] (const TrackerSet::Tracker& tracker) {
+      return nextRequest(tracker);
+    },
+    [this] (const vector<PeerEndpoint>& peers) {
+      onPeers(peers);
+    });
+
+  nTrackers->start();
+  chokerRound();
+
+  return 0;
+}
+
+/*
+ * Fills in the next announce for a tracker. Every tracker is told we started
+ * until it answers once, and that we completed once the download is done.
+ */
+AnnounceRequest Torrent::nextRequest(const TrackerSet::Tracker& tracker) {
+  AnnounceRequest request;
+  request.infoHash = nInfoHash;
+  request.peerId = nPeerId;
+  request.port = atoi(nPort.c_str());
+  request.uploaded = nUploaded;
+  request.downloaded = nDownloaded;
+  request.left = nRemaining;
+
+  if (!tracker.isStarted) {
+    request.event = AnnounceRequest::EVENT_STARTED;
+  } else if (nDownloaded < nInfo->getLength()) {
+    request.event = AnnounceRequest::EVENT_NONE;
+  } else {
+    cout << "COMPLETED, NOW TELLING TRACKER" << endl;
+    request.event = AnnounceRequest::EVENT_COMPLETED;
+  }
+
+  return request;
+}
+
+/*
+ * Connects to peers the trackers reported, new ones or ones we lost since.
+ */
+void Torrent::onPeers(const vector<PeerEndpoint>& endpoints) {
+  vector<PeerEndpoint>::const_iterator it = endpoints.begin();
+  for (; it != endpoints.end(); it++) {
+    // we only bind and connect over IPv4
+    if (it->family != AF_INET) {
+      continue;
+    }
+
+    PeerRegistry::PeerId id = nPeerRegistry.intern(*it);
+    cout << it->getIp() << ":" << it->getPort() << endl;
+    if (it->getPort() != atoi(nPort.c_str()) &&
+        nPeerRegistry.getSocket(id) == PeerRegistry::NO_SOCKET) {
+      if (connectPeer(id) < 0) {
+        nTrackers->forget(*it);
+      }
+    }
+  }
+}
+
+/*
+ * Starts connecting to a peer without waiting on it. Our handshake goes
+ * out once the connect completes and the socket turns writable; the
+ * peer's is taken in by onPeerReadable like any other message.
+ */
+int Torrent::connectPeer(PeerRegistry::PeerId id) {
+  const PeerEndpoint& endpoint = nPeerRegistry.getEndpoint(id);
+  int sockfd = -1;
+  int rc = createConnection(endpoint.getIp(), endpoint.getPort(), sockfd);
+  if (rc < 0) {
+    if (sockfd != -1) {
+      close(sockfd);
+    }
+    return rc;
+  }
+
+  fprintf(stderr, "Setting up handshake with a peer\n");
+  PeerConnection& conn = addPeer(sockfd, id);
+  conn.output.push(msg::HandShake(nInfoHash, nPeerId).encode());
+  armWrite(conn);
+
+  // a connect that never completes, or a peer that never answers; the
+  // snub timer is free until the handshakes are done
+  uint64_t serial = conn.serial;
+  conn.snubTimer = nLoop->schedule(HANDSHAKE_TIMEOUT, [this, sockfd, serial] {
+    PeerConnection* peer = nPeers.find(sockfd, serial);
+    if (peer != NULL) {
+      peer->snubTimer = 0;
+      fprintf(stderr, "Peer %s did not complete its handshake\n", getAddress(*peer).c_str());
+      disconnectPeer(sockfd);
+    }
+  });
+
+  return 0;
+}
+
+/*
+ * Answers the handshake of a peer that connected to us and starts talking
+ * to it like to any peer we connected to ourselves.
+ */
+void Torrent::addIncomingPeer(int sockfd, const string& ip, uint16_t port,
+                              msg::HandShake& handshake) {
+  PeerRegistry::PeerId id = nPeerRegistry.intern(PeerRegistry::makeEndpoint(ip, port));
+  if (nPeerRegistry.getSocket(id) != PeerRegistry::NO_SOCKET) {
+    close(sockfd);
+    return;
+  }
+
+  // our handshake and bitfield go out together on the first writable event
+  fprintf(stderr, "Accepted handshake from peer %s\n", handshake.getPeerId().c_str());
+  PeerConnection& conn = addPeer(sockfd, id);
+  conn.output.push(msg::HandShake(nInfoHash, nPeerId).encode());
+  conn.phase = PeerConnection::PHASE_BITFIELD;
+  sendBitfield(conn);
+}
+
+/*
+ * Registers a peer with the event loop and starts its keep-alive timer.
+ * From here on the socket is non-blocking and everything sent to the peer
+ * goes through its outbound queue.
+ */
+PeerConnection& Torrent::addPeer(int sockfd, PeerRegistry::PeerId id) {
+  PeerConnection& conn = nPeers.add(sockfd);
+  conn.peerId = id;
+  nPeerRegistry.setSocket(id, sockfd);
+  conn.pipeline = PIPELINE_DEPTH;
+  conn.input = util::ReceiveBuffer(nShard.getChunkCache());
+  fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) | O_NONBLOCK);
+
+  nLoop->add(sockfd, conn.events, [this, sockfd] (uint32_t events) {
+    onPeerEvent(sockfd, events);
+  });
+
+  conn.keepAliveTimer = nLoop->schedule(KEEPALIVE_INTERVAL, [this, sockfd] {
+    keepAlive(sockfd);
+  });
+
+  return conn;
+}
+
+/*
+ * Drops a connection and everything we remember about it, returning its
+ * outstanding requests to the picker.
+ */
+void Torrent::disconnectPeer(int sockfd) {
+  PeerConnection* conn = nPeers.find(sockfd);
+  if (conn == NULL) {
+    return;
+  }
+
+  nLoop->remove(sockfd);
+  close(sockfd);
+
+  nPicker->abortPeer(sockfd);
+
+  if (conn->snubTimer != 0) {
+    nLoop->cancel(conn->snubTimer);
+  }
+  if (conn->keepAliveTimer != 0) {
+    nLoop->cancel(conn->keepAliveTimer);
+  }
+
+  // a tracker that still lists the peer gets it reconnected
+  nPeerRegistry.setSocket(conn->peerId, PeerRegistry::NO_SOCKET);
+  if (nTrackers != NULL) {
+    nTrackers->forget(nPeerRegistry.getEndpoint(conn->peerId));
+  }
+  nPeers.remove(sockfd);
+}
+
+/*
+ * The peer's ip:port, for messages.
+ */
+string Torrent::getAddress(const PeerConnection& peer) const {
+  const PeerEndpoint& endpoint = nPeerRegistry.getEndpoint(peer.peerId);
+  return endpoint.getIp() + ":" + to_string(endpoint.getPort());
+}
+
+/*
+ * Periodic choker round: unchokes up to UNCHOKE_SLOTS interested peers,
+ * chokes the rest, and tops up interest and request pipelines.
+ */
+void Torrent::chokerRound() {
+  size_t slots = UNCHOKE_SLOTS;
+
+  PeerTable::const_iterator iter = nPeers.begin();
+  for (; iter != nPeers.end(); iter++) {
+    PeerConnection& peer = **iter;
+
+    bool unchoke = peer.peerInterested && slots > 0;
+    if (unchoke) {
+      slots--;
+    }
+
+    if (unchoke && peer.amChoking) {
+      sendUnchoke(peer);
+    } else if (!unchoke && !peer.amChoking) {
+      sendChoke(peer);
+    }
+  }
+
+  nitroConnect();
+
+  nChokerTimer = nLoop->schedule(CHOKER_INTERVAL, [this] { chokerRound(); });
+}
+
+/*
+ * This connect function has flames painted on it so it goes faster
+ */
+int Torrent::nitroConnect() {
+    // Loop through the list of peers you're connected to
+    PeerTable::const_iterator iter = nPeers.begin();
+    for (; iter != nPeers.end(); iter++) {
+      PeerConnection& peer = **iter;
+      if (peer.phase == PeerConnection::PHASE_HANDSHAKE) {
+        continue;
+      }
+
+      // Send an interested to every peer you're connected to, once
+      if (!peer.amInterested) {
+        sendInterested(peer);
+      }
+
+      // If the peer is unchoked, then send a request for a piece you don't have
+      if (!peer.peerChoking) {
+        sendRequest(peer);
+      }
+    }
+
+    return 0;
+}
+
+/*
+ * Sends a keep-alive if nothing else went to the peer during the last
+ * KEEPALIVE_INTERVAL, then re-arms itself.
+ */
+void Torrent::keepAlive(int sockfd) {
+  PeerConnection& peer = *nPeers.find(sockfd);
+  if (util::steadyNow() - peer.lastSent >= KEEPALIVE_INTERVAL) {
+    sendWire(peer, msg::wire::KEEP_ALIVE, sizeof(msg::wire::KEEP_ALIVE));
+  }
+
+  peer.keepAliveTimer = nLoop->schedule(KEEPALIVE_INTERVAL, [this, sockfd] {
+    keepAlive(sockfd);
+  });
+}
+
+int Torrent::createConnection(string ip, uint16_t port, int &sockfd) {
+    // Create a non-blocking socket using TCP IP
+    sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (sockfd == -1) {
+      fprintf(stderr, "Failed to create a socket: %s\n", strerror(errno));
+      return RC_CLIENT_CONNECTION_FAILED;
+    }
+
+    // Connect to server using tracker's port
+    struct sockaddr_in serverAddr;
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(port);
+    serverAddr.sin_addr.s_addr = inet_addr(ip.c_str());
+    memset(serverAddr.sin_zero, '\0', sizeof(serverAddr.sin_zero));
+
+    fprintf(stderr, "Peer I am connecting to has port of %d\n", port);
+
+    // Start connecting to the server; it is done, or has failed, once the
+    // socket turns writable
+    if (connect(sockfd, (struct sockaddr*) &serverAddr, sizeof(serverAddr)) == -1 &&
+        errno != EINPROGRESS) {
+      fprintf(stderr, "Failed to connect to peer port: %d\n", port);
+      return RC_TRACKER_CONNECTION_FAILED;
+    }
+
+    return 0;
+}
+
+/*
+ * Queues a message for the peer. Everything queued for it goes out in one
+ * sendmsg on the next writable event, so the HAVEs, interesteds and
+ * requests of a round share a syscall with the next piece.
+ */
+int Torrent::sendPayload(PeerConnection& peer, msg::MsgBase& payload) {
+  peer.output.push(payload.encode());
+  armWrite(peer);
+  return 0;
+}
+
+/*
+ * Queues a Piece whose block stays where it was read to, so it goes out
+ * without being copied into the message.
+ */
+int Torrent::sendBlock(PeerConnection& peer, unsigned int index, unsigned int begin,
+                       const BufferView& block) {
+  uint8_t header[msg::wire::MAX_LENGTH];
+  size_t length = msg::wire::encodePieceHeader(header, index, begin, block.size());
+
+  // tagged, so that a Cancel can take it back until it starts going out
+  uint64_t tag = getUploadTag(index, begin, block.size());
+  peer.output.pushCopy(header, length, tag);
+  peer.output.push(block, tag);
+  armWrite(peer);
+  return 0;
+}
+
+/*
+ * Names a block we upload, from its offset in the file and its length.
+ * Never 0, which is what untagged messages use.
+ */
+uint64_t Torrent::getUploadTag(unsigned int index, unsigned int begin,
+                               unsigned int length) const {
+  uint64_t offset = (uint64_t)index * nInfo->getPieceLength() + begin;
+  return ((offset << 14) | (length - 1)) + 1;
+}
+
+/*
+ * Queues a message already in wire form, pre-encoded or encoded on the
+ * stack; the queue keeps a copy.
+ */
+int Torrent::sendWire(PeerConnection& peer, const uint8_t* wire, size_t length) {
+  peer.output.pushCopy(wire, length);
+  armWrite(peer);
+  return 0;
+}
+
+/*
+ * Something was queued for the peer: watch for its socket to be writable.
+ */
+void Torrent::armWrite(PeerConnection& peer) {
+  if (!(peer.events & EPOLLOUT)) {
+    peer.events |= EPOLLOUT;
+    nLoop->modify(peer.sockfd, peer.events);
+  }
+
+  peer.lastSent = util::steadyNow();
+}
+
+void Torrent::flushPeer(PeerConnection& peer) {
+  ssize_t rc = peer.output.flush(peer.sockfd);
+  if (rc < 0 && rc != -EAGAIN) {
+    fprintf(stderr, "Failed to send payload to peer %s\n", getAddress(peer).c_str());
+    disconnectPeer(peer.sockfd);
+    return;
+  }
+
+  // all out, stop asking for writable events until there is more
+  if (peer.output.empty()) {
+    peer.events &= ~EPOLLOUT;
+    nLoop->modify(peer.sockfd, peer.events);
+  }
+}
+
+/*
+ * Generic function for handling all incoming messages received
+ * by the client. Differentiates between handshakes and any
+ * other kind of message, and takes appropriate actions to respond.
+ */
+struct Torrent::PeerMessages {
+  Torrent& torrent;
+  PeerConnection& peer;
+  // whether this is the peer's first message, the only one that may be a bitfield
+  bool isFirst;
+  bool isOutOfOrder;
+
+  void onKeepAlive() {
+    // receiving it was all it was for, the bitfield may still come
+    if (isFirst) {
+      peer.phase = PeerConnection::PHASE_BITFIELD;
+    }
+  }
+
+  void onChoke() {
+    // outstanding requests are discarded by a choking peer
+    peer.peerChoking = true;
+    torrent.nPicker->abortPeer(peer.sockfd);
+    torrent.armSnubTimer(peer);
+  }
+
+  void onUnchoke() {
+    torrent.handleUnchoke(peer);
+  }
+
+  void onInterested() {
+    // the next choker round decides whether to unchoke
+    peer.peerInterested = true;
+  }
+
+  void onNotInterested() {
+    peer.peerInterested = false;
+  }
+
+  void onHave(uint32_t index) {
+    torrent.handleHave(peer, index);
+  }
+
+  void onBitfield(const BufferView& bitfield) {
+    if (!isFirst) {
+      isOutOfOrder = true;
+      return;
+    }
+    torrent.handleBitfield(peer, bitfield);
+  }
+
+  void onRequest(uint32_t index, uint32_t begin, uint32_t length) {
+    torrent.handleRequest(peer, index, begin, length);
+  }
+
+  void onPiece(uint32_t index, uint32_t begin, const BufferView& block) {
+    torrent.handlePiece(peer, index, begin, block);
+  }
+
+  void onCancel(uint32_t index, uint32_t begin, uint32_t length) {
+    torrent.handleCancel(peer, index, begin, length);
+  }
+
+  void onPort(uint16_t port) {
+  }
+};
+
+/*
+ * Handles one framed message from the peer, decoded straight into a call
+ * on PeerMessages. A peer that sends a malformed message, or a bitfield
+ * anywhere but first, is dropped.
+ */
+int Torrent::parseMessage(PeerConnection& peer, const BufferView& msg) {
+  PeerMessages handler = {*this, peer, peer.phase == PeerConnection::PHASE_BITFIELD, false};
+  peer.phase = PeerConnection::PHASE_TRANSFER;
+
+  if (!msg::dispatch(msg, handler) || handler.isOutOfOrder) {
+    fprintf(stderr, "Malformed message from peer %s\n", getAddress(peer).c_str());
+    disconnectPeer(peer.sockfd);
+    return RC_MALFORMED_MESSAGE;
+  }
+
+  return 0;
+}
+
+int Torrent::sendBitfield(PeerConnection& peer) {
+  ConstBufferPtr msg = make_shared<sbt::Buffer>(nBitfield, nFieldSize);
+  msg::Bitfield bitfield_msg = msg::Bitfield(msg);
+  sendPayload(peer, bitfield_msg);
+
+  return 0;
+}
+
+int Torrent::sendRequest(PeerConnection& peer) {
+  if (peer.bitfield.empty()) {
+    // some error for empty bitfield
+    cout << "peer does not have anything" << endl;
+    return 0;
+  }
+
+  // Top the pipeline up to PIPELINE_DEPTH blocks. Once everything left has been
+  // requested somewhere the picker hands out duplicates (endgame mode).
+  int sockfd = peer.sockfd;
+  size_t outstanding = nPicker->getOutstanding(sockfd);
+  if (outstanding >= peer.pipeline) {
+    return 0;
+  }
+
+  vector<PiecePicker::Block> blocks =
+    nPicker->pick(peer.bitfield.data(), nFieldSize, sockfd, peer.pipeline - outstanding);
+  vector<PiecePicker::Block>::iterator it = blocks.begin();
+  for (; it != blocks.end(); it++) {
+    cout << "Requesting piece " << it->index << " block " << it->begin
+         << (nPicker->isEndgame() ? " (endgame)" : "") << endl;
+
+    uint8_t request[msg::wire::MAX_LENGTH];
+    size_t length = msg::wire::encodeRequest(request, it->index, it->begin, it->length);
+    sendWire(peer, request, length);
+  }
+
+  if (!blocks.empty() && peer.snubTimer == 0) {
+    armSnubTimer(peer);
+  }
+
+  return 0;
+}
+
+int Torrent::sendInterested(PeerConnection& peer) {
+  sendWire(peer, msg::wire::INTERESTED, sizeof(msg::wire::INTERESTED));
+
+  peer.amInterested = true;
+  return 0;
+}
+
+int Torrent::sendHave(PeerConnection& peer, unsigned int index) {
+  uint8_t have[msg::wire::MAX_LENGTH];
+  size_t length = msg::wire::encodeHave(have, index);
+  sendWire(peer, have, length);
+
+  return 0;
+}
+
+int Torrent::sendCancel(int sockfd, const PiecePicker::Block& block) {
+  uint8_t cancel[msg::wire::MAX_LENGTH];
+  size_t length = msg::wire::encodeCancel(cancel, block.index, block.begin, block.length);
+  sendWire(*nPeers.find(sockfd), cancel, length);
+
+  return 0;
+}
+
+int Torrent::sendUnchoke(PeerConnection& peer) {
+  sendWire(peer, msg::wire::UNCHOKE, sizeof(msg::wire::UNCHOKE));
+
+  peer.amChoking = false;
+  return 0;
+}
+
+int Torrent::sendChoke(PeerConnection& peer) {
+  sendWire(peer, msg::wire::CHOKE, sizeof(msg::wire::CHOKE));
+
+  // a choked peer's requests are dropped, it asks again once unchoked
+  peer.amChoking = true;
+  peer.uploads.clear();
+  return 0;
+}
+
+
+/*
+ * Takes the peer's handshake off the front of its receive buffer and sends
+ * our bitfield. A peer that answers for another torrent is dropped.
+ */
+bool Torrent::handleHandshake(PeerConnection& peer) {
+  msg::HandShake handshake;
+  handshake.decode(make_shared<sbt::Buffer>(peer.input.data(), HANDSHAKE_LENGTH));
+  if (*handshake.getInfoHash() != *nInfoHash) {
+    fprintf(stderr, "Peer %s sent no handshake\n", getAddress(peer).c_str());
+    disconnectPeer(peer.sockfd);
+    return false;
+  }
+  peer.input.consume(HANDSHAKE_LENGTH);
+  fprintf(stderr, "The peer's peer id is %s\n", (handshake.getPeerId()).c_str());
+
+  // done with the handshake timeout
+  if (peer.snubTimer != 0) {
+    nLoop->cancel(peer.snubTimer);
+    peer.snubTimer = 0;
+  }
+
+  peer.phase = PeerConnection::PHASE_BITFIELD;
+  sendBitfield(peer);
+  return true;
+}
+
+int Torrent::handleBitfield(PeerConnection& peer, const BufferView& bitfield) {
+  fprintf(stderr, "We are now handling the bitfield\n");
+
+  // Store a copy of the peer's bitfield, padded to the size of ours; the
+  // message itself is only a view into the receive buffer
+  peer.bitfield.assign(nFieldSize, 0);
+  memcpy(peer.bitfield.data(), bitfield.data(), min<size_t>(bitfield.size(), nFieldSize));
+
+  return 0;
+}
+
+int Torrent::handleHave(PeerConnection& peer, unsigned int index) {
+  if (index >= nPieceCount) {
+    return 0;
+  }
+
+  // a peer that had nothing may have skipped its bitfield
+  if (peer.bitfield.empty()) {
+    peer.bitfield.assign(nFieldSize, 0);
+  }
+  peer.bitfield[index / 8] |= 0x80 >> (index % 8);
+
+  if (nPicker->hasPiece(index)) {
+    return 0;
+  }
+  if (!peer.amInterested) {
+    sendInterested(peer);
+  }
+  if (!peer.peerChoking) {
+    sendRequest(peer);
+  }
+
+  return 0;
+}
+
+int Torrent::handleCancel(PeerConnection& peer, unsigned int index, unsigned int begin,
+                          unsigned int length) {
+  if (length == 0 || length > PiecePicker::BLOCK_SIZE) {
+    return 0;
+  }
+  uint64_t tag = getUploadTag(index, begin, length);
+
+  // still being read, or held back by the upload limit
+  vector<uint64_t>::iterator it = find(peer.uploads.begin(), peer.uploads.end(), tag);
+  if (it != peer.uploads.end()) {
+    peer.uploads.erase(it);
+    return 0;
+  }
+
+  // queued, but not started on
+  peer.output.cancel(tag);
+  return 0;
+}
+
+int Torrent::handlePiece(PeerConnection& peer, unsigned int index, unsigned int begin,
+                         const BufferView& data) {
+  PiecePicker::Block block;
+  block.index = index;
+  block.begin = begin;
+  block.length = data.size();
+
+  // In endgame the same block may be outstanding at several peers, cancel
+  // it everywhere except where it just came from
+  vector<int> cancels;
+  PiecePicker::ReceiveResult received = nPicker->markReceived(block, peer.sockfd, cancels);
+  if (received == PiecePicker::RECEIVE_REJECTED) {
+    // not ours to write, whatever the peer meant by it
+    return 0;
+  }
+  vector<int>::iterator cit = cancels.begin();
+  for (; cit != cancels.end(); cit++) {
+    sendCancel(*cit, block);
+  }
+
+  // a block got through, let a snubbed peer climb back up to a full pipeline
+  peer.isSnubbed = false;
+  if (peer.pipeline < PIPELINE_DEPTH) {
+    peer.pipeline++;
+  }
+  peer.downloaded += block.length;
+
+  // the write may complete after later blocks' writes, so a finished piece
+  // is verified once the last of its writes has landed
+  uint64_t offset = (uint64_t)index * nInfo->getPieceLength() + block.begin;
+  pendingWrites[index]++;
+  if (received == PiecePicker::RECEIVE_PIECE_DONE) {
+    awaitingVerify.insert(index);
+  }
+  // straight from the receive chunk, which the view keeps alive until then
+  nLoop->writeAt(nFileFd, data.data(), block.length, offset, [this, index, data] (ssize_t result) {
+    onBlockWritten(index, result);
+  });
+
+  // a requested block is what proves the peer alive; then keep the pipeline
+  // full rather than waiting for the next choker round
+  armSnubTimer(peer);
+  sendRequest(peer);
+
+  return 0;
+}
+
+void Torrent::onBlockWritten(unsigned int index, ssize_t result) {
+  if (result < 0) {
+    // the piece fails verification and is downloaded again
+    fprintf(stderr, "Failed to write to piece %d: %s\n", index, strerror(-result));
+  }
+
+  if (--pendingWrites[index] > 0) {
+    return;
+  }
+  pendingWrites.erase(index);
+
+  if (awaitingVerify.erase(index) > 0) {
+    verifyPiece(index, nPicker->getPieceLength(index));
+  }
+}
+
+/*
+ * Serves a block to a peer we have unchoked, straight from the file, as
+ * soon as the session's upload limit allows.
+ */
+int Torrent::handleRequest(PeerConnection& peer, unsigned int index, unsigned int begin,
+                           unsigned int length) {
+  if (peer.amChoking || !nPicker->hasPiece(index) || length == 0 ||
+      length > PiecePicker::BLOCK_SIZE) {
+    return 0;
+  }
+  // begin + length could wrap around
+  unsigned int pieceLength = nPicker->getPieceLength(index);
+  if (begin > pieceLength || length > pieceLength - begin) {
+    return 0;
+  }
+  peer.uploads.push_back(getUploadTag(index, begin, length));
+  uint64_t delay = nShard.getUploadLimiter().reserve(length);
+  if (delay == 0) {
+    serveBlock(peer.sockfd, peer.serial, index, begin, length);
+    return 0;
+  }
+
+  int sockfd = peer.sockfd;
+  uint64_t serial = peer.serial;
+  nLoop->schedule(delay, [this, sockfd, serial, index, begin, length] {
+    // the peer may have gone, choked or cancelled in the meantime
+    PeerConnection* conn = nPeers.find(sockfd, serial);
+    if (conn != NULL && find(conn->uploads.begin(), conn->uploads.end(),
+                             getUploadTag(index, begin, length)) != conn->uploads.end()) {
+      serveBlock(sockfd, serial, index, begin, length);
+    }
+  });
+
+  return 0;
+}
+
+/*
+ * The socket and serial identify the peer rather than a reference, it may
+ * be gone by the time the block has been read.
+ */
+void Torrent::serveBlock(int sockfd, uint64_t serial, unsigned int index, unsigned int begin,
+                         unsigned int length) {
+  // a pooled block unless the pool is at its ceiling
+  util::SlabPool::Slab block = nShard.getBlockCache().acquire();
+  if (!block) {
+    shared_ptr<RawBuffer> buffer = make_shared<RawBuffer>(length);
+    block = util::SlabPool::Slab(buffer, buffer->data());
+  }
+
+  uint64_t offset = (uint64_t)index * nInfo->getPieceLength() + begin;
+  nLoop->readAt(nFileFd, block.get(), length, offset,
+    [this, sockfd, serial, index, begin, length, block] (ssize_t result) mutable {
+      PeerConnection* peer = nPeers.find(sockfd, serial);
+      if (peer == NULL) {
+        return;
+      }
+      // cancelled, or dropped when the peer got choked
+      vector<uint64_t>::iterator it =
+        find(peer->uploads.begin(), peer->uploads.end(), getUploadTag(index, begin, length));
+      if (it == peer->uploads.end()) {
+        return;
+      }
+      peer->uploads.erase(it);
+      if (result != (ssize_t)length) {
+        return;
+      }
+
+      if (sendBlock(*peer, index, begin, BufferView(block, block.get(), length)) == 0) {
+        nUploaded += length;
+        peer->uploaded += length;
+      }
+    });
+}
+
+int Torrent::handleUnchoke(PeerConnection& peer) {
+  fprintf(stderr, "We are now handling an unchoke message\n");
+
+  // Set peer status to unchoked so that we can begin sending requests
+  peer.peerChoking = false;
+  sendRequest(peer);
+  return 0;
+}
+
+/*
+ * Called by the event loop for every event on a peer socket.
+ */
+void Torrent::onPeerEvent(int sockfd, uint32_t events) {
+  PeerConnection* peer = nPeers.find(sockfd);
+
+  if (events & EPOLLOUT) {
+    flushPeer(*peer);
+
+    // the flush may have failed and dropped the peer
+    peer = nPeers.find(sockfd);
+    if (peer == NULL) {
+      return;
+    }
+  }
+
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+    onPeerReadable(*peer);
+  }
+}
+
+/*
+ * Receives whatever arrived straight into the peer's receive buffer and
+ * handles every complete length-prefixed message in place: none is copied
+ * on its way to parseMessage, nor are Piece blocks on their way to the disk.
+ */
+void Torrent::onPeerReadable(PeerConnection& peer) {
+  int sockfd = peer.sockfd;
+  util::ReceiveBuffer& input = peer.input;
+  ssize_t n = recv(sockfd, input.prepare(BUFFER_SIZE * 4), input.getFree(), 0);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return;
+  }
+  if (n <= 0) {
+    fprintf(stderr, "Peer %s disconnected\n", getAddress(peer).c_str());
+    disconnectPeer(sockfd);
+    return;
+  }
+
+  input.commit(n);
+
+  // a peer we connected to answers our handshake first
+  if (peer.phase == PeerConnection::PHASE_HANDSHAKE) {
+    if (input.size() < HANDSHAKE_LENGTH) {
+      return;
+    }
+    if (!handleHandshake(peer)) {
+      return;
+    }
+  }
+
+  // a Piece of one block, or our bitfield's worth, is the longest message
+  // a peer has any business sending
+  uint32_t maxLength = max<uint32_t>(9 + PiecePicker::BLOCK_SIZE, 1 + nFieldSize);
+
+  while (input.size() >= 4) {
+    uint32_t length = ntohl(*reinterpret_cast<const uint32_t*>(input.data()));
+    if (length > maxLength) {
+      fprintf(stderr, "Peer %s sent a %u byte message\n", getAddress(peer).c_str(), length);
+      disconnectPeer(sockfd);
+      return;
+    }
+    if (input.size() - 4 < length) {
+      // have the rest of a big message land in the same chunk
+      input.prepare(length + 4 - input.size());
+      break;
+    }
+
+    // done with the bytes before handling them, handling may drop the peer
+    // and its buffer with it; the view keeps them around until then
+    BufferView message = input.view(0, length + 4);
+    input.consume(length + 4);
+    parseMessage(peer, message);
+
+    // the message may have made us drop the peer
+    if (nPeers.find(sockfd) == NULL) {
+      return;
+    }
+  }
+}
+
+/*
+ * (Re)starts the countdown after which a peer that holds our requests and
+ * sends none of the blocks is considered snubbed; keep-alives and other
+ * messages don't count. Peers without outstanding requests don't need one.
+ */
+void Torrent::armSnubTimer(PeerConnection& peer) {
+  if (peer.snubTimer != 0) {
+    nLoop->cancel(peer.snubTimer);
+    peer.snubTimer = 0;
+  }
+
+  int sockfd = peer.sockfd;
+  if (nPicker->getOutstanding(sockfd) == 0) {
+    return;
+  }
+
+  peer.snubTimer = nLoop->schedule(SNUB_TIMEOUT, [this, sockfd] {
+    snubPeer(sockfd);
+  });
+}
+
+/*
+ * Marks a silent peer as snubbed, hands its outstanding blocks back to the
+ * picker so other peers can fetch them, and shrinks its pipeline to a single
+ * request until it proves itself again.
+ */
+void Torrent::snubPeer(int sockfd) {
+  PeerConnection& peer = *nPeers.find(sockfd);
+  peer.snubTimer = 0;
+
+  vector<PiecePicker::Block> aborted = nPicker->abortPeer(sockfd);
+  fprintf(stderr, "Peer %s snubbed, reassigning %d blocks\n",
+          getAddress(peer).c_str(), (int)aborted.size());
+
+  peer.isSnubbed = true;
+  peer.pipeline = 1;
+
+  // hand the blocks to the peers that can take them now, not at the next
+  // block or choker round
+  PeerTable::const_iterator iter = nPeers.begin();
+  for (; iter != nPeers.end() && !aborted.empty(); iter++) {
+    PeerConnection& other = **iter;
+    if (other.sockfd != sockfd && !other.peerChoking && !other.isSnubbed) {
+      sendRequest(other);
+    }
+  }
+}
+
+} // namespace sbt
@@ -0,0 +1,219 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2014,  Regents of the University of California
+ *
+ * This file is part of Simple BT.
+ * See AUTHORS.md for complete list of Simple BT authors and contributors.
+ *
+ * NSL is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NSL is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * NSL, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * \author Yingdi Yu <yingdi@cs.ucla.edu>
+ */
+
+#ifndef SBT_TORRENT_HPP
+#define SBT_TORRENT_HPP
+
+#define BUFFER_SIZE 4096
+#define PIECE_HASH  20
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include "common.hpp"
+#include "meta-info.hpp"
+#include "http/http-response.hpp"
+#include "util/hash.hpp"
+#include "msg/msg-base.hpp"
+#include "msg/handshake.hpp"
+#include "msg/dispatch.hpp"
+#include "tracker-response.hpp"
+#include "tracker-set.hpp"
+#include "piece-picker.hpp"
+#include "peer-connection.hpp"
+#include "peer-registry.hpp"
+#include "util/event-loop.hpp"
+
+// number of block requests kept in flight per unchoked peer
+#define PIPELINE_DEPTH 4
+
+// a peer holding our requests that stays silent this long is snubbed (ms)
+#define SNUB_TIMEOUT 60000
+
+// a peer we connect to that has not answered our handshake by then is dropped (ms)
+#define HANDSHAKE_TIMEOUT 60000
+#define HANDSHAKE_LENGTH 68
+
+// timer intervals (ms)
+#define KEEPALIVE_INTERVAL 120000
+#define CHOKER_INTERVAL 10000
+
+// number of interested peers we upload to at a time
+#define UNCHOKE_SLOTS 4
+
+using namespace std;
+
+namespace sbt {
+
+class Session;
+class Shard;
+
+/*
+ * One torrent of a Session: its file, pieces, trackers and peers. The
+ * event loop, disk pool and upload limiter belong to the shard the
+ * torrent is pinned to, and everything here runs on that shard's thread.
+ */
+class Torrent
+{
+public:
+  Torrent(Session& session, Shard& shard, const string& torrent);
+
+  ~Torrent();
+
+  ConstBufferPtr getHash() const;
+
+  int createConnection(string ip, uint16_t port, int &sockfd);
+  int start();
+
+  // takes over a connection the session accepted for this torrent
+  void addIncomingPeer(int sockfd, const string& ip, uint16_t port, msg::HandShake& handshake);
+  int sendUnchoke(PeerConnection& peer);
+  int sendChoke(PeerConnection& peer);
+
+private:
+  int fck();
+  void verifyPiece(unsigned int index, int length);
+  void onPieceVerified(unsigned int index, int length, bool valid);
+  static bool checkPiece(const string& file, uint64_t offset, int length,
+                         const vector<uint8_t>& expected, util::SlabPool& piecePool);
+  int parseMessage(PeerConnection& peer, const BufferView& msg);
+  void initBitfield();
+
+  unsigned int nPieceCount;
+  int nDownloaded = 0;
+  int nUploaded = 0;
+  int nRemaining = 0;
+
+  // the best function I have ever written
+  int nitroConnect();
+
+  // tracker- and timer-driven parts of the event loop
+  AnnounceRequest nextRequest(const TrackerSet::Tracker& tracker);
+  void onPeers(const vector<PeerEndpoint>& endpoints);
+  void chokerRound();
+  void keepAlive(int sockfd);
+
+  // peer connection bookkeeping
+  int connectPeer(PeerRegistry::PeerId id);
+  PeerConnection& addPeer(int sockfd, PeerRegistry::PeerId id);
+  void disconnectPeer(int sockfd);
+  string getAddress(const PeerConnection& peer) const;
+
+  int sendPayload(PeerConnection& peer, msg::MsgBase& payload);
+  int sendBlock(PeerConnection& peer, unsigned int index, unsigned int begin,
+                const BufferView& block);
+  int sendWire(PeerConnection& peer, const uint8_t* wire, size_t length);
+  void armWrite(PeerConnection& peer);
+  uint64_t getUploadTag(unsigned int index, unsigned int begin, unsigned int length) const;
+
+  // functions for sending messages
+  int sendBitfield(PeerConnection& peer);
+  int sendRequest(PeerConnection& peer);
+  int sendInterested(PeerConnection& peer);
+  int sendHave(PeerConnection& peer, unsigned int index);
+  int sendCancel(int sockfd, const PiecePicker::Block& block);
+
+  // functions for dealing with messages
+  bool handleHandshake(PeerConnection& peer);
+  int handleBitfield(PeerConnection& peer, const BufferView& bitfield);
+  int handlePiece(PeerConnection& peer, unsigned int index, unsigned int begin,
+                  const BufferView& data);
+  void onBlockWritten(unsigned int index, ssize_t result);
+  int handleUnchoke(PeerConnection& peer);
+  int handleRequest(PeerConnection& peer, unsigned int index, unsigned int begin,
+                    unsigned int length);
+  int handleHave(PeerConnection& peer, unsigned int index);
+  int handleCancel(PeerConnection& peer, unsigned int index, unsigned int begin,
+                   unsigned int length);
+
+  // handler of msg::dispatch, calls the above for one peer's messages
+  struct PeerMessages;
+  void serveBlock(int sockfd, uint64_t serial, unsigned int index, unsigned int begin,
+                  unsigned int length);
+
+  // functions for receiving messages
+  void onPeerEvent(int sockfd, uint32_t events);
+  void onPeerReadable(PeerConnection& peer);
+  void flushPeer(PeerConnection& peer);
+
+  // snubbed peer detection
+  void armSnubTimer(PeerConnection& peer);
+  void snubPeer(int sockfd);
+
+  char getBit(char* array, int index);
+
+  uint8_t getBit(uint8_t* array, int index);
+
+  string nPort;
+  string nPeerId;
+  uint8_t* nBitfield;
+  ssize_t nFieldSize;
+
+  // our connections, from the connect or accept on, found by socket
+  PeerTable nPeers;
+
+  // every peer we have heard of, and the socket of those we are connected to
+  PeerRegistry nPeerRegistry;
+
+  Session& nSession;
+  Shard& nShard;
+  MetaInfo* nInfo;
+  ConstBufferPtr nInfoHash;
+  TrackerSet* nTrackers;
+  PiecePicker* nPicker;
+
+  // the shard's, shared with the other torrents pinned to it
+  util::EventLoop* nLoop;
+  util::TimerWheel::TimerId nChokerTimer;
+
+  // the downloaded file, written and read through the loop
+  int nFileFd;
+
+  // piece-sized buffers for verifying; shared with the disk jobs using it
+  shared_ptr<util::SlabPool> nPiecePool;
+
+  // block writes still in flight per piece, and finished pieces waiting
+  // for them before they can be verified
+  map<unsigned int, int> pendingWrites;
+  set<unsigned int> awaitingVerify;
+};
+
+} // namespace sbt
+
+#endif // SBT_TORRENT_HPP
@@ -0,0 +1,286 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "tracker-connection.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <errno.h>
+#include <stdio.h>
+
+namespace sbt {
+
+// how long a whole announce may take before we give up on the tracker (ms)
+static const uint64_t TRACKER_TIMEOUT = 30000;
+
+TrackerConnection::TrackerConnection(util::EventLoop& loop, util::Resolver& resolver,
+                                     const std::string& host, const std::string& port)
+  : m_loop(loop)
+  , m_resolver(resolver)
+  , m_host(host)
+  , m_port(port)
+  , m_sockfd(-1)
+  , m_nConnects(0)
+  , m_state(STATE_IDLE)
+  , m_nSent(0)
+  , m_timer(0)
+  , m_generation(0)
+  , m_isReused(false)
+{
+}
+
+TrackerConnection::~TrackerConnection()
+{
+  disconnect();
+}
+
+void
+TrackerConnection::announce(const std::string& request, const Callback& callback)
+{
+  if (isBusy())
+    disconnect();
+
+  m_request = request;
+  m_callback = callback;
+  m_timer = m_loop.schedule(TRACKER_TIMEOUT, [this] {
+    m_timer = 0;
+    fprintf(stderr, "Tracker at port %s timed out\n", m_port.c_str());
+    closeSocket();
+    complete(RC_NO_TRACKER_RESPONSE);
+  });
+
+  m_isReused = isConnected();
+  if (m_isReused) {
+    m_nSent = 0;
+    m_reader.reset();
+    m_state = STATE_SENDING;
+    m_loop.modify(m_sockfd, EPOLLOUT);
+  }
+  else
+    resolve();
+}
+
+void
+TrackerConnection::disconnect()
+{
+  closeSocket();
+
+  if (m_timer != 0) {
+    m_loop.cancel(m_timer);
+    m_timer = 0;
+  }
+  m_callback = nullptr;
+  m_state = STATE_IDLE;
+  m_generation++;
+}
+
+void
+TrackerConnection::resolve()
+{
+  m_state = STATE_RESOLVING;
+
+  uint64_t generation = m_generation;
+  m_resolver.resolve(m_host, m_port, [this, generation] (int rc, const sockaddr_storage& addr,
+                                                         socklen_t length) {
+    if (generation != m_generation || m_state != STATE_RESOLVING)
+      return; // abandoned meanwhile
+
+    if (rc != 0) {
+      fprintf(stderr, "Error getting address info: %s\n", gai_strerror(rc));
+      complete(RC_GET_ADDRESS_INFO_FAILED);
+      return;
+    }
+    connect(addr, length);
+  });
+}
+
+void
+TrackerConnection::connect(const sockaddr_storage& addr, socklen_t length)
+{
+  m_nSent = 0;
+  m_reader.reset();
+
+  m_sockfd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (m_sockfd < 0) {
+    complete(RC_TRACKER_CONNECTION_FAILED);
+    return;
+  }
+
+  // requests are small and we wait for the answer, don't let Nagle hold them back
+  int yes = 1;
+  setsockopt(m_sockfd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+  if (::connect(m_sockfd, (const struct sockaddr*) &addr, length) != 0 && errno != EINPROGRESS) {
+    fprintf(stderr, "Failed to connect to tracker port: %s\n", m_port.c_str());
+    closeSocket();
+    complete(RC_TRACKER_CONNECTION_FAILED);
+    return;
+  }
+
+  // completion of the connect is reported as writability
+  m_state = STATE_CONNECTING;
+  m_loop.add(m_sockfd, EPOLLOUT, [this] (uint32_t events) { onEvent(events); });
+}
+
+void
+TrackerConnection::onEvent(uint32_t events)
+{
+  switch (m_state) {
+  case STATE_IDLE:
+    onIdleReadable();
+    break;
+
+  case STATE_CONNECTING: {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(m_sockfd, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0) {
+      fprintf(stderr, "Failed to connect to tracker port: %s\n", m_port.c_str());
+      closeSocket();
+      complete(RC_TRACKER_CONNECTION_FAILED);
+      return;
+    }
+
+    m_nConnects++;
+    m_state = STATE_SENDING;
+    onWritable();
+    break;
+  }
+
+  case STATE_SENDING:
+    onWritable();
+    break;
+
+  case STATE_RECEIVING:
+    onReadable();
+    break;
+
+  case STATE_RESOLVING:
+    break;
+  }
+}
+
+void
+TrackerConnection::onIdleReadable()
+{
+  // an idle tracker has nothing to say, this is it closing the connection
+  char buf[64];
+  ssize_t n = recv(m_sockfd, buf, sizeof(buf), 0);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    return;
+
+  closeSocket();
+}
+
+void
+TrackerConnection::onWritable()
+{
+  while (m_nSent < m_request.size()) {
+    ssize_t n = send(m_sockfd, m_request.data() + m_nSent, m_request.size() - m_nSent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return;
+
+      fprintf(stderr, "Failed to send GET request to tracker at port: %s\n", m_port.c_str());
+      fail(RC_SEND_GET_REQUEST_FAILED);
+      return;
+    }
+    m_nSent += n;
+  }
+
+  m_state = STATE_RECEIVING;
+  m_loop.modify(m_sockfd, EPOLLIN);
+}
+
+void
+TrackerConnection::onReadable()
+{
+  try {
+    while (true) {
+      char buf[4096];
+      ssize_t n = recv(m_sockfd, buf, sizeof(buf), 0);
+      if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+          return;
+        fail(RC_NO_TRACKER_RESPONSE);
+        return;
+      }
+
+      if (n == 0) {
+        if (m_reader.getStatusCode().empty()) {
+          // closed without a word, as a tracker dropping an idle connection does
+          fail(RC_NO_TRACKER_RESPONSE);
+          return;
+        }
+        m_reader.finish();
+        closeSocket();
+        complete(0);
+        return;
+      }
+
+      m_reader.feed(buf, n);
+      if (m_reader.isComplete()) {
+        if (!m_reader.isKeepAlive())
+          closeSocket();
+        complete(0);
+        return;
+      }
+    }
+  }
+  catch (ParseError& e) {
+    fprintf(stderr, "Bad tracker response: %s\n", e.what());
+    closeSocket();
+    complete(RC_NO_TRACKER_RESPONSE);
+  }
+}
+
+void
+TrackerConnection::fail(int rc)
+{
+  closeSocket();
+
+  // the tracker may have dropped the idle connection, try once more on a new one
+  if (m_isReused) {
+    m_isReused = false;
+    resolve();
+    return;
+  }
+
+  complete(rc);
+}
+
+void
+TrackerConnection::complete(int rc)
+{
+  if (m_timer != 0) {
+    m_loop.cancel(m_timer);
+    m_timer = 0;
+  }
+
+  m_state = STATE_IDLE;
+  if (m_sockfd >= 0)
+    m_loop.modify(m_sockfd, EPOLLIN); // to notice the tracker closing it
+
+  Callback callback;
+  callback.swap(m_callback);
+  if (callback)
+    callback(rc, m_reader);
+}
+
+void
+TrackerConnection::closeSocket()
+{
+  if (m_sockfd >= 0) {
+    m_loop.remove(m_sockfd);
+    close(m_sockfd);
+    m_sockfd = -1;
+  }
+}
+
+} // namespace sbt
@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_TRACKER_CONNECTION_HPP
+#define SBT_TRACKER_CONNECTION_HPP
+
+#include "common.hpp"
+#include "http/http-response-reader.hpp"
+#include "util/event-loop.hpp"
+#include "util/resolver.hpp"
+
+namespace sbt {
+
+/**
+ * @brief Persistent HTTP/1.1 connection to a tracker, driven by the event loop
+ *
+ * An announce runs as a non-blocking state machine: resolve (through the Resolver's
+ * cache), connect, send, receive.  The TCP connection is kept for the following
+ * announces, so each one costs a single round trip.  If the tracker closed an idle
+ * connection in the meantime the request is transparently retried on a fresh one.
+ */
+class TrackerConnection
+{
+public:
+  /**
+   * @param rc      0 on success or one of the RC_* codes
+   * @param reader  the parsed response and its body
+   */
+  typedef function<void(int rc, const HttpResponseReader& reader)> Callback;
+
+public:
+  TrackerConnection(util::EventLoop& loop, util::Resolver& resolver,
+                    const std::string& host, const std::string& port);
+
+  ~TrackerConnection();
+
+  /**
+   * @brief Send @p request and call @p callback with the response
+   *
+   * Returns immediately; an announce still in flight is abandoned.
+   */
+  void
+  announce(const std::string& request, const Callback& callback);
+
+  /**
+   * @brief Close the connection and abandon the announce in flight, if any
+   */
+  void
+  disconnect();
+
+  bool
+  isConnected() const
+  {
+    return m_sockfd >= 0 && m_state != STATE_CONNECTING;
+  }
+
+  bool
+  isBusy() const
+  {
+    return m_state != STATE_IDLE;
+  }
+
+  /**
+   * @brief Number of TCP connections opened so far
+   */
+  size_t
+  getConnectCount() const
+  {
+    return m_nConnects;
+  }
+
+private:
+  enum State {
+    STATE_IDLE,
+    STATE_RESOLVING,
+    STATE_CONNECTING,
+    STATE_SENDING,
+    STATE_RECEIVING
+  };
+
+  void
+  resolve();
+
+  void
+  connect(const sockaddr_storage& addr, socklen_t length);
+
+  void
+  onEvent(uint32_t events);
+
+  void
+  onIdleReadable();
+
+  void
+  onWritable();
+
+  void
+  onReadable();
+
+  /**
+   * @brief Give up on the current connection, retrying once if it was a reused one
+   */
+  void
+  fail(int rc);
+
+  void
+  complete(int rc);
+
+  void
+  closeSocket();
+
+private:
+  util::EventLoop& m_loop;
+  util::Resolver& m_resolver;
+  std::string m_host;
+  std::string m_port;
+  int m_sockfd;
+  size_t m_nConnects;
+
+  State m_state;
+  std::string m_request;
+  size_t m_nSent;
+  HttpResponseReader m_reader;
+  Callback m_callback;
+  util::TimerWheel::TimerId m_timer;
+  uint64_t m_generation; // invalidates stale resolver callbacks
+  bool m_isReused;
+};
+
+} // namespace sbt
+
+#endif // SBT_TRACKER_CONNECTION_HPP
@@ -22,6 +22,9 @@
 #include "tracker-response.hpp"
 #include "util/buffer-stream.hpp"
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
 namespace sbt {
 
 const std::string PeerInfo::PEER_ID("peer id");
@@ -31,6 +34,41 @@ const std::string PeerInfo::PORT("port");
 const std::string TrackerResponse::FAILURE("failure");
 const std::string TrackerResponse::INTERVAL("interval");
 const std::string TrackerResponse::PEERS("peers");
+const std::string TrackerResponse::PEERS6("peers6");
+
+size_t
+PeerEndpoint::toSockaddr(struct sockaddr_storage& ss) const
+{
+  memset(&ss, 0, sizeof(ss));
+
+  if (family == AF_INET6) {
+    struct sockaddr_in6* sin6 = reinterpret_cast<struct sockaddr_in6*>(&ss);
+    sin6->sin6_family = AF_INET6;
+    sin6->sin6_port = port;
+    memcpy(&sin6->sin6_addr, addr, 16);
+    return sizeof(struct sockaddr_in6);
+  }
+
+  struct sockaddr_in* sin = reinterpret_cast<struct sockaddr_in*>(&ss);
+  sin->sin_family = AF_INET;
+  sin->sin_port = port;
+  memcpy(&sin->sin_addr, addr, 4);
+  return sizeof(struct sockaddr_in);
+}
+
+std::string
+PeerEndpoint::getIp() const
+{
+  char ip[INET6_ADDRSTRLEN];
+  inet_ntop(family, addr, ip, sizeof(ip));
+  return ip;
+}
+
+uint16_t
+PeerEndpoint::getPort() const
+{
+  return ntohs(port);
+}
 
 shared_ptr<bencoding::Dictionary>
 PeerInfo::encode()
@@ -112,10 +150,35 @@ TrackerResponse::encode()
   return dict;
 }
 
+void
+TrackerResponse::decodeCompact(const uint8_t* peers, size_t size, uint16_t family,
+                               std::vector<PeerEndpoint>& endpoints)
+{
+  size_t addrLength = family == AF_INET6 ? 16 : 4;
+  size_t entryLength = addrLength + 2;
+
+  if (size % entryLength != 0)
+    throw TrackerResponse::Error("Compact peer list has a partial entry");
+
+  const uint8_t* entry = peers;
+  const uint8_t* end = entry + size;
+
+  endpoints.reserve(endpoints.size() + size / entryLength);
+  for (; entry != end; entry += entryLength) {
+    PeerEndpoint endpoint;
+    endpoint.family = family;
+    memcpy(endpoint.addr, entry, addrLength);
+    memset(endpoint.addr + addrLength, 0, sizeof(endpoint.addr) - addrLength);
+    memcpy(&endpoint.port, entry + addrLength, 2);
+    endpoints.push_back(endpoint);
+  }
+}
+
 void
 TrackerResponse::decode(const bencoding::Dictionary& response)
 {
   m_peers.clear();
+  m_endpoints.clear();
 
   auto failure = response.get(FAILURE);
   if (static_cast<bool>(failure)) {
@@ -132,15 +195,38 @@ TrackerResponse::decode(const bencoding::Dictionary& response)
       throw TrackerResponse::Error("No interval in positive tracker response ");
 
     auto peers = response.get(PEERS);
-    if (static_cast<bool>(peers)) {
+    auto peers6 = response.get(PEERS6);
+    if (!static_cast<bool>(peers) && !static_cast<bool>(peers6))
+      throw TrackerResponse::Error("No peers in positive tracker response");
+
+    if (static_cast<bool>(peers) && peers->getType() == bencoding::TYPE_STRING) {
+      // compact form: 4 bytes of address and 2 of port per peer
+      const std::vector<uint8_t>& compact = dynamic_pointer_cast<bencoding::String>(peers)->getValue();
+      decodeCompact(compact.data(), compact.size(), AF_INET, m_endpoints);
+    }
+    else if (static_cast<bool>(peers)) {
       for (auto peer : *dynamic_pointer_cast<bencoding::List>(peers)) {
         PeerInfo info;
         info.decode(*dynamic_pointer_cast<const bencoding::Dictionary>(peer));
         m_peers.push_back(info);
+
+        PeerEndpoint endpoint;
+        memset(&endpoint, 0, sizeof(endpoint));
+        endpoint.port = htons(info.port);
+        if (inet_pton(AF_INET, info.ip.c_str(), endpoint.addr) == 1)
+          endpoint.family = AF_INET;
+        else if (inet_pton(AF_INET6, info.ip.c_str(), endpoint.addr) == 1)
+          endpoint.family = AF_INET6;
+        else
+          continue; // a host name, only available through getPeers()
+        m_endpoints.push_back(endpoint);
       }
     }
-    else
-      throw TrackerResponse::Error("No peers in positive tracker response");
+
+    if (static_cast<bool>(peers6) && peers6->getType() == bencoding::TYPE_STRING) {
+      const std::vector<uint8_t>& compact = dynamic_pointer_cast<bencoding::String>(peers6)->getValue();
+      decodeCompact(compact.data(), compact.size(), AF_INET6, m_endpoints);
+    }
   }
 }
 
@@ -25,9 +25,36 @@
 #include "util/buffer.hpp"
 #include "util/bencoding.hpp"
 #include <vector>
+#include <sys/socket.h>
 
 namespace sbt {
 
+/**
+ * @brief Binary peer address as carried by compact peer lists (BEP 23)
+ *
+ * Laid out like a trimmed-down sockaddr so a whole peer list decodes into one
+ * contiguous array without a string per peer.
+ */
+struct PeerEndpoint
+{
+  uint16_t family;  // AF_INET or AF_INET6
+  uint16_t port;    // network byte order
+  uint8_t addr[16]; // network byte order, IPv4 uses the first 4 bytes
+
+  /**
+   * @brief Fill @p ss with a sockaddr_in or sockaddr_in6
+   * @returns size of the address written
+   */
+  size_t
+  toSockaddr(struct sockaddr_storage& ss) const;
+
+  std::string
+  getIp() const;
+
+  uint16_t
+  getPort() const;
+};
+
 class PeerInfo
 {
 public:
@@ -89,27 +116,51 @@ public:
   void
   addPeer(const PeerInfo& peer);
 
+  /**
+   * @brief Peers from the dictionary form of the peer list
+   */
   const std::vector<PeerInfo>&
   getPeers() const
   {
     return m_peers;
   }
 
+  /**
+   * @brief Every peer in the response, compact (peers and peers6) or not
+   */
+  const std::vector<PeerEndpoint>&
+  getEndpoints() const
+  {
+    return m_endpoints;
+  }
+
   shared_ptr<bencoding::Dictionary>
   encode();
 
   void
   decode(const bencoding::Dictionary& response);
 
+  /**
+   * @brief Append the peers of a compact peer list to @p endpoints
+   *
+   * Used by both the HTTP (BEP 23) and the UDP (BEP 15) tracker protocols.
+   * @throws Error if the list ends with a partial entry
+   */
+  static void
+  decodeCompact(const uint8_t* peers, size_t size, uint16_t family,
+                std::vector<PeerEndpoint>& endpoints);
+
 private:
   static const std::string FAILURE;
   static const std::string INTERVAL;
   static const std::string PEERS;
+  static const std::string PEERS6;
 
   bool m_isFailure;
   std::string m_failure;
   uint64_t m_interval; // seconds
   std::vector<PeerInfo> m_peers;
+  std::vector<PeerEndpoint> m_endpoints;
 };
 
 } // namespace sbt
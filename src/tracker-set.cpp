@@ -0,0 +1,255 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "tracker-set.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+
+namespace sbt {
+
+// bounds of the backoff after failed announces (ms)
+static const uint64_t MIN_BACKOFF = 15000;
+static const uint64_t MAX_BACKOFF = 1800000;
+
+TrackerSet::TrackerSet(util::EventLoop& loop, util::Resolver& resolver,
+                       const std::vector<std::vector<std::string>>& tiers,
+                       const RequestBuilder& buildRequest, const PeerHandler& onPeers)
+  : m_loop(loop)
+  , m_resolver(resolver)
+  , m_buildRequest(buildRequest)
+  , m_onPeers(onPeers)
+{
+  std::random_device seed;
+  std::mt19937 random(seed());
+
+  for (const auto& urls : tiers) {
+    Tier tier;
+    tier.current = 0;
+    tier.timer = 0;
+
+    for (const auto& url : urls) {
+      auto tracker = std::make_shared<Tracker>();
+      if (!parseUrl(url, tracker->host, tracker->port, tracker->path)) {
+        fprintf(stderr, "Skipping unsupported tracker %s\n", url.c_str());
+        continue;
+      }
+
+      tracker->url = url;
+      tracker->isStarted = false;
+      tracker->backoff = MIN_BACKOFF;
+      tracker->retryAt = 0;
+      if (url.compare(0, 6, "udp://") == 0)
+        tracker->udp = std::make_shared<UdpTrackerConnection>(m_loop, m_resolver,
+                                                              tracker->host, tracker->port);
+      else {
+        tracker->connection = std::make_shared<TrackerConnection>(m_loop, m_resolver,
+                                                                  tracker->host, tracker->port);
+        tracker->builder = std::make_shared<AnnounceBuilder>(tracker->host, tracker->port,
+                                                             tracker->path);
+      }
+      tier.trackers.push_back(tracker);
+    }
+
+    // BEP 12: spread the load over the trackers of a tier
+    std::shuffle(tier.trackers.begin(), tier.trackers.end(), random);
+
+    if (!tier.trackers.empty())
+      m_tiers.push_back(tier);
+  }
+}
+
+TrackerSet::~TrackerSet()
+{
+  for (const auto& tier : m_tiers) {
+    if (tier.timer != 0)
+      m_loop.cancel(tier.timer);
+  }
+}
+
+void
+TrackerSet::start()
+{
+  for (size_t i = 0; i < m_tiers.size(); i++)
+    announce(i);
+}
+
+bool
+TrackerSet::parseUrl(const std::string& url, std::string& host, std::string& port, std::string& path)
+{
+  size_t scheme = url.find("://");
+  if (scheme == std::string::npos)
+    return false;
+
+  bool isUdp = url.compare(0, scheme, "udp") == 0;
+  if (!isUdp && url.compare(0, scheme, "http") != 0)
+    return false;
+
+  size_t start = scheme + 3;
+  size_t slash = url.find('/', start);
+  std::string authority = url.substr(start, slash == std::string::npos ? slash : slash - start);
+  path = slash == std::string::npos ? std::string() : url.substr(slash + 1);
+
+  size_t colon = authority.rfind(':');
+  if (colon != std::string::npos) {
+    host = authority.substr(0, colon);
+    port = authority.substr(colon + 1);
+  }
+  else {
+    host = authority;
+    port = isUdp ? "" : "80";
+  }
+
+  return !host.empty() && !port.empty();
+}
+
+void
+TrackerSet::announce(size_t tier)
+{
+  Tier& t = m_tiers[tier];
+  t.timer = 0;
+
+  Tracker& tracker = *t.trackers[t.current];
+  AnnounceRequest request = m_buildRequest(tracker);
+
+  if (tracker.udp) {
+    tracker.udp->announce(request,
+                          [this, tier] (int rc, const UdpTrackerConnection::AnnounceResponse& response) {
+                            onUdpAnnounce(tier, rc, response);
+                          });
+  }
+  else {
+    tracker.connection->announce(tracker.builder->build(request),
+                                 [this, tier] (int rc, const HttpResponseReader& reader) {
+                                   onHttpAnnounce(tier, rc, reader);
+                                 });
+  }
+}
+
+void
+TrackerSet::onHttpAnnounce(size_t tier, int rc, const HttpResponseReader& reader)
+{
+  Tier& t = m_tiers[tier];
+  std::shared_ptr<Tracker> tracker = t.trackers[t.current];
+
+  if (rc < 0) {
+    fprintf(stderr, "Failed to receive a response from tracker %s\n", tracker->url.c_str());
+    failover(tier);
+    return;
+  }
+
+  TrackerResponse response;
+  try {
+    // decode straight out of the received bytes, without copying them
+    const Buffer& body = reader.getBody();
+    boost::iostreams::stream<boost::iostreams::array_source> is(body.get<char>(), body.size());
+
+    bencoding::Dictionary dict;
+    dict.wireDecode(is);
+    response.decode(dict);
+  }
+  catch (bencoding::Error& e) {
+    fprintf(stderr, "Bad response from tracker %s: %s\n", tracker->url.c_str(), e.what());
+    failover(tier);
+    return;
+  }
+
+  if (response.isFailure()) {
+    fprintf(stderr, "Fail:%s\n", response.getFailure().c_str());
+    failover(tier);
+    return;
+  }
+
+  onResponse(tier, response.getInterval(), response.getEndpoints());
+}
+
+void
+TrackerSet::onUdpAnnounce(size_t tier, int rc, const UdpTrackerConnection::AnnounceResponse& response)
+{
+  if (rc < 0) {
+    Tier& t = m_tiers[tier];
+    fprintf(stderr, "Failed to receive a response from tracker %s\n", t.trackers[t.current]->url.c_str());
+    failover(tier);
+    return;
+  }
+
+  onResponse(tier, response.interval, response.peers);
+}
+
+void
+TrackerSet::onResponse(size_t tier, uint64_t interval, const std::vector<PeerEndpoint>& peers)
+{
+  Tier& t = m_tiers[tier];
+  std::shared_ptr<Tracker> tracker = t.trackers[t.current];
+
+  tracker->isStarted = true;
+  tracker->backoff = MIN_BACKOFF;
+  tracker->retryAt = 0;
+
+  // BEP 12: the tracker that answered is tried first from now on
+  t.trackers.erase(t.trackers.begin() + t.current);
+  t.trackers.insert(t.trackers.begin(), tracker);
+  t.current = 0;
+
+  schedule(tier, interval * 1000);
+
+  std::vector<PeerEndpoint> fresh;
+  for (const auto& endpoint : peers) {
+    std::string key(reinterpret_cast<const char*>(&endpoint), sizeof(endpoint));
+    if (m_seen.insert(key).second)
+      fresh.push_back(endpoint);
+  }
+
+  if (!fresh.empty())
+    m_onPeers(fresh);
+}
+
+void
+TrackerSet::forget(const PeerEndpoint& endpoint)
+{
+  m_seen.erase(std::string(reinterpret_cast<const char*>(&endpoint), sizeof(endpoint)));
+}
+
+void
+TrackerSet::failover(size_t tier)
+{
+  Tier& t = m_tiers[tier];
+  uint64_t now = util::steadyNow();
+
+  Tracker& failed = *t.trackers[t.current];
+  failed.retryAt = now + failed.backoff;
+  failed.backoff = std::min(failed.backoff * 2, MAX_BACKOFF);
+
+  // move on to the next tracker of the tier that is not backing off
+  size_t next = t.current;
+  for (size_t i = 1; i <= t.trackers.size(); i++) {
+    size_t candidate = (t.current + i) % t.trackers.size();
+    if (t.trackers[candidate]->retryAt < t.trackers[next]->retryAt)
+      next = candidate;
+    if (t.trackers[candidate]->retryAt <= now) {
+      t.current = candidate;
+      announce(tier);
+      return;
+    }
+  }
+
+  // all of them are, wait for the first one to be due
+  t.current = next;
+  schedule(tier, t.trackers[next]->retryAt - now);
+}
+
+void
+TrackerSet::schedule(size_t tier, uint64_t delayMs)
+{
+  m_tiers[tier].timer = m_loop.schedule(delayMs, [this, tier] { announce(tier); });
+}
+
+} // namespace sbt
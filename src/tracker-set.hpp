@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_TRACKER_SET_HPP
+#define SBT_TRACKER_SET_HPP
+
+#include "announce-builder.hpp"
+#include "tracker-connection.hpp"
+#include "udp-tracker-connection.hpp"
+
+#include <unordered_set>
+
+namespace sbt {
+
+/**
+ * @brief Every tracker of a torrent, announced to in parallel
+ *
+ * Trackers come in announce-list tiers (BEP 12), shuffled once within each tier, and
+ * speak either HTTP or the UDP tracker protocol (BEP 15).  Each tier runs on its own:
+ * it announces to its first tracker, fails over to the next one in the tier, and
+ * moves the tracker that answered to the front.  All tiers
+ * announce concurrently, so one slow or dead tracker never holds up the others.
+ * Every tracker keeps its own interval and failure backoff.  Peers from all trackers
+ * are merged, and each one is reported only the first time it shows up, or the first
+ * time after it was forgotten.
+ */
+class TrackerSet
+{
+public:
+  struct Tracker
+  {
+    std::string url;
+    std::string host;
+    std::string port;
+    std::string path;  // without the leading '/'
+    bool isStarted;    // got an answer to the started event
+    uint64_t backoff;  // ms to wait after the next failure
+    uint64_t retryAt;  // not tried again before (steady clock, ms)
+    std::shared_ptr<TrackerConnection> connection;  // http:// trackers
+    std::shared_ptr<AnnounceBuilder> builder;       // http:// trackers
+    std::shared_ptr<UdpTrackerConnection> udp;      // udp:// trackers
+  };
+
+  /**
+   * @brief Fills in the next announce to @p tracker
+   */
+  typedef function<AnnounceRequest(const Tracker& tracker)> RequestBuilder;
+
+  /**
+   * @brief Receives peers not reported before, or forgotten since
+   */
+  typedef function<void(const std::vector<PeerEndpoint>& peers)> PeerHandler;
+
+public:
+  TrackerSet(util::EventLoop& loop, util::Resolver& resolver,
+             const std::vector<std::vector<std::string>>& tiers,
+             const RequestBuilder& buildRequest, const PeerHandler& onPeers);
+
+  ~TrackerSet();
+
+  /**
+   * @brief Announce on every tier
+   */
+  void
+  start();
+
+  size_t
+  getTierCount() const
+  {
+    return m_tiers.size();
+  }
+
+  /**
+   * @brief Trackers of tier @p index, in the order they are tried
+   */
+  const std::vector<std::shared_ptr<Tracker>>&
+  getTier(size_t index) const
+  {
+    return m_tiers[index].trackers;
+  }
+
+  /**
+   * @brief Number of distinct peers reported and not forgotten
+   */
+  size_t
+  getPeerCount() const
+  {
+    return m_seen.size();
+  }
+
+  /**
+   * @brief Report @p endpoint again the next time a tracker has it, such as once the
+   *        connection to it is gone
+   */
+  void
+  forget(const PeerEndpoint& endpoint);
+
+  /**
+   * @brief Split a tracker URL of the form http://host[:port]/path or udp://host:port
+   * @returns false if @p url is neither
+   */
+  static bool
+  parseUrl(const std::string& url, std::string& host, std::string& port, std::string& path);
+
+private:
+  struct Tier
+  {
+    std::vector<std::shared_ptr<Tracker>> trackers;
+    size_t current;
+    util::TimerWheel::TimerId timer;
+  };
+
+  void
+  announce(size_t tier);
+
+  void
+  onHttpAnnounce(size_t tier, int rc, const HttpResponseReader& reader);
+
+  void
+  onUdpAnnounce(size_t tier, int rc, const UdpTrackerConnection::AnnounceResponse& response);
+
+  /**
+   * @brief Account for a successful announce on @p tier and pass on new peers
+   */
+  void
+  onResponse(size_t tier, uint64_t interval, const std::vector<PeerEndpoint>& peers);
+
+  /**
+   * @brief Back off the current tracker of @p tier and move on to the next one
+   */
+  void
+  failover(size_t tier);
+
+  void
+  schedule(size_t tier, uint64_t delayMs);
+
+private:
+  util::EventLoop& m_loop;
+  util::Resolver& m_resolver;
+  RequestBuilder m_buildRequest;
+  PeerHandler m_onPeers;
+
+  std::vector<Tier> m_tiers;
+  std::unordered_set<std::string> m_seen; // raw family, port and address of each peer
+};
+
+} // namespace sbt
+
+#endif // SBT_TRACKER_SET_HPP
@@ -0,0 +1,336 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "udp-tracker-connection.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <errno.h>
+#include <stdio.h>
+
+namespace sbt {
+
+static const uint64_t PROTOCOL_ID = 0x41727101980ULL;
+
+static const uint32_t ACTION_CONNECT = 0;
+static const uint32_t ACTION_ANNOUNCE = 1;
+static const uint32_t ACTION_SCRAPE = 2;
+static const uint32_t ACTION_ERROR = 3;
+
+// a connection ID may be used for one minute after it was received (ms)
+static const uint64_t CONNECTION_ID_LIFETIME = 60000;
+
+// everything in the protocol is big-endian
+static void
+put32(uint8_t* p, uint32_t value)
+{
+  value = htonl(value);
+  memcpy(p, &value, 4);
+}
+
+static void
+put64(uint8_t* p, uint64_t value)
+{
+  put32(p, static_cast<uint32_t>(value >> 32));
+  put32(p + 4, static_cast<uint32_t>(value));
+}
+
+static uint32_t
+get32(const uint8_t* p)
+{
+  uint32_t value;
+  memcpy(&value, p, 4);
+  return ntohl(value);
+}
+
+static uint64_t
+get64(const uint8_t* p)
+{
+  return (static_cast<uint64_t>(get32(p)) << 32) | get32(p + 4);
+}
+
+const int UdpTrackerConnection::MAX_RETRANSMITS;
+const size_t UdpTrackerConnection::MAX_SCRAPE;
+
+UdpTrackerConnection::UdpTrackerConnection(util::EventLoop& loop, util::Resolver& resolver,
+                                           const std::string& host, const std::string& port,
+                                           uint64_t timeoutMs)
+  : m_loop(loop)
+  , m_resolver(resolver)
+  , m_host(host)
+  , m_port(port)
+  , m_timeout(timeoutMs)
+  , m_sockfd(-1)
+  , m_family(AF_INET)
+  , m_state(STATE_IDLE)
+  , m_action(ACTION_ANNOUNCE)
+  , m_transactionId(0)
+  , m_connectionId(0)
+  , m_connectionExpiry(0)
+  , m_nAttempts(0)
+  , m_timer(0)
+  , m_generation(0)
+  , m_random(std::random_device()())
+  , m_nConnects(0)
+  , m_nRetransmits(0)
+{
+  m_key = m_random();
+}
+
+UdpTrackerConnection::~UdpTrackerConnection()
+{
+  cancel();
+  closeSocket();
+}
+
+void
+UdpTrackerConnection::announce(const AnnounceRequest& request, const AnnounceCallback& callback)
+{
+  cancel();
+
+  // everything after the 16-byte header, see BEP 15
+  m_payload.resize(82);
+  uint8_t* p = m_payload.buf();
+  memcpy(p, request.infoHash->buf(), 20);
+  memcpy(p + 20, request.peerId.data(), 20);
+  put64(p + 40, request.downloaded);
+  put64(p + 48, request.left);
+  put64(p + 56, request.uploaded);
+  put32(p + 64, request.event);
+  put32(p + 68, 0);            // our address, as seen by the tracker
+  put32(p + 72, m_key);
+  put32(p + 76, 0xffffffff);   // as many peers as the tracker likes
+  uint16_t port = htons(request.port);
+  memcpy(p + 80, &port, 2);
+
+  m_announceCallback = callback;
+  start(ACTION_ANNOUNCE);
+}
+
+void
+UdpTrackerConnection::scrape(const std::vector<ConstBufferPtr>& infoHashes, const ScrapeCallback& callback)
+{
+  cancel();
+
+  size_t count = std::min(infoHashes.size(), MAX_SCRAPE);
+  m_payload.resize(20 * count);
+  for (size_t i = 0; i < count; i++)
+    memcpy(m_payload.buf() + 20 * i, infoHashes[i]->buf(), 20);
+
+  m_scrapeCallback = callback;
+  start(ACTION_SCRAPE);
+}
+
+void
+UdpTrackerConnection::cancel()
+{
+  if (m_timer != 0) {
+    m_loop.cancel(m_timer);
+    m_timer = 0;
+  }
+
+  m_announceCallback = nullptr;
+  m_scrapeCallback = nullptr;
+  m_state = STATE_IDLE;
+  m_generation++;
+}
+
+void
+UdpTrackerConnection::start(uint32_t action)
+{
+  m_action = action;
+  m_nAttempts = 0;
+  m_error.clear();
+
+  if (m_sockfd >= 0) {
+    transmit();
+    return;
+  }
+
+  m_state = STATE_RESOLVING;
+  uint64_t generation = m_generation;
+  m_resolver.resolve(m_host, m_port, [this, generation] (int rc, const sockaddr_storage& addr,
+                                                         socklen_t length) {
+    if (generation != m_generation || m_state != STATE_RESOLVING)
+      return; // abandoned meanwhile
+
+    if (rc != 0) {
+      fprintf(stderr, "Error getting address info: %s\n", gai_strerror(rc));
+      finish(RC_GET_ADDRESS_INFO_FAILED);
+      return;
+    }
+    open(addr, length);
+  });
+}
+
+void
+UdpTrackerConnection::open(const sockaddr_storage& addr, socklen_t length)
+{
+  m_sockfd = socket(addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+  // a connected datagram socket only receives from the tracker
+  if (m_sockfd < 0 || ::connect(m_sockfd, (const struct sockaddr*) &addr, length) != 0) {
+    fprintf(stderr, "Failed to connect to tracker port: %s\n", m_port.c_str());
+    closeSocket();
+    finish(RC_TRACKER_CONNECTION_FAILED);
+    return;
+  }
+
+  m_family = addr.ss_family;
+  m_loop.add(m_sockfd, EPOLLIN, [this] (uint32_t) { onReadable(); });
+  transmit();
+}
+
+void
+UdpTrackerConnection::transmit()
+{
+  uint8_t packet[16 + 20 * MAX_SCRAPE];
+  size_t size = 16;
+
+  m_transactionId = m_random();
+
+  if (m_connectionExpiry <= util::steadyNow()) {
+    m_state = STATE_CONNECTING;
+    put64(packet, PROTOCOL_ID);
+    put32(packet + 8, ACTION_CONNECT);
+    put32(packet + 12, m_transactionId);
+  }
+  else {
+    m_state = STATE_REQUESTING;
+    put64(packet, m_connectionId);
+    put32(packet + 8, m_action);
+    put32(packet + 12, m_transactionId);
+    memcpy(packet + 16, m_payload.buf(), m_payload.size());
+    size += m_payload.size();
+  }
+
+  // a lost datagram is the same as a dropped one, the timer covers both
+  send(m_sockfd, packet, size, MSG_NOSIGNAL);
+
+  m_timer = m_loop.schedule(m_timeout << m_nAttempts, [this] {
+    m_timer = 0;
+    onTimeout();
+  });
+}
+
+void
+UdpTrackerConnection::onTimeout()
+{
+  if (m_nAttempts == MAX_RETRANSMITS) {
+    fprintf(stderr, "Tracker at port %s timed out\n", m_port.c_str());
+    finish(RC_NO_TRACKER_RESPONSE);
+    return;
+  }
+
+  m_nAttempts++;
+  m_nRetransmits++;
+  transmit();
+}
+
+void
+UdpTrackerConnection::onReadable()
+{
+  uint8_t buf[65536];
+
+  while (m_sockfd >= 0) {
+    ssize_t n = recv(m_sockfd, buf, sizeof(buf), 0);
+    if (n < 0)
+      return; // EAGAIN, or an ICMP error the retransmission timer will deal with
+
+    if (n < 8 || m_state == STATE_IDLE || get32(buf + 4) != m_transactionId)
+      continue; // stray or late datagram
+
+    uint32_t action = get32(buf);
+    if (action == ACTION_ERROR) {
+      m_error.assign(reinterpret_cast<const char*>(buf + 8), n - 8);
+      fprintf(stderr, "Fail:%s\n", m_error.c_str());
+
+      // the connection ID may be what the tracker objects to, get a new one next time
+      m_connectionExpiry = 0;
+      finish(RC_TRACKER_RESPONSE_FAILED);
+      continue;
+    }
+
+    if (m_state == STATE_CONNECTING && action == ACTION_CONNECT && n >= 16) {
+      m_connectionId = get64(buf + 8);
+      m_connectionExpiry = util::steadyNow() + CONNECTION_ID_LIFETIME;
+      m_nConnects++;
+
+      m_loop.cancel(m_timer);
+      transmit();
+    }
+    else if (m_state == STATE_REQUESTING && action == m_action)
+      onResponse(action, buf + 8, n - 8);
+  }
+}
+
+void
+UdpTrackerConnection::onResponse(uint32_t action, const uint8_t* data, size_t size)
+{
+  if (action == ACTION_ANNOUNCE) {
+    if (size < 12)
+      return;
+
+    m_announceResponse.interval = get32(data);
+    m_announceResponse.leechers = get32(data + 4);
+    m_announceResponse.seeders = get32(data + 8);
+    m_announceResponse.peers.clear();
+
+    // peers come in the address family the request was sent over
+    size_t entryLength = m_family == AF_INET6 ? 18 : 6;
+    size_t peersLength = (size - 12) / entryLength * entryLength;
+    TrackerResponse::decodeCompact(data + 12, peersLength, m_family, m_announceResponse.peers);
+  }
+  else {
+    m_scrapeEntries.clear();
+    for (size_t i = 0; i + 12 <= size; i += 12) {
+      ScrapeEntry entry;
+      entry.seeders = get32(data + i);
+      entry.completed = get32(data + i + 4);
+      entry.leechers = get32(data + i + 8);
+      m_scrapeEntries.push_back(entry);
+    }
+  }
+
+  finish(0);
+}
+
+void
+UdpTrackerConnection::finish(int rc)
+{
+  if (m_timer != 0) {
+    m_loop.cancel(m_timer);
+    m_timer = 0;
+  }
+  m_state = STATE_IDLE;
+
+  if (m_action == ACTION_ANNOUNCE) {
+    AnnounceCallback callback;
+    callback.swap(m_announceCallback);
+    if (callback)
+      callback(rc, m_announceResponse);
+  }
+  else {
+    ScrapeCallback callback;
+    callback.swap(m_scrapeCallback);
+    if (callback)
+      callback(rc, m_scrapeEntries);
+  }
+}
+
+void
+UdpTrackerConnection::closeSocket()
+{
+  if (m_sockfd >= 0) {
+    m_loop.remove(m_sockfd);
+    close(m_sockfd);
+    m_sockfd = -1;
+  }
+}
+
+} // namespace sbt
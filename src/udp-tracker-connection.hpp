@@ -0,0 +1,185 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UDP_TRACKER_CONNECTION_HPP
+#define SBT_UDP_TRACKER_CONNECTION_HPP
+
+#include "announce-request.hpp"
+#include "tracker-response.hpp"
+#include "util/event-loop.hpp"
+#include "util/resolver.hpp"
+
+#include <random>
+
+namespace sbt {
+
+/**
+ * @brief Client side of the UDP tracker protocol (BEP 15), driven by the event loop
+ *
+ * Each exchange is a single datagram each way.  The connection ID obtained by the
+ * connect handshake is cached for the minute it stays valid, so back-to-back
+ * announces and scrapes skip the handshake.  Unanswered datagrams are retransmitted
+ * after timeout * 2^n, up to MAX_RETRANSMITS times.
+ */
+class UdpTrackerConnection
+{
+public:
+  struct AnnounceResponse
+  {
+    uint32_t interval; // seconds
+    uint32_t leechers;
+    uint32_t seeders;
+    std::vector<PeerEndpoint> peers;
+  };
+
+  struct ScrapeEntry
+  {
+    uint32_t seeders;
+    uint32_t completed;
+    uint32_t leechers;
+  };
+
+  /**
+   * @param rc  0 on success or one of the RC_* codes
+   */
+  typedef function<void(int rc, const AnnounceResponse& response)> AnnounceCallback;
+  typedef function<void(int rc, const std::vector<ScrapeEntry>& entries)> ScrapeCallback;
+
+  static const int MAX_RETRANSMITS = 8;
+
+  // info hashes that fit one scrape datagram
+  static const size_t MAX_SCRAPE = 74;
+
+public:
+  /**
+   * @param timeoutMs  wait before the first retransmission, doubled on each one
+   */
+  UdpTrackerConnection(util::EventLoop& loop, util::Resolver& resolver,
+                       const std::string& host, const std::string& port,
+                       uint64_t timeoutMs = 15000);
+
+  ~UdpTrackerConnection();
+
+  /**
+   * @brief Announce and call @p callback with the answer
+   *
+   * Returns immediately; an exchange still in flight is abandoned.
+   */
+  void
+  announce(const AnnounceRequest& request, const AnnounceCallback& callback);
+
+  /**
+   * @brief Scrape up to MAX_SCRAPE torrents, answered in the order given
+   */
+  void
+  scrape(const std::vector<ConstBufferPtr>& infoHashes, const ScrapeCallback& callback);
+
+  /**
+   * @brief Abandon the exchange in flight, if any
+   */
+  void
+  cancel();
+
+  bool
+  isBusy() const
+  {
+    return m_state != STATE_IDLE;
+  }
+
+  /**
+   * @brief Message of the last error the tracker sent
+   */
+  const std::string&
+  getError() const
+  {
+    return m_error;
+  }
+
+  /**
+   * @brief Number of connect handshakes completed so far
+   */
+  size_t
+  getConnectCount() const
+  {
+    return m_nConnects;
+  }
+
+  size_t
+  getRetransmitCount() const
+  {
+    return m_nRetransmits;
+  }
+
+private:
+  enum State {
+    STATE_IDLE,
+    STATE_RESOLVING,
+    STATE_CONNECTING, // waiting for a connection ID
+    STATE_REQUESTING  // waiting for the answer to m_payload
+  };
+
+  void
+  start(uint32_t action);
+
+  void
+  open(const sockaddr_storage& addr, socklen_t length);
+
+  /**
+   * @brief Send the connect request, or the request itself with a valid connection ID
+   */
+  void
+  transmit();
+
+  void
+  onTimeout();
+
+  void
+  onReadable();
+
+  void
+  onResponse(uint32_t action, const uint8_t* data, size_t size);
+
+  void
+  finish(int rc);
+
+  void
+  closeSocket();
+
+private:
+  util::EventLoop& m_loop;
+  util::Resolver& m_resolver;
+  std::string m_host;
+  std::string m_port;
+  uint64_t m_timeout;
+  int m_sockfd;
+  uint16_t m_family;
+
+  State m_state;
+  uint32_t m_action;
+  Buffer m_payload;        // request after the connection ID, action and transaction ID
+  uint32_t m_transactionId;
+  uint64_t m_connectionId;
+  uint64_t m_connectionExpiry;
+  int m_nAttempts;
+  util::TimerWheel::TimerId m_timer;
+  uint64_t m_generation;   // invalidates stale resolver callbacks
+  std::mt19937 m_random;
+  uint32_t m_key;
+
+  AnnounceCallback m_announceCallback;
+  ScrapeCallback m_scrapeCallback;
+  AnnounceResponse m_announceResponse;
+  std::vector<ScrapeEntry> m_scrapeEntries;
+  std::string m_error;
+
+  size_t m_nConnects;
+  size_t m_nRetransmits;
+};
+
+} // namespace sbt
+
+#endif // SBT_UDP_TRACKER_CONNECTION_HPP
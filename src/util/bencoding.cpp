@@ -459,5 +459,143 @@ Dictionary::print(std::ostream& os, const std::string& indent)
   }
 }
 
+Reader::Reader(const uint8_t* buf, size_t size)
+  : m_pos(buf)
+  , m_end(buf + size)
+{
+}
+
+Type
+Reader::peek() const
+{
+  if (m_pos == m_end)
+    throw Error("Unexpected end of input");
+
+  switch (*m_pos) {
+  case 'i':
+    return TYPE_INTEGER;
+  case 'l':
+    return TYPE_LIST;
+  case 'd':
+    return TYPE_DICTIONARY;
+  default:
+    if (*m_pos >= '0' && *m_pos <= '9')
+      return TYPE_STRING;
+    throw Error("Bad encoding");
+  }
+}
+
+bool
+Reader::isEnd() const
+{
+  if (m_pos == m_end)
+    throw Error("Unexpected end of input");
+
+  return *m_pos == 'e';
+}
+
+void
+Reader::enterDictionary()
+{
+  expect('d');
+}
+
+void
+Reader::enterList()
+{
+  expect('l');
+}
+
+void
+Reader::leave()
+{
+  expect('e');
+}
+
+const uint8_t*
+Reader::readString(size_t& size)
+{
+  if (peek() != TYPE_STRING)
+    throw Error("Bad encoding");
+
+  if (*m_pos == '0' && m_pos + 1 != m_end && m_pos[1] != ':')
+    throw Error("Bad size");
+
+  size = 0;
+  while (m_pos != m_end && *m_pos != ':') {
+    if (*m_pos < '0' || *m_pos > '9' || size > static_cast<size_t>(m_end - m_pos))
+      throw Error("Bad size");
+    size = size * 10 + (*m_pos++ - '0');
+  }
+  expect(':');
+
+  if (size > static_cast<size_t>(m_end - m_pos))
+    throw Error("Bad size");
+
+  const uint8_t* value = m_pos;
+  m_pos += size;
+  return value;
+}
+
+int64_t
+Reader::readInteger()
+{
+  expect('i');
+
+  bool isNegative = m_pos != m_end && *m_pos == '-';
+  if (isNegative)
+    m_pos++;
+
+  const uint8_t* digits = m_pos;
+  uint64_t value = 0;
+  while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9') {
+    if (m_pos - digits == 18)
+      throw Error("Bad integer");
+    value = value * 10 + (*m_pos++ - '0');
+  }
+
+  if (m_pos == digits || (*digits == '0' && (m_pos - digits > 1 || isNegative)))
+    throw Error("Bad integer");
+  expect('e');
+
+  return isNegative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+}
+
+void
+Reader::skip()
+{
+  // iterative, so that deeply nested input cannot exhaust the stack
+  size_t depth = 0;
+  do {
+    size_t size;
+    switch (peek()) {
+    case TYPE_STRING:
+      readString(size);
+      break;
+    case TYPE_INTEGER:
+      readInteger();
+      break;
+    case TYPE_LIST:
+    case TYPE_DICTIONARY:
+      m_pos++;
+      depth++;
+      break;
+    }
+
+    while (depth > 0 && isEnd()) {
+      m_pos++;
+      depth--;
+    }
+  } while (depth > 0);
+}
+
+void
+Reader::expect(char c)
+{
+  if (m_pos == m_end || *m_pos != c)
+    throw Error("Bad encoding");
+  m_pos++;
+}
+
 } // namespace bencoding
 } // namespace sbt
@@ -249,6 +249,76 @@ private:
   std::map<std::string, std::shared_ptr<Base>> m_map;
 };
 
+/**
+ * @brief Forward-only reader over encoded bytes that builds no tree
+ *
+ * Strings are returned as pointers into the input, so hot paths such as tracker
+ * responses can pick out the few values they need without allocating.  Every method
+ * throws Error on malformed input.
+ *
+ * Example:
+ * Reader reader(buf, size);
+ * reader.enterDictionary();
+ * while (!reader.isEnd()) {
+ *   size_t keySize;
+ *   const uint8_t* key = reader.readString(keySize);
+ *   ...read or skip() the value...
+ * }
+ * reader.leave();
+ */
+class Reader
+{
+public:
+  Reader(const uint8_t* buf, size_t size);
+
+  /**
+   * @brief Type of the next value
+   */
+  Type
+  peek() const;
+
+  /**
+   * @brief Whether the current list or dictionary has no more values
+   */
+  bool
+  isEnd() const;
+
+  void
+  enterDictionary();
+
+  void
+  enterList();
+
+  /**
+   * @brief Step past the 'e' that ends the current list or dictionary
+   */
+  void
+  leave();
+
+  /**
+   * @returns the string's bytes, which stay in the input
+   */
+  const uint8_t*
+  readString(size_t& size);
+
+  int64_t
+  readInteger();
+
+  /**
+   * @brief Step over the next value, whatever its type
+   */
+  void
+  skip();
+
+private:
+  void
+  expect(char c);
+
+private:
+  const uint8_t* m_pos;
+  const uint8_t* m_end;
+};
+
 } // bencoding
 } // sbt
 
@@ -23,6 +23,7 @@
 #define SBT_UTIL_BUFFER_STREAM_HPP
 
 #include "buffer.hpp"
+#include "raw-buffer.hpp"
 
 #include <boost/iostreams/detail/ios.hpp>
 #include <boost/iostreams/categories.hpp>
@@ -39,7 +40,7 @@ public:
   typedef char char_type;
   typedef boost::iostreams::sink_tag category;
 
-  buffer_append_device(Buffer& container)
+  buffer_append_device(RawBuffer& container)
     : m_container(container)
   {
   }
@@ -47,12 +48,12 @@ public:
   std::streamsize
   write(const char_type* s, std::streamsize n)
   {
-    std::copy(s, s+n, std::back_inserter(m_container));
+    m_container.append(s, n);
     return n;
   }
 
 protected:
-  Buffer& m_container;
+  RawBuffer& m_container;
 };
 
 } // iostreams
@@ -61,9 +62,10 @@ protected:
 /**
  * Class implementing interface similar to ostringstream, but to construct ndn::Buffer
  *
- * The benefit of using stream interface is that it provides automatic buffering of
- * written data and eliminates (or reduces) overhead of resizing the underlying buffer
- * when writing small pieces of data.
+ * Writes go through a stream buffer sized to the expected capacity, at most 4 KiB, and
+ * are appended from it in bulk to a RawBuffer, which is neither zero-filled nor grown
+ * a byte at a time.  buf() copies the RawBuffer once into the resulting Buffer, so
+ * messages carrying a large block are better assembled without a stream.
  *
  * Usage example:
  * @code
@@ -77,27 +79,29 @@ class OBufferStream : public boost::iostreams::stream<iostreams::buffer_append_d
 {
 public:
   /**
-   * Default constructor
+   * @param capacity  bytes expected to be written, to allocate only once
    */
-  OBufferStream()
-    : m_buffer(std::make_shared<Buffer>())
-    , m_device(*m_buffer)
+  explicit
+  OBufferStream(size_t capacity = 64)
+    : m_device(m_raw)
   {
-    open(m_device);
+    m_raw.reserve(capacity);
+    // no bigger a stream buffer than the message needs
+    open(m_device, std::min<size_t>(std::max<size_t>(capacity, 16), 4096));
   }
 
   /**
-   * Flush written data to the stream and return shared pointer to the underlying buffer
+   * Flush written data to the stream and return shared pointer to a buffer with it
    */
   std::shared_ptr<Buffer>
   buf()
   {
     flush();
-    return m_buffer;
+    return std::make_shared<Buffer>(m_raw.data(), m_raw.size());
   }
 
 private:
-  BufferPtr m_buffer;
+  RawBuffer m_raw;
   iostreams::buffer_append_device m_device;
 };
 
@@ -0,0 +1,93 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_BUFFER_VIEW_HPP
+#define SBT_UTIL_BUFFER_VIEW_HPP
+
+#include "buffer.hpp"
+
+namespace sbt {
+
+/**
+ * @brief Read-only bytes inside a shared buffer, which the view keeps alive
+ *
+ * Lets a decoded message refer to the chunk it was received into instead of copying
+ * out of it.
+ */
+class BufferView
+{
+public:
+  BufferView()
+    : m_data(nullptr)
+    , m_size(0)
+  {
+  }
+
+  /**
+   * @brief View of all of @p buffer
+   */
+  explicit
+  BufferView(ConstBufferPtr buffer)
+    : m_owner(buffer)
+    , m_data(buffer->empty() ? nullptr : buffer->buf())
+    , m_size(buffer->size())
+  {
+  }
+
+  /**
+   * @param owner  whatever keeps the bytes alive, a Buffer or a pooled slab
+   * @param data   has to point into @p owner
+   */
+  BufferView(std::shared_ptr<const void> owner, const uint8_t* data, size_t size)
+    : m_owner(owner)
+    , m_data(data)
+    , m_size(size)
+  {
+  }
+
+  const uint8_t*
+  data() const
+  {
+    return m_data;
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  bool
+  empty() const
+  {
+    return m_size == 0;
+  }
+
+  /**
+   * @brief The @p length bytes from @p offset on, sharing the same owner
+   */
+  BufferView
+  sub(size_t offset, size_t length) const
+  {
+    return BufferView(m_owner, m_data + offset, length);
+  }
+
+  const std::shared_ptr<const void>&
+  getOwner() const
+  {
+    return m_owner;
+  }
+
+private:
+  std::shared_ptr<const void> m_owner;
+  const uint8_t* m_data;
+  size_t m_size;
+};
+
+} // namespace sbt
+
+#endif // SBT_UTIL_BUFFER_VIEW_HPP
@@ -0,0 +1,65 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "disk-pool.hpp"
+
+namespace sbt {
+namespace util {
+
+DiskPool::DiskPool(EventLoop& loop, size_t nThreads)
+  : m_loop(loop)
+  , m_isStopping(false)
+{
+  for (size_t i = 0; i < nThreads; i++)
+    m_threads.push_back(std::thread([this] { work(); }));
+}
+
+DiskPool::~DiskPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isStopping = true;
+  }
+  m_condition.notify_all();
+
+  for (auto& thread : m_threads)
+    thread.join();
+}
+
+void
+DiskPool::submit(const Job& job, const Job& done)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(std::make_pair(job, done));
+  }
+  m_condition.notify_one();
+}
+
+void
+DiskPool::work()
+{
+  while (true) {
+    std::pair<Job, Job> job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this] { return m_isStopping || !m_jobs.empty(); });
+      if (m_isStopping)
+        return;
+
+      job = m_jobs.front();
+      m_jobs.pop_front();
+    }
+
+    job.first();
+    if (job.second)
+      m_loop.post(job.second);
+  }
+}
+
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,68 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_DISK_POOL_HPP
+#define SBT_UTIL_DISK_POOL_HPP
+
+#include "event-loop.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace sbt {
+namespace util {
+
+/**
+ * @brief Worker threads for blocking disk work such as reading and hashing pieces
+ *
+ * A job runs on one of the workers; its completion handler is then handed back to
+ * the event loop with EventLoop::post, so it may touch loop-owned state freely.
+ * Jobs themselves must not.
+ */
+class DiskPool
+{
+public:
+  typedef function<void()> Job;
+
+  DiskPool(EventLoop& loop, size_t nThreads = 2);
+
+  /**
+   * @brief Stop the workers; jobs not started yet are dropped
+   */
+  ~DiskPool();
+
+  /**
+   * @brief Run @p job on a worker, then @p done on the event loop
+   */
+  void
+  submit(const Job& job, const Job& done);
+
+  size_t
+  getThreadCount() const
+  {
+    return m_threads.size();
+  }
+
+private:
+  void
+  work();
+
+private:
+  EventLoop& m_loop;
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<std::pair<Job, Job>> m_jobs;
+  bool m_isStopping;
+  std::vector<std::thread> m_threads;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_DISK_POOL_HPP
@@ -0,0 +1,290 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "event-loop.hpp"
+
+#include <errno.h>
+#include <sys/eventfd.h>
+
+namespace sbt {
+namespace util {
+
+static const int MAX_EVENTS = 64;
+
+// io_uring user data: the kind in the top byte, then generation and fd for polls, or
+// the completion id for reads and writes
+static const uint64_t KIND_IGNORE = 0;
+static const uint64_t KIND_POLL = 1;
+static const uint64_t KIND_IO = 2;
+static const uint32_t GENERATION_MASK = 0xffffff;
+
+static uint64_t
+pollUserData(int fd, uint32_t generation)
+{
+  return (KIND_POLL << 56) | (static_cast<uint64_t>(generation & GENERATION_MASK) << 32) |
+         static_cast<uint32_t>(fd);
+}
+
+EventLoop::EventLoop(Backend backend)
+  : m_epfd(-1)
+  , m_wakefd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+  , m_isRunning(false)
+  , m_timers(steadyNow())
+  , m_nextCompletion(0)
+{
+  if (backend == BACKEND_IO_URING || (backend == BACKEND_AUTO && IoUring::isSupported()))
+    m_ring.reset(new IoUring());
+  else
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+
+  if ((!m_ring && m_epfd < 0) || m_wakefd < 0)
+    throw std::runtime_error("Cannot create epoll instance");
+
+  add(m_wakefd, EPOLLIN, [this] (uint32_t) { runTasks(); });
+}
+
+EventLoop::~EventLoop()
+{
+  close(m_wakefd);
+  if (m_epfd >= 0)
+    close(m_epfd);
+}
+
+void
+EventLoop::add(int fd, uint32_t events, const Handler& handler)
+{
+  if (static_cast<size_t>(fd) >= m_handlers.size()) {
+    m_handlers.resize(fd + 1);
+    m_events.resize(fd + 1);
+    m_generations.resize(fd + 1);
+    m_isArmed.resize(fd + 1);
+  }
+  m_handlers[fd] = handler;
+  m_events[fd] = events;
+
+  if (m_ring) {
+    disarmPoll(fd);
+    armPoll(fd);
+    return;
+  }
+
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.fd = fd;
+  if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    epoll_ctl(m_epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void
+EventLoop::modify(int fd, uint32_t events)
+{
+  if (m_ring) {
+    m_events[fd] = events;
+    disarmPoll(fd);
+    armPoll(fd);
+    return;
+  }
+
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.fd = fd;
+  epoll_ctl(m_epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void
+EventLoop::remove(int fd)
+{
+  if (static_cast<size_t>(fd) >= m_handlers.size())
+    return;
+
+  if (m_ring)
+    disarmPoll(fd);
+  else
+    epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, nullptr);
+  m_handlers[fd] = nullptr;
+}
+
+void
+EventLoop::armPoll(int fd)
+{
+  m_ring->prepPollAdd(fd, m_events[fd] & (EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP),
+                      pollUserData(fd, m_generations[fd]));
+  m_isArmed[fd] = true;
+}
+
+void
+EventLoop::disarmPoll(int fd)
+{
+  if (m_isArmed[fd])
+    m_ring->prepPollRemove(pollUserData(fd, m_generations[fd]), KIND_IGNORE);
+
+  m_isArmed[fd] = false;
+  m_generations[fd]++;
+}
+
+void
+EventLoop::readAt(int fd, void* buf, size_t length, uint64_t offset,
+                  const Completion& completion)
+{
+  if (m_ring) {
+    uint64_t id = (KIND_IO << 56) | m_nextCompletion++;
+    m_completions[id] = completion;
+    m_ring->prepRead(fd, buf, length, offset, id);
+    return;
+  }
+
+  ssize_t result = pread(fd, buf, length, offset);
+  if (result < 0)
+    result = -errno;
+  m_completed.push_back([completion, result] { completion(result); });
+}
+
+void
+EventLoop::writeAt(int fd, const void* buf, size_t length, uint64_t offset,
+                   const Completion& completion)
+{
+  if (m_ring) {
+    uint64_t id = (KIND_IO << 56) | m_nextCompletion++;
+    m_completions[id] = completion;
+    m_ring->prepWrite(fd, buf, length, offset, id);
+    return;
+  }
+
+  ssize_t result = pwrite(fd, buf, length, offset);
+  if (result < 0)
+    result = -errno;
+  m_completed.push_back([completion, result] { completion(result); });
+}
+
+void
+EventLoop::post(const Task& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_taskMutex);
+    m_tasks.push_back(task);
+  }
+
+  uint64_t one = 1;
+  if (write(m_wakefd, &one, sizeof(one)) < 0) {
+    // the counter can only overflow if the loop is wedged, the task is queued anyway
+  }
+}
+
+void
+EventLoop::runTasks()
+{
+  uint64_t count;
+  if (read(m_wakefd, &count, sizeof(count)) < 0) {
+    // spurious wakeup, nothing posted
+  }
+
+  std::vector<Task> tasks;
+  {
+    std::lock_guard<std::mutex> lock(m_taskMutex);
+    tasks.swap(m_tasks);
+  }
+
+  for (size_t i = 0; i < tasks.size(); i++)
+    tasks[i]();
+}
+
+void
+EventLoop::run()
+{
+  m_isRunning = true;
+  while (m_isRunning)
+    runOnce();
+}
+
+void
+EventLoop::runOnce(int maxWaitMs)
+{
+  int timeout = m_timers.getTimeout(steadyNow());
+  if (maxWaitMs >= 0 && (timeout < 0 || timeout > maxWaitMs))
+    timeout = maxWaitMs;
+  if (!m_completed.empty())
+    timeout = 0;
+
+  if (m_ring)
+    waitRing(timeout);
+  else
+    waitEpoll(timeout);
+
+  std::vector<Task> completed;
+  completed.swap(m_completed);
+  for (size_t i = 0; i < completed.size(); i++)
+    completed[i]();
+
+  m_timers.advance(steadyNow());
+}
+
+void
+EventLoop::waitEpoll(int timeout)
+{
+  struct epoll_event events[MAX_EVENTS];
+  int n = epoll_wait(m_epfd, events, MAX_EVENTS, timeout);
+  if (n < 0 && errno != EINTR)
+    throw std::runtime_error("epoll_wait failed");
+
+  for (int i = 0; i < n; i++) {
+    int fd = events[i].data.fd;
+    // copy, the handler may remove itself
+    Handler handler = static_cast<size_t>(fd) < m_handlers.size() ? m_handlers[fd] : nullptr;
+    if (handler)
+      handler(events[i].events);
+  }
+}
+
+void
+EventLoop::waitRing(int timeout)
+{
+  m_ring->submitAndWait(1, timeout);
+
+  m_ringCompletions.clear();
+  m_ring->reap(m_ringCompletions);
+  for (size_t i = 0; i < m_ringCompletions.size(); i++)
+    onRingCompletion(m_ringCompletions[i]);
+}
+
+void
+EventLoop::onRingCompletion(const IoUring::Completion& completion)
+{
+  uint64_t kind = completion.userData >> 56;
+  if (kind == KIND_IO) {
+    auto it = m_completions.find(completion.userData);
+    if (it == m_completions.end())
+      return; // already handled, or given up on
+
+    Completion callback = it->second;
+    m_completions.erase(it);
+    callback(completion.result);
+    return;
+  }
+  if (kind != KIND_POLL)
+    return;
+
+  int fd = static_cast<int32_t>(completion.userData);
+  uint32_t generation = (completion.userData >> 32) & GENERATION_MASK;
+  if ((m_generations[fd] & GENERATION_MASK) != generation)
+    return; // removed or re-added since
+
+  m_isArmed[fd] = false;
+  uint32_t events = completion.result < 0 ? EPOLLERR : completion.result;
+
+  // copy, the handler may remove itself
+  Handler handler = m_handlers[fd];
+  if (handler)
+    handler(events);
+
+  // still wanted and not re-added by the handler, so watch for the next event
+  if (m_handlers[fd] && (m_generations[fd] & GENERATION_MASK) == generation &&
+      !m_isArmed[fd])
+    armPoll(fd);
+}
+
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_EVENT_LOOP_HPP
+#define SBT_UTIL_EVENT_LOOP_HPP
+
+#include "timer-wheel.hpp"
+#include "io-uring.hpp"
+#include <sys/epoll.h>
+#include <mutex>
+#include <vector>
+
+namespace sbt {
+namespace util {
+
+/**
+ * @brief Single-threaded reactor multiplexing sockets and timers
+ *
+ * Sockets are watched with epoll or, where the kernel supports it, with io_uring polls;
+ * timers live in a TimerWheel whose next expiry bounds the wait, so pending timers cost
+ * no syscalls of their own.  Other threads hand work to the loop with post().
+ *
+ * readAt() and writeAt() are the storage layer's asynchronous pread/pwrite.  With
+ * io_uring they share the ring with the polls, so one io_uring_enter per round submits
+ * every queued disk operation and poll re-arm and waits for the next events.  With
+ * epoll they run inline and complete on the next round.
+ *
+ * Socket data is still moved by the handlers with recv and sendmsg, one system call
+ * each, on either backend; IoUring's recv/send and registered-buffer operations are
+ * not used by the loop.
+ */
+class EventLoop
+{
+public:
+  typedef function<void(uint32_t events)> Handler;
+  typedef function<void()> Task;
+
+  /**
+   * @param result  bytes transferred, or -errno
+   */
+  typedef function<void(ssize_t result)> Completion;
+
+  enum Backend {
+    BACKEND_AUTO,    ///< io_uring if supported, epoll otherwise
+    BACKEND_EPOLL,
+    BACKEND_IO_URING ///< throws if unsupported
+  };
+
+public:
+  explicit
+  EventLoop(Backend backend = BACKEND_AUTO);
+
+  ~EventLoop();
+
+  /**
+   * @brief Watch @p fd for @p events (EPOLLIN, EPOLLOUT, ...)
+   */
+  void
+  add(int fd, uint32_t events, const Handler& handler);
+
+  void
+  modify(int fd, uint32_t events);
+
+  /**
+   * @brief Stop watching @p fd; safe to call from within its own handler
+   */
+  void
+  remove(int fd);
+
+  /**
+   * @brief pread @p length bytes at @p offset, then call @p completion on the loop
+   *
+   * @p buf has to stay valid until then.
+   */
+  void
+  readAt(int fd, void* buf, size_t length, uint64_t offset, const Completion& completion);
+
+  void
+  writeAt(int fd, const void* buf, size_t length, uint64_t offset,
+          const Completion& completion);
+
+  Backend
+  getBackend() const
+  {
+    return m_ring ? BACKEND_IO_URING : BACKEND_EPOLL;
+  }
+
+  TimerWheel::TimerId
+  schedule(uint64_t delayMs, const TimerWheel::Callback& callback)
+  {
+    return m_timers.schedule(delayMs, callback);
+  }
+
+  bool
+  cancel(TimerWheel::TimerId id)
+  {
+    return m_timers.cancel(id);
+  }
+
+  /**
+   * @brief Run @p task on the loop thread; safe to call from any thread
+   */
+  void
+  post(const Task& task);
+
+  /**
+   * @brief Dispatch events until stop() is called
+   */
+  void
+  run();
+
+  /**
+   * @brief Wait at most @p maxWaitMs (-1 for no limit) and dispatch what is ready
+   */
+  void
+  runOnce(int maxWaitMs = -1);
+
+  void
+  stop()
+  {
+    m_isRunning = false;
+  }
+
+private:
+  void
+  runTasks();
+
+  void
+  waitEpoll(int timeout);
+
+  void
+  waitRing(int timeout);
+
+  void
+  armPoll(int fd);
+
+  void
+  disarmPoll(int fd);
+
+  void
+  onRingCompletion(const IoUring::Completion& completion);
+
+private:
+  int m_epfd;
+  std::unique_ptr<IoUring> m_ring;
+  int m_wakefd; // eventfd signalled by post()
+  bool m_isRunning;
+  TimerWheel m_timers;
+  std::vector<Handler> m_handlers; // indexed by fd
+
+  // io_uring polls are one-shot and re-armed after every event, which keeps epoll's
+  // level-triggered behaviour; the generation tells stale poll completions apart
+  std::vector<uint32_t> m_events;      // indexed by fd
+  std::vector<uint32_t> m_generations; // indexed by fd
+  std::vector<bool> m_isArmed;         // indexed by fd
+
+  std::unordered_map<uint64_t, Completion> m_completions; // by io_uring user data
+  uint64_t m_nextCompletion;
+  std::vector<Task> m_completed; // epoll: finished readAt/writeAt
+  std::vector<IoUring::Completion> m_ringCompletions;
+
+  std::mutex m_taskMutex;
+  std::vector<Task> m_tasks;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_EVENT_LOOP_HPP
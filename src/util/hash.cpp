@@ -68,5 +68,18 @@ sha1(ConstBufferPtr input)
   return result;
 }
 
+std::vector<uint8_t>
+sha1(const uint8_t* input, size_t length)
+{
+  using namespace CryptoPP;
+
+  std::vector<uint8_t> result(20, 0);
+  SHA1 hash;
+
+  StringSource(input, length, true, new HashFilter(hash, new ArraySink(&result.front(), 20)));
+
+  return result;
+}
+
 } // namespace util
 } // namespace sbt
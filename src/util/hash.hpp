@@ -37,6 +37,9 @@ sha1(const std::vector<uint8_t>& input);
 ConstBufferPtr
 sha1(ConstBufferPtr input);
 
+std::vector<uint8_t>
+sha1(const uint8_t* input, size_t length);
+
 } // namespace util
 } // namespace sbt
 
@@ -0,0 +1,289 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "io-uring.hpp"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sbt {
+namespace util {
+
+static int
+setup(unsigned entries, io_uring_params& params)
+{
+  return syscall(__NR_io_uring_setup, entries, &params);
+}
+
+static int
+enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t size)
+{
+  return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, size);
+}
+
+static int
+registerOp(int fd, unsigned opcode, void* arg, unsigned count)
+{
+  return syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static bool
+probe()
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = setup(4, params);
+  if (fd < 0)
+    return false;
+
+  // the wait with a timeout needs EXT_ARG (5.11)
+  bool isSupported = (params.features & IORING_FEAT_EXT_ARG) &&
+                     (params.features & IORING_FEAT_NODROP);
+
+  std::vector<uint8_t> buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+  io_uring_probe* ops = reinterpret_cast<io_uring_probe*>(buffer.data());
+  if (isSupported && registerOp(fd, IORING_REGISTER_PROBE, ops, 256) == 0) {
+    const uint8_t needed[] = {IORING_OP_POLL_ADD, IORING_OP_POLL_REMOVE, IORING_OP_READ,
+                              IORING_OP_WRITE, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED,
+                              IORING_OP_RECV, IORING_OP_SEND};
+    for (uint8_t op : needed) {
+      if (op >= ops->ops_len || !(ops->ops[op].flags & IO_URING_OP_SUPPORTED))
+        isSupported = false;
+    }
+  }
+  else {
+    isSupported = false;
+  }
+
+  close(fd);
+  return isSupported;
+}
+
+bool
+IoUring::isSupported()
+{
+  static const bool isSupported = probe();
+  return isSupported;
+}
+
+IoUring::IoUring(unsigned entries)
+  : m_sqRing(MAP_FAILED)
+  , m_cqRing(MAP_FAILED)
+  , m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED))
+  , m_nQueued(0)
+  , m_nEnters(0)
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  m_fd = setup(entries, params);
+  if (m_fd < 0)
+    throw std::runtime_error("Cannot set up io_uring");
+  m_features = params.features;
+
+  m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool isSingleMmap = m_features & IORING_FEAT_SINGLE_MMAP;
+  if (isSingleMmap)
+    m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+
+  m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  m_fd, IORING_OFF_SQ_RING);
+  if (m_sqRing != MAP_FAILED) {
+    m_cqRing = isSingleMmap ? m_sqRing :
+               mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    m_fd, IORING_OFF_CQ_RING);
+  }
+  m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  if (m_cqRing != MAP_FAILED) {
+    m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_POPULATE, m_fd,
+                                             IORING_OFF_SQES));
+  }
+  if (m_sqes == MAP_FAILED) {
+    release();
+    throw std::runtime_error("Cannot map io_uring");
+  }
+
+  uint8_t* sq = static_cast<uint8_t*>(m_sqRing);
+  m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  m_sqEntries = params.sq_entries;
+  m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+  uint8_t* cq = static_cast<uint8_t*>(m_cqRing);
+  m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+IoUring::~IoUring()
+{
+  release();
+}
+
+void
+IoUring::release()
+{
+  if (m_sqes != MAP_FAILED)
+    munmap(m_sqes, m_sqesSize);
+  if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing)
+    munmap(m_cqRing, m_cqRingSize);
+  if (m_sqRing != MAP_FAILED)
+    munmap(m_sqRing, m_sqRingSize);
+  close(m_fd);
+}
+
+int
+IoUring::registerBuffers(const struct iovec* iovecs, unsigned count)
+{
+  registerOp(m_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+  if (registerOp(m_fd, IORING_REGISTER_BUFFERS, const_cast<struct iovec*>(iovecs), count) < 0)
+    return -errno;
+  return 0;
+}
+
+io_uring_sqe*
+IoUring::getSqe()
+{
+  unsigned tail = *m_sqTail;
+
+  // a full ring has to be submitted to make room; submitAndWait swallows EBUSY and
+  // EAGAIN, and the slot at the tail must not be reused before the kernel took it
+  while (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+    unsigned queued = m_nQueued;
+    submitAndWait(0, 0);
+    if (m_nQueued == queued)
+      throw std::runtime_error("io_uring submission queue is full");
+  }
+
+  unsigned index = tail & m_sqMask;
+  io_uring_sqe* sqe = &m_sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  m_sqArray[index] = index;
+  return sqe;
+}
+
+io_uring_sqe*
+IoUring::prep(uint8_t opcode, int fd, const void* buf, unsigned length, uint64_t offset,
+              uint64_t userData)
+{
+  io_uring_sqe* sqe = getSqe();
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buf);
+  sqe->len = length;
+  sqe->off = offset;
+  sqe->user_data = userData;
+
+  // publish it; the kernel only looks at the tail on io_uring_enter
+  __atomic_store_n(m_sqTail, *m_sqTail + 1, __ATOMIC_RELEASE);
+  m_nQueued++;
+  return sqe;
+}
+
+void
+IoUring::prepPollAdd(int fd, uint32_t events, uint64_t userData)
+{
+  io_uring_sqe* sqe = prep(IORING_OP_POLL_ADD, fd, nullptr, 0, 0, userData);
+  sqe->poll32_events = events;
+}
+
+void
+IoUring::prepPollRemove(uint64_t target, uint64_t userData)
+{
+  prep(IORING_OP_POLL_REMOVE, -1, reinterpret_cast<const void*>(target), 0, 0, userData);
+}
+
+void
+IoUring::prepRead(int fd, void* buf, unsigned length, uint64_t offset, uint64_t userData)
+{
+  prep(IORING_OP_READ, fd, buf, length, offset, userData);
+}
+
+void
+IoUring::prepWrite(int fd, const void* buf, unsigned length, uint64_t offset, uint64_t userData)
+{
+  prep(IORING_OP_WRITE, fd, buf, length, offset, userData);
+}
+
+void
+IoUring::prepReadFixed(int fd, void* buf, unsigned length, uint64_t offset, int bufIndex,
+                       uint64_t userData)
+{
+  prep(IORING_OP_READ_FIXED, fd, buf, length, offset, userData)->buf_index = bufIndex;
+}
+
+void
+IoUring::prepWriteFixed(int fd, const void* buf, unsigned length, uint64_t offset, int bufIndex,
+                        uint64_t userData)
+{
+  prep(IORING_OP_WRITE_FIXED, fd, buf, length, offset, userData)->buf_index = bufIndex;
+}
+
+void
+IoUring::prepRecv(int fd, void* buf, unsigned length, uint64_t userData)
+{
+  prep(IORING_OP_RECV, fd, buf, length, 0, userData);
+}
+
+void
+IoUring::prepSend(int fd, const void* buf, unsigned length, uint64_t userData)
+{
+  prep(IORING_OP_SEND, fd, buf, length, 0, userData)->msg_flags = MSG_NOSIGNAL;
+}
+
+size_t
+IoUring::reap(std::vector<Completion>& completions)
+{
+  unsigned head = *m_cqHead;
+  unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+  size_t n = tail - head;
+
+  for (; head != tail; head++) {
+    const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+    Completion completion = {cqe.user_data, cqe.res, cqe.flags};
+    completions.push_back(completion);
+  }
+  __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+
+  return n;
+}
+
+void
+IoUring::submitAndWait(unsigned waitFor, int timeoutMs)
+{
+  __kernel_timespec ts;
+  io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  if (timeoutMs >= 0) {
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+  }
+
+  unsigned flags = IORING_ENTER_EXT_ARG;
+  if (waitFor > 0)
+    flags |= IORING_ENTER_GETEVENTS;
+
+  m_nEnters++;
+  int n = enter(m_fd, m_nQueued, waitFor, flags, &arg, sizeof(arg));
+  if (n >= 0) {
+    m_nQueued -= n;
+  }
+  else if (errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+    throw std::runtime_error("io_uring_enter failed");
+  }
+}
+
+} // namespace util
+} // namespace sbt
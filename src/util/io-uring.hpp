@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_IO_URING_HPP
+#define SBT_UTIL_IO_URING_HPP
+
+#include "../common.hpp"
+
+#include <sys/uio.h>
+#include <vector>
+
+// <linux/io_uring.h> stays out of the header, it drags in macros like BLOCK_SIZE
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace sbt {
+namespace util {
+
+/**
+ * @brief Minimal io_uring instance, driven through the raw system calls
+ *
+ * Operations are queued with the prep*() calls and handed to the kernel by the next
+ * submitAndWait(), together with the wait for completions, so a batch of socket and
+ * disk operations costs a single system call.  The submission queue is flushed early
+ * only when it runs full.
+ */
+class IoUring
+{
+public:
+  struct Completion
+  {
+    uint64_t userData;
+    int32_t result; // >= 0 on success, -errno otherwise
+    uint32_t flags;
+  };
+
+  /**
+   * @brief Whether the running kernel offers everything this class uses
+   *
+   * Probed once; false e.g. on kernels older than 5.11 or where seccomp blocks
+   * io_uring.
+   */
+  static bool
+  isSupported();
+
+  /**
+   * @throws std::runtime_error if the ring cannot be set up
+   */
+  explicit
+  IoUring(unsigned entries = 256);
+
+  ~IoUring();
+
+  /**
+   * @brief Register buffers for the *Fixed operations, replacing earlier ones
+   * @returns 0 or -errno
+   */
+  int
+  registerBuffers(const struct iovec* iovecs, unsigned count);
+
+  void
+  prepPollAdd(int fd, uint32_t events, uint64_t userData);
+
+  /**
+   * @brief Cancel the poll submitted with @p target as its user data
+   */
+  void
+  prepPollRemove(uint64_t target, uint64_t userData);
+
+  void
+  prepRead(int fd, void* buf, unsigned length, uint64_t offset, uint64_t userData);
+
+  void
+  prepWrite(int fd, const void* buf, unsigned length, uint64_t offset, uint64_t userData);
+
+  /**
+   * @brief Read into (part of) the registered buffer @p bufIndex
+   */
+  void
+  prepReadFixed(int fd, void* buf, unsigned length, uint64_t offset, int bufIndex,
+                uint64_t userData);
+
+  void
+  prepWriteFixed(int fd, const void* buf, unsigned length, uint64_t offset, int bufIndex,
+                 uint64_t userData);
+
+  void
+  prepRecv(int fd, void* buf, unsigned length, uint64_t userData);
+
+  void
+  prepSend(int fd, const void* buf, unsigned length, uint64_t userData);
+
+  /**
+   * @brief Submit what is queued and wait for @p waitFor completions
+   * @param timeoutMs  -1 to wait without a limit
+   */
+  void
+  submitAndWait(unsigned waitFor, int timeoutMs);
+
+  /**
+   * @brief Append every completion that is ready to @p completions, in order
+   * @returns how many were appended
+   */
+  size_t
+  reap(std::vector<Completion>& completions);
+
+  /**
+   * @brief Number of io_uring_enter calls so far
+   */
+  uint64_t
+  getEnterCount() const
+  {
+    return m_nEnters;
+  }
+
+private:
+  void
+  release();
+
+  io_uring_sqe*
+  getSqe();
+
+  io_uring_sqe*
+  prep(uint8_t opcode, int fd, const void* buf, unsigned length, uint64_t offset,
+       uint64_t userData);
+
+private:
+  int m_fd;
+  unsigned m_features;
+
+  void* m_sqRing;
+  size_t m_sqRingSize;
+  void* m_cqRing;
+  size_t m_cqRingSize;
+  io_uring_sqe* m_sqes;
+  size_t m_sqesSize;
+
+  unsigned* m_sqTail;
+  unsigned m_sqMask;
+  unsigned m_sqEntries;
+  unsigned* m_sqHead;
+  unsigned* m_sqArray;
+  unsigned m_nQueued; // prepared but not submitted yet
+
+  unsigned* m_cqHead;
+  unsigned* m_cqTail;
+  unsigned m_cqMask;
+  io_uring_cqe* m_cqes;
+
+  uint64_t m_nEnters;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_IO_URING_HPP
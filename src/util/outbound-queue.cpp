@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "outbound-queue.hpp"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace sbt {
+namespace util {
+
+const size_t OutboundQueue::MAX_IOV;
+const size_t OutboundQueue::ARENA_SIZE;
+
+OutboundQueue::OutboundQueue()
+  : m_offset(0)
+  , m_lastTag(0)
+  , m_size(0)
+{
+}
+
+void
+OutboundQueue::push(ConstBufferPtr message)
+{
+  push(BufferView(message));
+}
+
+void
+OutboundQueue::push(const BufferView& bytes, uint64_t tag)
+{
+  if (bytes.empty())
+    return;
+
+  m_size += bytes.size();
+  m_messages.push_back(Entry{bytes, tag});
+}
+
+void
+OutboundQueue::pushCopy(const uint8_t* data, size_t length, uint64_t tag)
+{
+  if (length > ARENA_SIZE) {
+    push(BufferView(make_shared<Buffer>(data, length)), tag);
+    return;
+  }
+
+  // nothing queued points into the arena any more, start it over
+  if (m_arena && m_arena.use_count() == 1)
+    m_arena->clear();
+
+  // a full arena lives on as long as the messages in it are queued
+  if (!m_arena || m_arena->size() + length > m_arena->capacity()) {
+    m_arena = make_shared<RawBuffer>();
+    m_arena->reserve(ARENA_SIZE);
+  }
+
+  const uint8_t* copy = m_arena->data() + m_arena->size();
+  m_arena->append(data, length);
+  m_size += length;
+
+  // right behind the message queued last, make that one longer instead; tagged
+  // messages stay apart so that cancel() can find them
+  if (!m_messages.empty() && tag == 0 && m_messages.back().tag == 0) {
+    BufferView& last = m_messages.back().bytes;
+    if (last.data() + last.size() == copy && last.getOwner() == m_arena) {
+      last = BufferView(m_arena, last.data(), last.size() + length);
+      return;
+    }
+  }
+  m_messages.push_back(Entry{BufferView(m_arena, copy, length), tag});
+}
+
+size_t
+OutboundQueue::cancel(uint64_t tag)
+{
+  if (tag == 0)
+    return 0;
+
+  auto it = m_messages.begin();
+
+  // a message partly written has to be finished, or the stream loses its framing
+  if (it != m_messages.end() && it->tag == tag && (m_offset > 0 || m_lastTag == tag)) {
+    while (it != m_messages.end() && it->tag == tag)
+      ++it;
+  }
+
+  size_t removed = 0;
+  while (it != m_messages.end()) {
+    if (it->tag == tag) {
+      removed += it->bytes.size();
+      it = m_messages.erase(it);
+    }
+    else
+      ++it;
+  }
+
+  m_size -= removed;
+  return removed;
+}
+
+ssize_t
+OutboundQueue::flush(int fd)
+{
+  ssize_t total = 0;
+
+  while (!m_messages.empty()) {
+    struct iovec iov[MAX_IOV];
+    size_t count = 0;
+    for (auto it = m_messages.begin(); it != m_messages.end() && count < MAX_IOV; ++it, ++count) {
+      size_t skip = count == 0 ? m_offset : 0;
+      iov[count].iov_base = const_cast<uint8_t*>(it->bytes.data()) + skip;
+      iov[count].iov_len = it->bytes.size() - skip;
+    }
+
+    // sendmsg rather than writev, for MSG_NOSIGNAL
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return total > 0 && errno == EAGAIN ? total : -errno;
+    }
+
+    total += n;
+    m_size -= n;
+    size_t left = n;
+    while (left > 0) {
+      size_t rest = m_messages.front().bytes.size() - m_offset;
+      if (left < rest) {
+        m_offset += left;
+        break;
+      }
+      left -= rest;
+      m_offset = 0;
+      m_lastTag = m_messages.front().tag;
+      m_messages.pop_front();
+    }
+
+    // the socket took less than offered, it is full
+    if (!m_messages.empty() && (count < MAX_IOV || m_offset != 0))
+      break;
+  }
+
+  return total;
+}
+
+void
+OutboundQueue::clear()
+{
+  m_messages.clear();
+  m_arena.reset();
+  m_offset = 0;
+  m_lastTag = 0;
+  m_size = 0;
+}
+
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_OUTBOUND_QUEUE_HPP
+#define SBT_UTIL_OUTBOUND_QUEUE_HPP
+
+#include "buffer-view.hpp"
+#include "raw-buffer.hpp"
+
+#include <deque>
+
+namespace sbt {
+namespace util {
+
+/**
+ * @brief Framed messages waiting to be written to one connection
+ *
+ * Messages are queued as they are produced and written out together, so the control
+ * messages of a round go out in the same writev as the next Piece instead of one
+ * send each.
+ */
+class OutboundQueue
+{
+public:
+  // buffers handed to one writev
+  static const size_t MAX_IOV = 64;
+
+  // bytes of small messages copied into one arena
+  static const size_t ARENA_SIZE = 4096;
+
+public:
+  OutboundQueue();
+
+  void
+  push(ConstBufferPtr message);
+
+  /**
+   * @brief Queue bytes owned elsewhere, such as a pooled block, without copying them
+   *
+   * Pieces of a message pushed with the same nonzero @p tag can be taken back
+   * together with cancel().
+   */
+  void
+  push(const BufferView& bytes, uint64_t tag = 0);
+
+  /**
+   * @brief Queue a copy of a small message, such as one encoded on the stack
+   *
+   * Copies go into an arena of the queue's own, reused once they are written, and
+   * consecutive untagged ones go out as a single buffer.
+   */
+  void
+  pushCopy(const uint8_t* data, size_t length, uint64_t tag = 0);
+
+  /**
+   * @brief Take back the messages pushed with @p tag that have not started going out
+   * @returns bytes taken back
+   */
+  size_t
+  cancel(uint64_t tag);
+
+  /**
+   * @brief Write as much as @p fd takes without blocking
+   * @returns bytes written, or -errno; -EAGAIN only if nothing could be written
+   */
+  ssize_t
+  flush(int fd);
+
+  bool
+  empty() const
+  {
+    return m_messages.empty();
+  }
+
+  /**
+   * @brief Bytes still to be written
+   */
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  void
+  clear();
+
+private:
+  struct Entry
+  {
+    BufferView bytes;
+    uint64_t tag;
+  };
+
+  std::deque<Entry> m_messages;
+  std::shared_ptr<RawBuffer> m_arena;
+  size_t m_offset; // bytes of the front message already written
+  uint64_t m_lastTag; // tag of the last entry fully written
+  size_t m_size;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_OUTBOUND_QUEUE_HPP
@@ -0,0 +1,87 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "rate-limiter.hpp"
+
+#include <algorithm>
+
+namespace sbt {
+namespace util {
+
+const size_t RateLease::LEASE_SIZE;
+
+RateLimiter::RateLimiter(uint64_t bytesPerSecond)
+  : m_lastRefill(0)
+{
+  setRate(bytesPerSecond);
+}
+
+void
+RateLimiter::setRate(uint64_t bytesPerSecond)
+{
+  m_rate = bytesPerSecond;
+  m_tokens = bytesPerSecond;
+}
+
+uint64_t
+RateLimiter::reserve(size_t bytes, uint64_t now)
+{
+  if (m_rate == 0)
+    return 0;
+
+  if (now > m_lastRefill) {
+    int64_t refill = (now - m_lastRefill) * m_rate / 1000;
+    if (m_tokens + refill >= static_cast<int64_t>(m_rate)) {
+      m_tokens = m_rate;
+      m_lastRefill = now;
+    }
+    else if (refill > 0) {
+      // keep the fraction of a byte not credited yet for the next refill
+      m_tokens += refill;
+      m_lastRefill += refill * 1000 / m_rate;
+    }
+  }
+
+  m_tokens -= bytes;
+  if (m_tokens >= 0)
+    return 0;
+
+  return (-m_tokens * 1000 + m_rate - 1) / m_rate;
+}
+
+RateLease::RateLease(RateLimiter& limiter, std::mutex& mutex)
+  : m_limiter(limiter)
+  , m_mutex(mutex)
+  , m_left(0)
+{
+}
+
+uint64_t
+RateLease::getRate() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_limiter.getRate();
+}
+
+uint64_t
+RateLease::reserve(size_t bytes, uint64_t now)
+{
+  if (bytes <= m_left) {
+    m_left -= bytes;
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t rate = m_limiter.getRate();
+  size_t lease = rate == 0 ? LEASE_SIZE : std::min<uint64_t>(LEASE_SIZE, rate / 10);
+  size_t take = std::max(bytes - m_left, lease);
+  m_left += take - bytes;
+  return m_limiter.reserve(take, now);
+}
+
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_RATE_LIMITER_HPP
+#define SBT_UTIL_RATE_LIMITER_HPP
+
+#include "timer-wheel.hpp"
+
+#include <mutex>
+
+namespace sbt {
+namespace util {
+
+/**
+ * @brief Token bucket shared by every transfer it limits
+ *
+ * Tokens accrue at the configured rate up to one second's worth.  Callers reserve
+ * what they are about to send and are told how long to hold off; reservations may
+ * run the bucket into debt, so large transfers are never starved by small ones.
+ */
+class RateLimiter
+{
+public:
+  /**
+   * @param bytesPerSecond  0 for no limit
+   */
+  explicit
+  RateLimiter(uint64_t bytesPerSecond = 0);
+
+  void
+  setRate(uint64_t bytesPerSecond);
+
+  uint64_t
+  getRate() const
+  {
+    return m_rate;
+  }
+
+  /**
+   * @brief Account for @p bytes about to be transferred
+   * @returns ms to wait before transferring them
+   */
+  uint64_t
+  reserve(size_t bytes, uint64_t now = steadyNow());
+
+private:
+  uint64_t m_rate;
+  int64_t m_tokens;
+  uint64_t m_lastRefill;
+};
+
+/**
+ * @brief One thread's share of a RateLimiter that several threads draw from
+ *
+ * Bytes are taken from the shared limiter under its mutex, a lease at a time, and
+ * handed out locally until the lease runs out.  A busy thread thus gets as much of
+ * the rate as it uses, while an idle one holds at most one lease of it.
+ */
+class RateLease
+{
+public:
+  /**
+   * @brief Most taken at once, and never more than a tenth of a second's worth
+   */
+  static const size_t LEASE_SIZE = 64 * 1024;
+
+  RateLease(RateLimiter& limiter, std::mutex& mutex);
+
+  uint64_t
+  getRate() const;
+
+  /**
+   * @brief Account for @p bytes about to be transferred
+   * @returns ms to wait before transferring them
+   */
+  uint64_t
+  reserve(size_t bytes, uint64_t now = steadyNow());
+
+private:
+  RateLimiter& m_limiter;
+  std::mutex& m_mutex;
+  size_t m_left;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_RATE_LIMITER_HPP
@@ -0,0 +1,79 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "raw-buffer.hpp"
+
+#include <algorithm>
+
+namespace sbt {
+
+RawBuffer::RawBuffer()
+  : m_size(0)
+  , m_capacity(0)
+{
+}
+
+RawBuffer::RawBuffer(size_t size)
+  : m_data(new uint8_t[size])
+  , m_size(size)
+  , m_capacity(size)
+{
+}
+
+RawBuffer::RawBuffer(RawBuffer&& other)
+  : m_data(std::move(other.m_data))
+  , m_size(other.m_size)
+  , m_capacity(other.m_capacity)
+{
+  other.m_size = 0;
+  other.m_capacity = 0;
+}
+
+RawBuffer&
+RawBuffer::operator=(RawBuffer&& other)
+{
+  m_data = std::move(other.m_data);
+  m_size = other.m_size;
+  m_capacity = other.m_capacity;
+  other.m_size = 0;
+  other.m_capacity = 0;
+  return *this;
+}
+
+void
+RawBuffer::resize(size_t size)
+{
+  if (size > m_capacity)
+    reserve(std::max(size, 2 * m_capacity));
+  m_size = size;
+}
+
+void
+RawBuffer::reserve(size_t capacity)
+{
+  if (capacity <= m_capacity)
+    return;
+
+  std::unique_ptr<uint8_t[]> data(new uint8_t[capacity]);
+  if (m_size > 0)
+    memcpy(data.get(), m_data.get(), m_size);
+  m_data = std::move(data);
+  m_capacity = capacity;
+}
+
+void
+RawBuffer::append(const void* data, size_t length)
+{
+  if (length == 0)
+    return;
+
+  size_t offset = m_size;
+  resize(m_size + length);
+  memcpy(m_data.get() + offset, data, length);
+}
+
+} // namespace sbt
@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_RAW_BUFFER_HPP
+#define SBT_UTIL_RAW_BUFFER_HPP
+
+#include "../common.hpp"
+
+namespace sbt {
+
+/**
+ * @brief Growable bytes that, unlike Buffer, are never zero-filled
+ *
+ * resize() leaves new bytes uninitialised, for data about to be received or read
+ * into them, and clear() keeps the capacity, so one RawBuffer can be reused for many
+ * messages without allocating again.
+ */
+class RawBuffer
+{
+public:
+  RawBuffer();
+
+  /**
+   * @brief A buffer of @p size uninitialised bytes
+   */
+  explicit
+  RawBuffer(size_t size);
+
+  RawBuffer(RawBuffer&& other);
+
+  RawBuffer&
+  operator=(RawBuffer&& other);
+
+  uint8_t*
+  data()
+  {
+    return m_data.get();
+  }
+
+  const uint8_t*
+  data() const
+  {
+    return m_data.get();
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  bool
+  empty() const
+  {
+    return m_size == 0;
+  }
+
+  size_t
+  capacity() const
+  {
+    return m_capacity;
+  }
+
+  /**
+   * @brief Change the size; bytes past the old size are left uninitialised
+   */
+  void
+  resize(size_t size);
+
+  /**
+   * @brief Make room for @p capacity bytes in total
+   */
+  void
+  reserve(size_t capacity);
+
+  /**
+   * @brief Drop the contents but keep the memory for reuse
+   */
+  void
+  clear()
+  {
+    m_size = 0;
+  }
+
+  void
+  append(const void* data, size_t length);
+
+private:
+  std::unique_ptr<uint8_t[]> m_data;
+  size_t m_size;
+  size_t m_capacity;
+};
+
+} // namespace sbt
+
+#endif // SBT_UTIL_RAW_BUFFER_HPP
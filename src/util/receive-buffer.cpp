@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "receive-buffer.hpp"
+
+namespace sbt {
+namespace util {
+
+ReceiveBuffer::ReceiveBuffer(size_t chunkSize)
+  : m_chunkSize(chunkSize)
+  , m_cache(nullptr)
+  , m_capacity(0)
+  , m_begin(0)
+  , m_end(0)
+{
+}
+
+ReceiveBuffer::ReceiveBuffer(SlabPool::Cache& cache)
+  : m_chunkSize(cache.getSlabSize())
+  , m_cache(&cache)
+  , m_capacity(0)
+  , m_begin(0)
+  , m_end(0)
+{
+}
+
+uint8_t*
+ReceiveBuffer::prepare(size_t minFree)
+{
+  if (m_chunk && m_capacity - m_end >= minFree)
+    return m_chunk.get() + m_end;
+
+  size_t needed = size() + minFree;
+  if (m_chunk && m_chunk.use_count() == 1 && m_capacity >= needed) {
+    // nobody else looks at the chunk, the unconsumed bytes can move to its front
+    memmove(m_chunk.get(), m_chunk.get() + m_begin, size());
+  }
+  else {
+    std::shared_ptr<uint8_t> chunk;
+    size_t capacity = m_chunkSize;
+    if (m_cache != nullptr && needed <= capacity)
+      chunk = m_cache->acquire();
+
+    // too big for a slab, or the pool is at its ceiling
+    if (!chunk) {
+      capacity = std::max(m_chunkSize, needed);
+      auto buffer = make_shared<RawBuffer>(capacity);
+      chunk = std::shared_ptr<uint8_t>(buffer, buffer->data());
+    }
+
+    if (size() > 0)
+      memcpy(chunk.get(), m_chunk.get() + m_begin, size());
+    m_chunk = chunk;
+    m_capacity = capacity;
+  }
+
+  m_end = size();
+  m_begin = 0;
+  return m_chunk.get() + m_end;
+}
+
+size_t
+ReceiveBuffer::getFree() const
+{
+  return m_capacity - m_end;
+}
+
+void
+ReceiveBuffer::commit(size_t n)
+{
+  m_end += n;
+}
+
+const uint8_t*
+ReceiveBuffer::data() const
+{
+  return m_chunk ? m_chunk.get() + m_begin : nullptr;
+}
+
+void
+ReceiveBuffer::consume(size_t n)
+{
+  m_begin += n;
+
+  // start over at the front, unless views still point into the chunk
+  if (m_begin == m_end && m_chunk.use_count() == 1)
+    m_begin = m_end = 0;
+}
+
+BufferView
+ReceiveBuffer::view(size_t offset, size_t length) const
+{
+  return BufferView(m_chunk, m_chunk.get() + m_begin + offset, length);
+}
+
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,90 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_RECEIVE_BUFFER_HPP
+#define SBT_UTIL_RECEIVE_BUFFER_HPP
+
+#include "buffer-view.hpp"
+#include "raw-buffer.hpp"
+#include "slab-pool.hpp"
+
+namespace sbt {
+namespace util {
+
+/**
+ * @brief Bytes received on a connection and not consumed yet, in one shared chunk
+ *
+ * Data is received straight into the chunk and messages are parsed in place; view()
+ * hands out parts of it without copying.  While such views are alive the chunk is not
+ * reused: when room runs out, the unconsumed tail moves to a fresh chunk and the old
+ * one lives on as long as its views do.
+ */
+class ReceiveBuffer
+{
+public:
+  static const size_t CHUNK_SIZE = 65536;
+
+public:
+  explicit
+  ReceiveBuffer(size_t chunkSize = CHUNK_SIZE);
+
+  /**
+   * @brief Take chunks from @p cache, as long as what is needed fits in a slab
+   */
+  explicit
+  ReceiveBuffer(SlabPool::Cache& cache);
+
+  /**
+   * @brief Make room for at least @p minFree more bytes
+   * @returns where to receive them; getFree() bytes may be written
+   */
+  uint8_t*
+  prepare(size_t minFree);
+
+  size_t
+  getFree() const;
+
+  /**
+   * @brief Mark @p n bytes written after prepare() as received
+   */
+  void
+  commit(size_t n);
+
+  /**
+   * @brief The received bytes not consumed yet
+   */
+  const uint8_t*
+  data() const;
+
+  size_t
+  size() const
+  {
+    return m_end - m_begin;
+  }
+
+  void
+  consume(size_t n);
+
+  /**
+   * @brief @p length unconsumed bytes from @p offset on, without copying them
+   */
+  BufferView
+  view(size_t offset, size_t length) const;
+
+private:
+  size_t m_chunkSize;
+  SlabPool::Cache* m_cache;
+  std::shared_ptr<uint8_t> m_chunk;
+  size_t m_capacity;
+  size_t m_begin;
+  size_t m_end;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_RECEIVE_BUFFER_HPP
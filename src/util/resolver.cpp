@@ -0,0 +1,116 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "resolver.hpp"
+
+#include <netdb.h>
+
+namespace sbt {
+namespace util {
+
+Resolver::Resolver(EventLoop& loop, uint64_t ttlMs)
+  : m_loop(loop)
+  , m_ttl(ttlMs)
+  , m_isStopping(false)
+{
+  m_thread = std::thread([this] { work(); });
+}
+
+Resolver::~Resolver()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isStopping = true;
+  }
+  m_condition.notify_one();
+  m_thread.join();
+}
+
+void
+Resolver::resolve(const std::string& host, const std::string& port, const Callback& callback)
+{
+  std::string key = host + ":" + port;
+
+  auto it = m_cache.find(key);
+  if (it != m_cache.end()) {
+    if (it->second.expiry > steadyNow()) {
+      Entry entry = it->second;
+      m_loop.post([callback, entry] { callback(0, entry.addr, entry.length); });
+      return;
+    }
+    m_cache.erase(it);
+  }
+
+  std::vector<Callback>& waiting = m_pending[key];
+  waiting.push_back(callback);
+  if (waiting.size() > 1)
+    return; // already being looked up
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queries.push_back(Query{host, port});
+  }
+  m_condition.notify_one();
+}
+
+void
+Resolver::work()
+{
+  while (true) {
+    Query query;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this] { return m_isStopping || !m_queries.empty(); });
+      if (m_isStopping)
+        return;
+
+      query = m_queries.front();
+      m_queries.pop_front();
+    }
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET; // we only bind and connect over IPv4
+    hints.ai_socktype = SOCK_STREAM;
+
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    int rc = getaddrinfo(query.host.c_str(), query.port.c_str(), &hints, &res);
+    if (rc == 0) {
+      memcpy(&entry.addr, res->ai_addr, res->ai_addrlen);
+      entry.length = res->ai_addrlen;
+      freeaddrinfo(res);
+    }
+
+    std::string key = query.host + ":" + query.port;
+    m_loop.post([this, key, rc, entry] { onResolved(key, rc, entry); });
+  }
+}
+
+void
+Resolver::onResolved(const std::string& key, int rc, const Entry& entry)
+{
+  if (rc == 0) {
+    Entry& cached = m_cache[key];
+    cached = entry;
+    cached.expiry = steadyNow() + m_ttl;
+  }
+
+  auto it = m_pending.find(key);
+  if (it == m_pending.end())
+    return;
+
+  std::vector<Callback> waiting;
+  waiting.swap(it->second);
+  m_pending.erase(it);
+
+  for (size_t i = 0; i < waiting.size(); i++)
+    waiting[i](rc, entry.addr, entry.length);
+}
+
+} // namespace util
+} // namespace sbt
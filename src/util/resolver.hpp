@@ -0,0 +1,99 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_RESOLVER_HPP
+#define SBT_UTIL_RESOLVER_HPP
+
+#include "event-loop.hpp"
+
+#include <sys/socket.h>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+
+namespace sbt {
+namespace util {
+
+/**
+ * @brief Caching host name resolver that never blocks the event loop
+ *
+ * getaddrinfo runs on a background thread; results are handed back to the loop with
+ * EventLoop::post and kept for a while, so periodic lookups of the same tracker cost
+ * nothing.  Concurrent lookups of one name share a single query.
+ */
+class Resolver
+{
+public:
+  /**
+   * @param rc      0 on success, otherwise a getaddrinfo error (see gai_strerror)
+   * @param addr    first address found
+   * @param length  size of @p addr
+   */
+  typedef function<void(int rc, const sockaddr_storage& addr, socklen_t length)> Callback;
+
+  Resolver(EventLoop& loop, uint64_t ttlMs = 300000);
+
+  /**
+   * @brief Stop the worker; queries still in flight are dropped
+   */
+  ~Resolver();
+
+  /**
+   * @brief Look up @p host and @p port
+   *
+   * @p callback always runs later from the event loop, even on a cache hit.
+   */
+  void
+  resolve(const std::string& host, const std::string& port, const Callback& callback);
+
+  size_t
+  getCacheSize() const
+  {
+    return m_cache.size();
+  }
+
+private:
+  struct Entry
+  {
+    sockaddr_storage addr;
+    socklen_t length;
+    uint64_t expiry;
+  };
+
+  struct Query
+  {
+    std::string host;
+    std::string port;
+  };
+
+  void
+  work();
+
+  void
+  onResolved(const std::string& key, int rc, const Entry& entry);
+
+private:
+  EventLoop& m_loop;
+  uint64_t m_ttl;
+
+  // loop thread only
+  std::unordered_map<std::string, Entry> m_cache;
+  std::unordered_map<std::string, std::vector<Callback>> m_pending;
+
+  // shared with the worker
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<Query> m_queries;
+  bool m_isStopping;
+  std::thread m_thread;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_RESOLVER_HPP
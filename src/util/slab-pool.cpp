@@ -0,0 +1,167 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "slab-pool.hpp"
+
+#include <cstddef>
+
+namespace sbt {
+namespace util {
+
+const size_t SlabPool::CACHE_SLABS;
+const size_t SlabPool::CONTROL_SIZE;
+
+// a slab is handed out as a shared_ptr that owns nothing to delete, its control
+// block's allocator gives it back
+struct NoDelete
+{
+  void
+  operator()(uint8_t*) const
+  {
+  }
+};
+
+SlabPool::Cache::Cache(SlabPool& pool)
+  : m_pool(pool)
+  , m_free(nullptr)
+{
+}
+
+SlabPool::Cache::~Cache()
+{
+  if (m_free == nullptr)
+    return;
+
+  Node* last = m_free;
+  while (last->next != nullptr)
+    last = last->next;
+  m_pool.releaseAll(m_free, last);
+}
+
+SlabPool::Slab
+SlabPool::Cache::acquire()
+{
+  if (m_free == nullptr)
+    m_free = m_pool.takeReturned();
+
+  Node* node = m_free;
+  if (node == nullptr)
+    return m_pool.wrap(m_pool.allocate());
+
+  m_free = node->next;
+  return m_pool.wrap(node);
+}
+
+SlabPool::SlabPool(size_t slabSize, size_t maxBytes)
+  : m_slabSize(std::max(slabSize, sizeof(Node)))
+  , m_controlOffset((m_slabSize + alignof(std::max_align_t) - 1) /
+                    alignof(std::max_align_t) * alignof(std::max_align_t))
+  , m_maxBytes(maxBytes)
+  , m_allocated(0)
+  , m_returned(nullptr)
+  , m_free(nullptr)
+{
+}
+
+SlabPool::~SlabPool()
+{
+  destroy(m_returned.load());
+  destroy(m_free);
+}
+
+SlabPool::Slab
+SlabPool::acquire()
+{
+  void* slab;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free == nullptr)
+      m_free = takeReturned();
+
+    slab = m_free;
+    if (m_free != nullptr)
+      m_free = m_free->next;
+  }
+
+  return wrap(slab != nullptr ? slab : allocate());
+}
+
+SlabPool::Slab
+SlabPool::wrap(void* slab)
+{
+  if (slab == nullptr)
+    return nullptr;
+
+  uint8_t* p = static_cast<uint8_t*>(slab);
+  return Slab(p, NoDelete(), ControlAllocator<uint8_t>(this, p));
+}
+
+void*
+SlabPool::allocate()
+{
+  size_t maxBytes = m_maxBytes;
+  size_t allocated = m_allocated.fetch_add(m_slabSize) + m_slabSize;
+  if (maxBytes != 0 && allocated > maxBytes) {
+    m_allocated -= m_slabSize;
+    return nullptr;
+  }
+
+  // default-initialised, the bytes are about to be overwritten anyway
+  return new uint8_t[m_controlOffset + CONTROL_SIZE];
+}
+
+void
+SlabPool::release(void* slab)
+{
+  Node* node = static_cast<Node*>(slab);
+  releaseAll(node, node);
+}
+
+void
+SlabPool::releaseAll(Node* first, Node* last)
+{
+  last->next = m_returned.load(std::memory_order_relaxed);
+  while (!m_returned.compare_exchange_weak(last->next, first, std::memory_order_release,
+                                           std::memory_order_relaxed))
+    ;
+}
+
+SlabPool::Node*
+SlabPool::takeReturned()
+{
+  // taking everything at once is what keeps the lock-free stack free of ABA
+  Node* first = m_returned.exchange(nullptr, std::memory_order_acquire);
+
+  Node* last = first;
+  for (size_t i = 1; last != nullptr && i < CACHE_SLABS; i++)
+    last = last->next;
+  if (last == nullptr || last->next == nullptr)
+    return first;
+
+  // more than one thread's share, the rest goes back for the others
+  Node* rest = last->next;
+  last->next = nullptr;
+  Node* restLast = rest;
+  while (restLast->next != nullptr)
+    restLast = restLast->next;
+  releaseAll(rest, restLast);
+
+  return first;
+}
+
+void
+SlabPool::destroy(Node* list)
+{
+  while (list != nullptr) {
+    Node* next = list->next;
+    delete[] reinterpret_cast<uint8_t*>(list);
+    list = next;
+  }
+}
+
+} // namespace util
+} // namespace sbt
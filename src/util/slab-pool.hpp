@@ -0,0 +1,230 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_SLAB_POOL_HPP
+#define SBT_UTIL_SLAB_POOL_HPP
+
+#include "../common.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+namespace sbt {
+namespace util {
+
+/**
+ * @brief Recycled fixed-size buffers, such as 16 KiB blocks or whole pieces
+ *
+ * Slabs are handed out uninitialised and go back to the pool when their last
+ * reference is dropped, on whatever thread that happens, with a lock-free push.
+ * The shared_ptr control block of a slab lives in room kept behind it, so handing
+ * one out allocates nothing once the pool is warm.  Threads that allocate a lot take
+ * slabs from a Cache of their own, which refills itself with up to CACHE_SLABS of
+ * those returned so far in one go and leaves the rest to other threads.  The pool
+ * never holds more than its ceiling; past it, acquiring fails and callers fall back
+ * to the heap.
+ *
+ * The pool must outlive its caches and every slab it handed out.
+ */
+class SlabPool
+{
+private:
+  struct Node;
+
+public:
+  typedef std::shared_ptr<uint8_t> Slab;
+
+  // most free slabs one Cache, or acquire() without one, keeps to itself
+  static const size_t CACHE_SLABS = 64;
+
+  /**
+   * @brief Slabs for one thread; not thread-safe itself
+   */
+  class Cache
+  {
+  public:
+    explicit
+    Cache(SlabPool& pool);
+
+    /**
+     * @brief Give the slabs still cached back to the pool
+     */
+    ~Cache();
+
+    /**
+     * @returns a slab of getSlabSize() bytes, or nullptr past the ceiling
+     */
+    Slab
+    acquire();
+
+    size_t
+    getSlabSize() const
+    {
+      return m_pool.getSlabSize();
+    }
+
+  private:
+    SlabPool& m_pool;
+    Node* m_free;
+  };
+
+public:
+  /**
+   * @param maxBytes  ceiling on the memory of all slabs together, 0 for none
+   */
+  explicit
+  SlabPool(size_t slabSize, size_t maxBytes = 0);
+
+  ~SlabPool();
+
+  /**
+   * @brief Acquire without a Cache; safe from any thread
+   * @returns a slab of getSlabSize() bytes, or nullptr past the ceiling
+   */
+  Slab
+  acquire();
+
+  size_t
+  getSlabSize() const
+  {
+    return m_slabSize;
+  }
+
+  size_t
+  getMaxBytes() const
+  {
+    return m_maxBytes;
+  }
+
+  /**
+   * @brief Change the ceiling; slabs already allocated stay
+   */
+  void
+  setMaxBytes(size_t maxBytes)
+  {
+    m_maxBytes = maxBytes;
+  }
+
+  /**
+   * @brief Memory of all slabs allocated, whether in use or free
+   */
+  size_t
+  getAllocatedBytes() const
+  {
+    return m_allocated;
+  }
+
+private:
+  struct Node
+  {
+    Node* next;
+  };
+
+  // room behind each slab for its shared_ptr control block
+  static const size_t CONTROL_SIZE = 64;
+
+  /**
+   * @brief Places a slab's control block in the room behind it
+   *
+   * Freeing the control block is the last the shared_ptr does with a slab, so that
+   * is where the slab goes back to the pool.
+   */
+  template<typename T>
+  struct ControlAllocator
+  {
+    typedef T value_type;
+
+    ControlAllocator(SlabPool* pool, uint8_t* slab)
+      : pool(pool)
+      , slab(slab)
+    {
+    }
+
+    template<typename U>
+    ControlAllocator(const ControlAllocator<U>& other)
+      : pool(other.pool)
+      , slab(other.slab)
+    {
+    }
+
+    T*
+    allocate(size_t n)
+    {
+      if (n * sizeof(T) > CONTROL_SIZE)
+        throw std::bad_alloc();
+      return reinterpret_cast<T*>(slab + pool->m_controlOffset);
+    }
+
+    void
+    deallocate(T*, size_t)
+    {
+      pool->release(slab);
+    }
+
+    template<typename U>
+    bool
+    operator==(const ControlAllocator<U>& other) const
+    {
+      return slab == other.slab;
+    }
+
+    template<typename U>
+    bool
+    operator!=(const ControlAllocator<U>& other) const
+    {
+      return slab != other.slab;
+    }
+
+    SlabPool* pool;
+    uint8_t* slab;
+  };
+
+  Slab
+  wrap(void* slab);
+
+  void*
+  allocate();
+
+  void
+  release(void* slab);
+
+  /**
+   * @brief Push the list from @p first to @p last back in one go
+   */
+  void
+  releaseAll(Node* first, Node* last);
+
+  /**
+   * @brief Take up to CACHE_SLABS of the returned slabs, the rest stays for others
+   */
+  Node*
+  takeReturned();
+
+  static void
+  destroy(Node* list);
+
+private:
+  size_t m_slabSize;
+  size_t m_controlOffset; // of the control block room, from the start of a slab
+  std::atomic<size_t> m_maxBytes;
+  std::atomic<size_t> m_allocated;
+
+  // freed slabs, pushed lock-free and only ever taken all at once; what a taker does
+  // not keep is pushed back
+  std::atomic<Node*> m_returned;
+
+  // for acquire() without a cache
+  std::mutex m_mutex;
+  Node* m_free;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_SLAB_POOL_HPP
@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "timer-wheel.hpp"
+
+#include <chrono>
+
+namespace sbt {
+namespace util {
+
+const size_t TimerWheel::SLOT_BITS;
+const size_t TimerWheel::SLOTS;
+const size_t TimerWheel::LEVELS;
+
+uint64_t
+steadyNow()
+{
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+TimerWheel::TimerWheel(uint64_t now, uint32_t tickMs)
+  : m_tickMs(tickMs)
+  , m_tick(0)
+  , m_startMs(now)
+  , m_nextId(1)
+{
+}
+
+TimerWheel::TimerId
+TimerWheel::schedule(uint64_t delayMs, const Callback& callback)
+{
+  uint64_t ticks = (delayMs + m_tickMs - 1) / m_tickMs;
+  if (ticks == 0)
+    ticks = 1;
+
+  Timer timer;
+  timer.id = m_nextId++;
+  timer.expiry = m_tick + ticks;
+  timer.callback = callback;
+
+  Slot pending;
+  pending.push_back(timer);
+  insert(pending, pending.begin());
+
+  return timer.id;
+}
+
+bool
+TimerWheel::cancel(TimerId id)
+{
+  auto it = m_index.find(id);
+  if (it == m_index.end())
+    return false;
+
+  it->second.slot->erase(it->second.timer);
+  m_index.erase(it);
+  return true;
+}
+
+void
+TimerWheel::advance(uint64_t now)
+{
+  if (now < m_startMs)
+    return;
+
+  uint64_t target = (now - m_startMs) / m_tickMs;
+
+  while (m_tick < target) {
+    if (m_index.empty()) {
+      m_tick = target;
+      break;
+    }
+
+    m_tick++;
+
+    // move timers of the coarser levels down when the level below wraps around
+    for (size_t level = 1; level < LEVELS; level++) {
+      if ((m_tick & ((static_cast<uint64_t>(1) << (SLOT_BITS * level)) - 1)) != 0)
+        break;
+      cascade(level);
+    }
+
+    // take expired timers out first, callbacks are free to touch the wheel
+    Slot expired;
+    expired.splice(expired.end(), m_slots[0][m_tick & (SLOTS - 1)]);
+    for (const auto& timer : expired)
+      m_index.erase(timer.id);
+
+    for (const auto& timer : expired)
+      timer.callback();
+  }
+}
+
+int
+TimerWheel::getTimeout(uint64_t now) const
+{
+  if (m_index.empty())
+    return -1;
+
+  uint64_t tick = m_tick + 1;
+  for (; (tick & (SLOTS - 1)) != 0; tick++) {
+    if (!m_slots[0][tick & (SLOTS - 1)].empty())
+      break;
+  }
+
+  uint64_t when = m_startMs + tick * m_tickMs;
+  return when > now ? static_cast<int>(when - now) : 0;
+}
+
+void
+TimerWheel::insert(Slot& from, Slot::iterator timer)
+{
+  uint64_t delta = timer->expiry > m_tick ? timer->expiry - m_tick : 0;
+
+  size_t level = 0;
+  while (level < LEVELS - 1 && delta >= (static_cast<uint64_t>(1) << (SLOT_BITS * (level + 1))))
+    level++;
+
+  Slot& slot = m_slots[level][(timer->expiry >> (SLOT_BITS * level)) & (SLOTS - 1)];
+  slot.splice(slot.end(), from, timer);
+
+  Position& pos = m_index[timer->id];
+  pos.slot = &slot;
+  pos.timer = timer;
+}
+
+void
+TimerWheel::cascade(size_t level)
+{
+  Slot pending;
+  pending.splice(pending.end(), m_slots[level][(m_tick >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+
+  while (!pending.empty())
+    insert(pending, pending.begin());
+}
+
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,121 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_UTIL_TIMER_WHEEL_HPP
+#define SBT_UTIL_TIMER_WHEEL_HPP
+
+#include "../common.hpp"
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+namespace sbt {
+namespace util {
+
+/**
+ * @return milliseconds on a monotonic clock
+ */
+uint64_t
+steadyNow();
+
+/**
+ * @brief Hierarchical hashed timer wheel
+ *
+ * Level 0 has one slot per tick, every further level has slots that are SLOTS times
+ * coarser.  A timer is hashed into the lowest level whose range covers its expiry, and
+ * moves down a level each time the level below completes a revolution.  Scheduling and
+ * cancelling are O(1); advance() only touches the slots of the ticks that passed, so
+ * thousands of connections can share one wheel.
+ */
+class TimerWheel
+{
+public:
+  typedef uint64_t TimerId;
+  typedef function<void()> Callback;
+
+  static const size_t SLOT_BITS = 6;
+  static const size_t SLOTS = 1 << SLOT_BITS;
+  static const size_t LEVELS = 4;
+
+public:
+  /**
+   * @param now    current time in milliseconds
+   * @param tickMs resolution of the wheel
+   */
+  explicit
+  TimerWheel(uint64_t now, uint32_t tickMs = 100);
+
+  /**
+   * @brief Run @p callback once, @p delayMs milliseconds after the last advance()
+   * @returns id that can be passed to cancel(), never 0
+   */
+  TimerId
+  schedule(uint64_t delayMs, const Callback& callback);
+
+  /**
+   * @returns true if the timer was pending
+   */
+  bool
+  cancel(TimerId id);
+
+  /**
+   * @brief Move the wheel to @p now and run every timer that expired
+   *
+   * Callbacks may schedule or cancel timers.
+   */
+  void
+  advance(uint64_t now);
+
+  /**
+   * @brief Milliseconds from @p now until the wheel has work to do
+   *
+   * This is a lower bound suitable as a poll timeout; -1 if no timer is pending.
+   */
+  int
+  getTimeout(uint64_t now) const;
+
+  size_t
+  size() const
+  {
+    return m_index.size();
+  }
+
+private:
+  struct Timer
+  {
+    TimerId id;
+    uint64_t expiry; // absolute tick
+    Callback callback;
+  };
+
+  typedef std::list<Timer> Slot;
+
+  struct Position
+  {
+    Slot* slot;
+    Slot::iterator timer;
+  };
+
+  void
+  insert(Slot& from, Slot::iterator timer);
+
+  void
+  cascade(size_t level);
+
+private:
+  uint32_t m_tickMs;
+  uint64_t m_tick;    // last processed tick
+  uint64_t m_startMs; // time of tick 0
+  TimerId m_nextId;
+  Slot m_slots[LEVELS][SLOTS];
+  std::unordered_map<TimerId, Position> m_index;
+};
+
+} // namespace util
+} // namespace sbt
+
+#endif // SBT_UTIL_TIMER_WHEEL_HPP
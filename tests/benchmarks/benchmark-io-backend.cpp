@@ -0,0 +1,294 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/event-loop.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+namespace sbt {
+namespace benchmark {
+
+static const size_t BLOCK = 16384;
+static const size_t BATCH = 32;
+static const uint64_t FILE_SIZE = 64 << 20;
+
+struct Result
+{
+  uint64_t nSyscalls;
+  double seconds;
+};
+
+static void
+report(const char* name, const char* backend, uint64_t nBytes, const Result& result)
+{
+  double gib = static_cast<double>(nBytes) / (1 << 30);
+  printf("%-6s %-9s %10.0f syscalls/GiB %9.1f MiB/s\n", name, backend,
+         result.nSyscalls / gib, nBytes / result.seconds / (1 << 20));
+}
+
+static double
+since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Reads and discards everything that arrives on @p sockfd, standing in for the peer
+ * being seeded to.
+ */
+static std::thread
+drain(int sockfd)
+{
+  return std::thread([sockfd] {
+    std::vector<uint8_t> buf(1 << 20);
+    while (read(sockfd, buf.data(), buf.size()) > 0) {
+    }
+  });
+}
+
+/**
+ * Writes @p nBytes to @p sockfd, standing in for the peer being downloaded from.
+ */
+static std::thread
+feed(int sockfd, uint64_t nBytes)
+{
+  return std::thread([sockfd, nBytes] {
+    std::vector<uint8_t> buf(1 << 20, 'x');
+    for (uint64_t sent = 0; sent < nBytes;) {
+      ssize_t n = write(sockfd, buf.data(), std::min<uint64_t>(buf.size(), nBytes - sent));
+      if (n <= 0)
+        return;
+      sent += n;
+    }
+    shutdown(sockfd, SHUT_WR);
+  });
+}
+
+// upload as the client does it: a batch of blocks is read through readAt, and each
+// one is sent as soon as it is in, one send per block.  On io_uring the reads share
+// the ring with the polls; on epoll they are a pread each.
+static Result
+seedLoop(util::EventLoop::Backend backend, int fd, int sockfd, uint64_t nBytes)
+{
+  util::EventLoop loop(backend);
+  bool isInline = loop.getBackend() == util::EventLoop::BACKEND_EPOLL;
+  Result result = {0, 0};
+  std::vector<uint8_t> buf(BLOCK * BATCH);
+  auto start = std::chrono::steady_clock::now();
+
+  for (uint64_t done = 0; done < nBytes; done += BLOCK * BATCH) {
+    size_t nPending = BATCH;
+    for (size_t i = 0; i < BATCH; i++) {
+      uint8_t* block = &buf[i * BLOCK];
+      loop.readAt(fd, block, BLOCK, (done + i * BLOCK) % FILE_SIZE, [&, block] (ssize_t n) {
+        for (ssize_t sent = 0; sent < n; result.nSyscalls++)
+          sent += send(sockfd, block + sent, n - sent, MSG_NOSIGNAL);
+        nPending--;
+      });
+      if (isInline)
+        result.nSyscalls++;
+    }
+
+    while (nPending > 0) {
+      loop.runOnce();
+      result.nSyscalls++;
+    }
+  }
+
+  result.seconds = since(start);
+  return result;
+}
+
+// upload: a batch of disk reads into registered buffers, then a batch of sends from
+// them, each batch one io_uring_enter
+static Result
+seedRing(int fd, int sockfd, uint64_t nBytes)
+{
+  util::IoUring ring;
+  std::vector<uint8_t> buf(BLOCK * BATCH);
+  struct iovec iov = {buf.data(), buf.size()};
+  ring.registerBuffers(&iov, 1);
+
+  std::vector<util::IoUring::Completion> completions;
+  auto start = std::chrono::steady_clock::now();
+
+  for (uint64_t done = 0; done < nBytes; done += BLOCK * BATCH) {
+    for (size_t i = 0; i < BATCH; i++)
+      ring.prepReadFixed(fd, &buf[i * BLOCK], BLOCK, (done + i * BLOCK) % FILE_SIZE, 0, i);
+    ring.submitAndWait(BATCH, -1);
+    completions.clear();
+    ring.reap(completions);
+
+    // a send on a stream socket may be short, those are finished one by one
+    std::vector<size_t> sent(BATCH, 0);
+    for (size_t i = 0; i < BATCH; i++)
+      ring.prepSend(sockfd, &buf[i * BLOCK], BLOCK, i);
+    size_t nPending = BATCH;
+    while (nPending > 0) {
+      ring.submitAndWait(1, -1);
+      completions.clear();
+      ring.reap(completions);
+      for (const auto& completion : completions) {
+        size_t i = completion.userData;
+        sent[i] += std::max(completion.result, 0);
+        if (completion.result <= 0 || sent[i] == BLOCK)
+          nPending--;
+        else
+          ring.prepSend(sockfd, &buf[i * BLOCK + sent[i]], BLOCK - sent[i], i);
+      }
+    }
+  }
+
+  return {ring.getEnterCount(), since(start)};
+}
+
+// download as the client does it: the event loop reports the socket readable, then
+// one recv, and the block goes to disk through writeAt, as Torrent::onPeerReadable and
+// handlePiece do.  On io_uring the writes share the ring with the polls; on epoll they
+// are a pwrite each.
+static Result
+leechLoop(util::EventLoop::Backend backend, int fd, int sockfd, uint64_t nBytes)
+{
+  util::EventLoop loop(backend);
+  bool isInline = loop.getBackend() == util::EventLoop::BACKEND_EPOLL;
+  Result result = {0, 0};
+  std::vector<uint8_t> buf(BLOCK * BATCH);
+  size_t next = 0;
+  uint64_t received = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  loop.add(sockfd, EPOLLIN, [&] (uint32_t) {
+    // buffers are reused round-robin; only throughput is measured, so a write that
+    // is still in flight when its buffer is refilled does not matter
+    uint8_t* block = &buf[next++ % BATCH * BLOCK];
+    ssize_t n = recv(sockfd, block, BLOCK, 0);
+    result.nSyscalls++;
+    if (n <= 0) {
+      loop.stop();
+      received = nBytes;
+      return;
+    }
+    loop.writeAt(fd, block, n, received % FILE_SIZE, [] (ssize_t) {});
+    if (isInline)
+      result.nSyscalls++;
+    received += n;
+  });
+
+  while (received < nBytes) {
+    loop.runOnce();
+    result.nSyscalls++;
+  }
+
+  result.seconds = since(start);
+  return result;
+}
+
+// download: a batch of socket reads into registered buffers, then a batch of disk
+// writes out of them, each batch one io_uring_enter
+static Result
+leechRing(int fd, int sockfd, uint64_t nBytes)
+{
+  util::IoUring ring;
+  std::vector<uint8_t> buf(BLOCK * BATCH);
+  struct iovec iov = {buf.data(), buf.size()};
+  ring.registerBuffers(&iov, 1);
+
+  std::vector<util::IoUring::Completion> completions;
+  uint64_t received = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  while (received < nBytes) {
+    for (size_t i = 0; i < BATCH; i++)
+      ring.prepReadFixed(sockfd, &buf[i * BLOCK], BLOCK, 0, 0, i);
+    ring.submitAndWait(BATCH, -1);
+    completions.clear();
+    ring.reap(completions);
+
+    // only throughput is measured, so where each buffer lands in the file does not matter
+    std::vector<int32_t> lengths(BATCH, 0);
+    for (const auto& completion : completions)
+      lengths[completion.userData] = completion.result;
+
+    size_t nWrites = 0;
+    for (size_t i = 0; i < BATCH && lengths[i] > 0; i++, nWrites++) {
+      ring.prepWriteFixed(fd, &buf[i * BLOCK], lengths[i], received % FILE_SIZE, 0, i);
+      received += lengths[i];
+    }
+    if (nWrites == 0)
+      break;
+    ring.submitAndWait(nWrites, -1);
+    completions.clear();
+    ring.reap(completions);
+  }
+
+  return {ring.getEnterCount(), since(start)};
+}
+
+} // namespace benchmark
+} // namespace sbt
+
+int
+main(int argc, char** argv)
+{
+  using namespace sbt::benchmark;
+
+  uint64_t nBytes = (argc > 1 ? atoll(argv[1]) : 1024) << 20;
+
+  char path[] = "/tmp/sbt-benchmark-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 || ftruncate(fd, FILE_SIZE) != 0) {
+    fprintf(stderr, "Cannot create %s\n", path);
+    return 1;
+  }
+  unlink(path);
+
+  printf("%llu MiB in %zu-byte blocks\n", static_cast<unsigned long long>(nBytes >> 20), BLOCK);
+  bool hasRing = sbt::util::IoUring::isSupported();
+  if (!hasRing)
+    printf("io_uring is not supported here, only the epoll numbers are meaningful\n");
+
+  // "epoll" and "io_uring" are the client's own path on each backend: readiness,
+  // then recv/send, with the disk I/O in the ring on io_uring.  "raw ring" keeps the
+  // sockets in the ring too, with registered buffers, which the client does not do
+  const char* names[] = {"epoll", "io_uring", "raw ring"};
+  int nRuns = hasRing ? 3 : 1;
+
+  for (int run = 0; run < nRuns; run++) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    std::thread peer = drain(fds[1]);
+    Result result = run == 2 ? seedRing(fd, fds[0], nBytes) :
+                    seedLoop(run == 0 ? sbt::util::EventLoop::BACKEND_EPOLL :
+                                        sbt::util::EventLoop::BACKEND_IO_URING, fd, fds[0], nBytes);
+    shutdown(fds[0], SHUT_WR);
+    peer.join();
+    report("seed", names[run], nBytes, result);
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  for (int run = 0; run < nRuns; run++) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    std::thread peer = feed(fds[1], nBytes);
+    Result result = run == 2 ? leechRing(fd, fds[0], nBytes) :
+                    leechLoop(run == 0 ? sbt::util::EventLoop::BACKEND_EPOLL :
+                                         sbt::util::EventLoop::BACKEND_IO_URING, fd, fds[0], nBytes);
+    peer.join();
+    report("leech", names[run], nBytes, result);
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,281 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "msg/dispatch.hpp"
+#include "msg/handshake.hpp"
+#include "util/outbound-queue.hpp"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <chrono>
+
+#include <boost/iostreams/stream.hpp>
+
+namespace sbt {
+namespace benchmark {
+
+// the stream OBufferStream used to be: vector-backed, appended a byte at a time
+class LegacyDevice
+{
+public:
+  typedef char char_type;
+  typedef boost::iostreams::sink_tag category;
+
+  explicit
+  LegacyDevice(Buffer& container)
+    : m_container(container)
+  {
+  }
+
+  std::streamsize
+  write(const char_type* s, std::streamsize n)
+  {
+    std::copy(s, s + n, std::back_inserter(m_container));
+    return n;
+  }
+
+private:
+  Buffer& m_container;
+};
+
+class LegacyStream : public boost::iostreams::stream<LegacyDevice>
+{
+public:
+  LegacyStream()
+    : m_buffer(std::make_shared<Buffer>())
+    , m_device(*m_buffer)
+  {
+    open(m_device);
+  }
+
+  BufferPtr
+  buf()
+  {
+    flush();
+    return m_buffer;
+  }
+
+private:
+  BufferPtr m_buffer;
+  LegacyDevice m_device;
+};
+
+static void
+writeUint32(std::ostream& os, uint32_t value)
+{
+  value = htonl(value);
+  os.write(reinterpret_cast<const char*>(&value), 4);
+}
+
+// what MsgBase::encode did with it: the payload in one stream, then the message
+static ConstBufferPtr
+legacyEncode(uint8_t id, const std::vector<uint32_t>& fields, ConstBufferPtr block)
+{
+  LegacyStream payloadStream;
+  for (uint32_t field : fields)
+    writeUint32(payloadStream, field);
+  if (block)
+    payloadStream.write(reinterpret_cast<const char*>(block->buf()), block->size());
+  ConstBufferPtr payload = payloadStream.buf();
+
+  LegacyStream os;
+  writeUint32(os, payload->size() + 1);
+  os.put(id);
+  os.write(reinterpret_cast<const char*>(payload->buf()), payload->size());
+  return os.buf();
+}
+
+template<typename F>
+static double
+measure(size_t nRounds, const F& run)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < nRounds; i++)
+    run();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return nRounds / elapsed.count();
+}
+
+template<typename Old, typename New>
+static void
+run(const char* name, size_t nRounds, const Old& oldEncode, const New& newEncode)
+{
+  volatile size_t sink = 0;
+  double before = measure(nRounds, [&] { sink += oldEncode()->size(); });
+  double after = measure(nRounds, [&] { sink += newEncode()->size(); });
+  printf("%-10s encode %10.0f -> %10.0f msg/s\n", name, before, after);
+}
+
+// a message encoded on the stack and queued the way Torrent::sendWire does
+template<typename F>
+static void
+runWire(const char* name, size_t nRounds, const F& encode)
+{
+  util::OutboundQueue queue;
+  double rate = measure(nRounds, [&] {
+    uint8_t buf[msg::wire::MAX_LENGTH];
+    queue.pushCopy(buf, encode(buf));
+    if (queue.size() > 60000)
+      queue.clear();
+  });
+  printf("%-10s wire   %10.0f msg/s, queued\n", name, rate);
+}
+
+// what Torrent::parseMessage did with a message: copy it out, try it as a handshake,
+// and decode it through a MsgBase subclass
+static size_t
+legacyDecode(const uint8_t* data, size_t size)
+{
+  ConstBufferPtr msg = std::make_shared<Buffer>(data, size);
+  try {
+    msg::HandShake* handshake = new msg::HandShake();
+    handshake->decode(msg);
+    delete handshake;
+    return 0;
+  }
+  catch (const msg::Error&) {
+  }
+
+  switch (size < 5 ? msg::MSG_ID_KEEP_ALIVE : msg->get()[4]) {
+  case msg::MSG_ID_HAVE:
+    {
+      msg::Have have;
+      have.decode(msg);
+      return have.getIndex();
+    }
+  case msg::MSG_ID_REQUEST:
+    {
+      msg::Request request;
+      request.decode(msg);
+      return request.getLength();
+    }
+  case msg::MSG_ID_PIECE:
+    {
+      msg::Piece piece;
+      piece.decodeView(BufferView(msg));
+      return piece.getBlockView().size();
+    }
+  default:
+    return 1;
+  }
+}
+
+// adds up what it is handed, so that nothing is optimised away
+struct Summer
+{
+  size_t sum;
+
+  void onKeepAlive() { sum++; }
+  void onChoke() { sum++; }
+  void onUnchoke() { sum++; }
+  void onInterested() { sum++; }
+  void onNotInterested() { sum++; }
+  void onHave(uint32_t index) { sum += index; }
+  void onBitfield(const BufferView& bitfield) { sum += bitfield.size(); }
+  void onRequest(uint32_t index, uint32_t begin, uint32_t length) { sum += length; }
+  void onPiece(uint32_t index, uint32_t begin, const BufferView& block) { sum += block.size(); }
+  void onCancel(uint32_t index, uint32_t begin, uint32_t length) { sum += length; }
+  void onPort(uint16_t port) { sum += port; }
+};
+
+// a download as the receive buffer sees it: per block, the Piece and a few Haves,
+// plus a Request and a state change now and then
+static ConstBufferPtr
+makeStream(size_t nBlocks, std::vector<std::pair<size_t, size_t>>& messages)
+{
+  auto stream = std::make_shared<Buffer>();
+  auto add = [&] (ConstBufferPtr msg) {
+    messages.push_back(std::make_pair(stream->size(), msg->size()));
+    stream->insert(stream->end(), msg->begin(), msg->end());
+  };
+
+  auto block = std::make_shared<Buffer>(16384);
+  for (size_t i = 0; i < nBlocks; i++) {
+    add(msg::Piece(i / 16, i % 16 * 16384, block).encode());
+    for (uint32_t j = 0; j < 4; j++)
+      add(msg::Have(i + j).encode());
+    if (i % 4 == 0)
+      add(msg::Request(i, 0, 16384).encode());
+    if (i % 16 == 0)
+      add(msg::Unchoke().encode());
+  }
+  return stream;
+}
+
+static void
+runDecode(size_t nRounds)
+{
+  std::vector<std::pair<size_t, size_t>> messages;
+  ConstBufferPtr stream = makeStream(64, messages);
+  BufferView view(stream);
+  volatile size_t sink = 0;
+
+  double before = measure(nRounds, [&] {
+    for (const auto& msg : messages)
+      sink += legacyDecode(stream->buf() + msg.first, msg.second);
+  }) * messages.size();
+  double after = measure(nRounds, [&] {
+    Summer summer = {0};
+    for (const auto& msg : messages)
+      msg::dispatch(view.sub(msg.first, msg.second), summer);
+    sink += summer.sum;
+  }) * messages.size();
+
+  printf("%-10s decode %10.0f -> %10.0f msg/s\n", "mixed", before, after);
+}
+
+} // namespace benchmark
+} // namespace sbt
+
+int
+main()
+{
+  using namespace sbt;
+  using namespace sbt::benchmark;
+
+  const size_t nRounds = 200000;
+
+  run("have", nRounds,
+      [] { return legacyEncode(msg::MSG_ID_HAVE, {7}, nullptr); },
+      [] { msg::Have have(7); return have.encode(); });
+
+  run("request", nRounds,
+      [] { return legacyEncode(msg::MSG_ID_REQUEST, {7, 16384, 16384}, nullptr); },
+      [] { msg::Request request(7, 16384, 16384); return request.encode(); });
+
+  auto block = std::make_shared<Buffer>(16384);
+  run("piece", nRounds / 10,
+      [&] { return legacyEncode(msg::MSG_ID_PIECE, {7, 16384}, block); },
+      [&] { msg::Piece piece(7, 16384, block); return piece.encode(); });
+
+  auto infoHash = std::make_shared<Buffer>(20);
+  std::string peerId(20, 'x');
+  run("handshake", nRounds,
+      [&] {
+        LegacyStream os;
+        os.put(19);
+        os.write("BitTorrent protocol", 19);
+        os.write(std::string(8, '\0').data(), 8);
+        os.write(reinterpret_cast<const char*>(infoHash->buf()), 20);
+        os.write(peerId.data(), 20);
+        return os.buf();
+      },
+      [&] { msg::HandShake handshake(infoHash, peerId); return handshake.encode(); });
+
+  runDecode(nRounds / 100);
+
+  runWire("choke", nRounds * 10, [] (uint8_t* buf) {
+    memcpy(buf, msg::wire::CHOKE, sizeof(msg::wire::CHOKE));
+    return sizeof(msg::wire::CHOKE);
+  });
+  runWire("have", nRounds * 10, [] (uint8_t* buf) { return msg::wire::encodeHave(buf, 7); });
+  runWire("request", nRounds * 10, [] (uint8_t* buf) {
+    return msg::wire::encodeRequest(buf, 7, 16384, 16384);
+  });
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "http/url-encoding.hpp"
+#include "util/buffer-stream.hpp"
+
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <sstream>
+
+namespace sbt {
+namespace benchmark {
+
+static uint8_t
+hexValue(char c)
+{
+  return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+// the stream-based codec url::encode/decode used to be
+static std::string
+streamEncode(const uint8_t* buf, size_t size)
+{
+  static const char HEX[] = "0123456789ABCDEF";
+  std::stringstream ss;
+
+  for (size_t i = 0; i < size; i++) {
+    if (isalnum(buf[i]) || buf[i] == '-' || buf[i] == '.' || buf[i] == '_' || buf[i] == '~')
+      ss << buf[i];
+    else
+      ss << '%' << HEX[buf[i] >> 4] << HEX[buf[i] & 0x0F];
+  }
+
+  return ss.str();
+}
+
+static ConstBufferPtr
+streamDecode(const std::string& input)
+{
+  OBufferStream os;
+
+  auto it = input.begin();
+  while (it != input.end()) {
+    if (*it == '%' && input.end() - it >= 3) {
+      os.put(static_cast<char>((hexValue(it[1]) << 4) | hexValue(it[2])));
+      it += 3;
+    }
+    else {
+      os.put(*it++);
+    }
+  }
+
+  return os.buf();
+}
+
+template<typename F>
+static double
+measure(size_t nRounds, size_t nBytes, const F& run)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < nRounds; i++)
+    run();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return nRounds * nBytes / elapsed.count() / (1 << 20);
+}
+
+static void
+run(const char* name, const std::vector<uint8_t>& input, size_t nRounds)
+{
+  std::string encoded = url::encode(input.data(), input.size());
+  std::vector<char> encodeBuf(3 * input.size());
+  std::vector<uint8_t> decodeBuf(encoded.size());
+  volatile size_t sink = 0;
+
+  double oldEncode = measure(nRounds, input.size(), [&] {
+    sink += streamEncode(input.data(), input.size()).size();
+  });
+  double newEncode = measure(nRounds, input.size(), [&] {
+    sink += url::encodeTo(input.data(), input.size(), encodeBuf.data()) - encodeBuf.data();
+  });
+  double oldDecode = measure(nRounds, encoded.size(), [&] {
+    sink += streamDecode(encoded)->size();
+  });
+  double newDecode = measure(nRounds, encoded.size(), [&] {
+    sink += url::decodeTo(encoded.data(), encoded.size(), decodeBuf.data()) - decodeBuf.data();
+  });
+
+  printf("%-10s encode %8.1f -> %8.1f MB/s   decode %8.1f -> %8.1f MB/s\n",
+         name, oldEncode, newEncode, oldDecode, newDecode);
+}
+
+} // namespace benchmark
+} // namespace sbt
+
+int
+main()
+{
+  using namespace sbt::benchmark;
+
+  const size_t nRounds = 20000;
+  std::mt19937 random(1);
+
+  // mostly unreserved characters, as in announce paths and peer IDs
+  std::string text;
+  while (text.size() < 4096)
+    text += "announce.php-tracker_example~org/";
+  run("text", std::vector<uint8_t>(text.begin(), text.end()), nRounds);
+
+  // uniformly random bytes, as in info hashes
+  std::vector<uint8_t> binary(4096);
+  for (auto& byte : binary)
+    byte = random();
+  run("binary", binary, nRounds);
+
+  // a single info hash, the size the client actually encodes
+  run("info-hash", std::vector<uint8_t>(binary.begin(), binary.begin() + 20), nRounds * 100);
+
+  return 0;
+}
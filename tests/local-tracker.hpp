@@ -0,0 +1,246 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#ifndef SBT_TESTS_LOCAL_TRACKER_HPP
+#define SBT_TESTS_LOCAL_TRACKER_HPP
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace sbt {
+namespace test {
+
+/**
+ * @brief Stand-in HTTP tracker on a loopback port
+ *
+ * Answers @p nResponses requests per accepted connection, up to @p nConnections
+ * connections, with a Content-Length body, then closes the connection.  By default
+ * the j-th body on a connection is "d8:intervali<j>e5:peers0:e".
+ */
+class LocalTracker
+{
+public:
+  typedef std::function<std::string(int j)> BodyMaker;
+
+  LocalTracker(int nConnections, int nResponses, const BodyMaker& makeBody = nullptr)
+  {
+    m_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = 0;
+    bind(m_sockfd, (struct sockaddr*)&addr, sizeof(addr));
+    listen(m_sockfd, 4);
+
+    socklen_t len = sizeof(addr);
+    getsockname(m_sockfd, (struct sockaddr*)&addr, &len);
+    m_port = std::to_string(ntohs(addr.sin_port));
+
+    m_thread = std::thread([this, nConnections, nResponses, makeBody] {
+      for (int i = 0; i < nConnections; i++) {
+        int fd = accept(m_sockfd, nullptr, nullptr);
+        for (int j = 0; j < nResponses; j++) {
+          std::string request;
+          char buf[1024];
+          while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0)
+              break;
+            request.append(buf, n);
+          }
+
+          std::string body = makeBody ? makeBody(j) :
+            "d8:intervali" + std::to_string(j) + "e5:peers0:e";
+          std::string response = "HTTP/1.1 200 OK\r\nContent-Length: " +
+            std::to_string(body.size()) + "\r\n\r\n" + body;
+          send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+        }
+        close(fd);
+      }
+    });
+  }
+
+  ~LocalTracker()
+  {
+    m_thread.join();
+    close(m_sockfd);
+  }
+
+  const std::string&
+  getPort() const
+  {
+    return m_port;
+  }
+
+  std::string
+  getUrl() const
+  {
+    return "http://127.0.0.1:" + m_port + "/announce";
+  }
+
+private:
+  int m_sockfd;
+  std::string m_port;
+  std::thread m_thread;
+};
+
+/**
+ * @brief Stand-in UDP tracker (BEP 15) on a loopback port
+ *
+ * Hands out one connection ID and answers every announce with 10.0.0.1:6881 and
+ * 10.0.0.2:6881, except for info hashes starting with 0xff, which get an error.
+ * Scrapes of the i-th hash report i + 1 seeders, for no more than @p nScraped
+ * hashes.  The first @p nDrops datagrams are ignored, to make the client retransmit.
+ */
+class LocalUdpTracker
+{
+public:
+  static const uint64_t CONNECTION_ID = 0x1122334455667788ULL;
+
+  explicit
+  LocalUdpTracker(int nDrops = 0, uint32_t nScraped = 0xFFFFFFFF)
+    : m_nScraped(nScraped)
+    , m_nConnects(0)
+    , m_isStopping(false)
+  {
+    m_sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = 0;
+    bind(m_sockfd, (struct sockaddr*)&addr, sizeof(addr));
+
+    socklen_t len = sizeof(addr);
+    getsockname(m_sockfd, (struct sockaddr*)&addr, &len);
+    m_port = std::to_string(ntohs(addr.sin_port));
+
+    m_thread = std::thread([this, nDrops] {
+      int nDropped = 0;
+      while (!m_isStopping) {
+        struct pollfd pfd = {m_sockfd, POLLIN, 0};
+        if (poll(&pfd, 1, 20) <= 0)
+          continue;
+
+        uint8_t in[2048];
+        struct sockaddr_in from;
+        socklen_t fromLength = sizeof(from);
+        ssize_t n = recvfrom(m_sockfd, in, sizeof(in), 0, (struct sockaddr*)&from, &fromLength);
+        if (n < 16 || nDropped++ < nDrops)
+          continue;
+
+        std::string out = answer(in, n);
+        sendto(m_sockfd, out.data(), out.size(), 0, (struct sockaddr*)&from, fromLength);
+      }
+    });
+  }
+
+  ~LocalUdpTracker()
+  {
+    m_isStopping = true;
+    m_thread.join();
+    close(m_sockfd);
+  }
+
+  const std::string&
+  getPort() const
+  {
+    return m_port;
+  }
+
+  std::string
+  getUrl() const
+  {
+    return "udp://127.0.0.1:" + m_port;
+  }
+
+  int
+  getConnectCount() const
+  {
+    return m_nConnects;
+  }
+
+private:
+  static void
+  append32(std::string& out, uint32_t value)
+  {
+    value = htonl(value);
+    out.append(reinterpret_cast<const char*>(&value), 4);
+  }
+
+  static uint32_t
+  read32(const uint8_t* p)
+  {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return ntohl(value);
+  }
+
+  std::string
+  answer(const uint8_t* in, size_t size)
+  {
+    uint32_t action = read32(in + 8);
+    std::string out;
+    append32(out, action);
+    out.append(reinterpret_cast<const char*>(in + 12), 4); // transaction ID
+
+    if (action == 0) {
+      m_nConnects++;
+      append32(out, static_cast<uint32_t>(CONNECTION_ID >> 32));
+      append32(out, static_cast<uint32_t>(CONNECTION_ID));
+      return out;
+    }
+
+    if (read32(in) != (CONNECTION_ID >> 32) || read32(in + 4) != static_cast<uint32_t>(CONNECTION_ID) ||
+        (action == 1 && in[16] == 0xff)) {
+      out[3] = 3;
+      out += "unknown torrent";
+      return out;
+    }
+
+    if (action == 1) {
+      append32(out, 1800);
+      append32(out, 1);
+      append32(out, 2);
+      const char peers[] = {10, 0, 0, 1, 0x1a, static_cast<char>(0xe1),
+                            10, 0, 0, 2, 0x1a, static_cast<char>(0xe1)};
+      out.append(peers, sizeof(peers));
+    }
+    else {
+      for (uint32_t i = 0; 16 + 20 * (i + 1) <= size && i < m_nScraped; i++) {
+        append32(out, i + 1);
+        append32(out, 10 * (i + 1));
+        append32(out, 0);
+      }
+    }
+    return out;
+  }
+
+private:
+  int m_sockfd;
+  std::string m_port;
+  uint32_t m_nScraped;
+  std::atomic<int> m_nConnects;
+  std::atomic<bool> m_isStopping;
+  std::thread m_thread;
+};
+
+} // namespace test
+} // namespace sbt
+
+#endif // SBT_TESTS_LOCAL_TRACKER_HPP
@@ -0,0 +1,162 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "acceptor.hpp"
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestAcceptor)
+
+static int
+connectTo(uint16_t port)
+{
+  int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  BOOST_REQUIRE_EQUAL(connect(sockfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+  return sockfd;
+}
+
+static ConstBufferPtr
+makeHandshake(uint8_t hashByte)
+{
+  auto infoHash = make_shared<Buffer>(20);
+  (*infoHash)[0] = hashByte;
+  return msg::HandShake(infoHash, "SIMPLEBT.TEST.PEERID").encode();
+}
+
+/**
+ * Whether the acceptor closed @p sockfd, as opposed to keeping it open.
+ */
+static bool
+isClosed(int sockfd)
+{
+  uint8_t byte;
+  return recv(sockfd, &byte, 1, MSG_DONTWAIT) == 0;
+}
+
+BOOST_AUTO_TEST_CASE(Routing)
+{
+  util::EventLoop loop;
+  std::vector<int> accepted;
+  std::string peerId;
+  Acceptor acceptor(loop,
+                    [] (const uint8_t* infoHash) { return infoHash[0] == 1; },
+                    [&] (int sockfd, const sockaddr_in&, msg::HandShake& handshake) {
+                      accepted.push_back(sockfd);
+                      peerId = handshake.getPeerId();
+                      BOOST_CHECK_EQUAL((*handshake.getInfoHash())[0], 1);
+                    }, 100);
+  BOOST_REQUIRE_EQUAL(acceptor.listen("127.0.0.1", "0"), 0);
+  uint16_t port = acceptor.getPort();
+  BOOST_REQUIRE_NE(port, 0);
+
+  // served, sent in two pieces
+  int served = connectTo(port);
+  ConstBufferPtr handshake = makeHandshake(1);
+  send(served, handshake->buf(), 30, 0);
+  loop.runOnce(20);
+  loop.runOnce(20);
+  BOOST_CHECK_EQUAL(acceptor.getPendingCount(), 1);
+  send(served, handshake->buf() + 30, handshake->size() - 30, 0);
+
+  // not served: rejected before its peer id arrives
+  int unknown = connectTo(port);
+  send(unknown, makeHandshake(2)->buf(), 48, 0);
+
+  // not BitTorrent at all
+  int garbage = connectTo(port);
+  send(garbage, "GET / HTTP/1.1\r\n\r\n\r\n", 20, 0);
+
+  // silent until the timeout
+  int silent = connectTo(port);
+
+  loop.schedule(300, [&] { loop.stop(); });
+  loop.run();
+
+  BOOST_REQUIRE_EQUAL(accepted.size(), 1);
+  BOOST_CHECK_EQUAL(peerId, "SIMPLEBT.TEST.PEERID");
+  BOOST_CHECK(!isClosed(served));
+  BOOST_CHECK(isClosed(unknown));
+  BOOST_CHECK(isClosed(garbage));
+  BOOST_CHECK(isClosed(silent));
+  BOOST_CHECK_EQUAL(acceptor.getRejectedCount(), 3);
+  BOOST_CHECK_EQUAL(acceptor.getPendingCount(), 0);
+
+  close(accepted[0]);
+  close(served);
+  close(unknown);
+  close(garbage);
+  close(silent);
+}
+
+BOOST_AUTO_TEST_CASE(OutOfDescriptors)
+{
+  util::EventLoop loop;
+  Acceptor acceptor(loop, [] (const uint8_t*) { return true; },
+                    [] (int, const sockaddr_in&, msg::HandShake&) {}, 5000);
+  BOOST_REQUIRE_EQUAL(acceptor.listen("127.0.0.1", "0"), 0);
+  int peer = connectTo(acceptor.getPort());
+
+  // the next descriptor would be over the limit
+  int next = dup(0);
+  close(next);
+  rlimit original;
+  getrlimit(RLIMIT_NOFILE, &original);
+  rlimit lowered = original;
+  lowered.rlim_cur = next;
+  setrlimit(RLIMIT_NOFILE, &lowered);
+
+  loop.runOnce(20);
+  loop.runOnce(20);
+  BOOST_CHECK_EQUAL(acceptor.getPendingCount(), 0);
+  setrlimit(RLIMIT_NOFILE, &original);
+
+  // accepting resumes after the back-off
+  loop.runOnce(20);
+  BOOST_CHECK_EQUAL(acceptor.getPendingCount(), 0);
+  loop.schedule(Acceptor::ACCEPT_BACKOFF + 200, [&] { loop.stop(); });
+  loop.run();
+  BOOST_CHECK_EQUAL(acceptor.getPendingCount(), 1);
+
+  close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(ListenFailure)
+{
+  util::EventLoop loop;
+  Acceptor first(loop, [] (const uint8_t*) { return true; },
+                 [] (int, const sockaddr_in&, msg::HandShake&) {});
+  BOOST_REQUIRE_EQUAL(first.listen("127.0.0.1", "0"), 0);
+
+  // the port is taken, and the socket for it is not left open
+  int next = dup(0);
+  close(next);
+  Acceptor second(loop, [] (const uint8_t*) { return true; },
+                  [] (int, const sockaddr_in&, msg::HandShake&) {});
+  BOOST_CHECK_EQUAL(second.listen("127.0.0.1", std::to_string(first.getPort())),
+                    RC_CLIENT_CONNECTION_FAILED);
+  int after = dup(0);
+  BOOST_CHECK_EQUAL(after, next);
+  close(after);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
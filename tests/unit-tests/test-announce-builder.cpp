@@ -0,0 +1,75 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "announce-builder.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestAnnounceBuilder)
+
+BOOST_AUTO_TEST_CASE(Build)
+{
+  AnnounceRequest request;
+  auto infoHash = make_shared<Buffer>(20);
+  (*infoHash)[0] = 0xab;
+  (*infoHash)[1] = 'z';
+  request.infoHash = infoHash;
+  request.peerId = "-CC0001-12345678901 ";
+  request.port = 6881;
+  request.uploaded = 0;
+  request.downloaded = 1234567890123ULL;
+  request.left = 42;
+  request.event = AnnounceRequest::EVENT_STARTED;
+
+  AnnounceBuilder builder("tracker.com", "6969", "a/announce");
+  const std::string zeros = "%00%00%00%00%00%00%00%00%00%00%00%00%00%00%00%00%00%00";
+  const std::string head = "GET /a/announce?info_hash=%ABz" + zeros +
+                           "&peer_id=-CC0001-12345678901%20&port=6881";
+  const std::string headers = " HTTP/1.1\r\n"
+                              "Host: tracker.com:6969\r\n"
+                              "Connection: keep-alive\r\n"
+                              "Accept-Language: en-US\r\n"
+                              "\r\n";
+
+  BOOST_CHECK_EQUAL(builder.build(request),
+                    head + "&uploaded=0&downloaded=1234567890123&left=42&compact=1&event=started" +
+                    headers);
+
+  // later announces reuse the buffer of the first one, and its static part even when
+  // the info hash comes in a buffer of its own
+  const char* buffer = builder.build(request).data();
+  request.infoHash = make_shared<Buffer>(*infoHash);
+
+  request.uploaded = 18446744073709551615ULL;
+  request.event = AnnounceRequest::EVENT_NONE;
+  BOOST_CHECK_EQUAL(builder.build(request),
+                    head + "&uploaded=18446744073709551615&downloaded=1234567890123&left=42&compact=1" +
+                    headers);
+  BOOST_CHECK(builder.build(request).data() == buffer);
+
+  request.event = AnnounceRequest::EVENT_COMPLETED;
+  request.left = 0;
+  BOOST_CHECK_EQUAL(builder.build(request),
+                    head + "&uploaded=18446744073709551615&downloaded=1234567890123&left=0&compact=1"
+                    "&event=completed" + headers);
+  BOOST_CHECK(builder.build(request).data() == buffer);
+  BOOST_CHECK_EQUAL(builder.getEncodeCount(), 1);
+
+  // a different port re-encodes the static part
+  request.port = 1;
+  const std::string prefix = head.substr(0, head.size() - 4);
+  BOOST_CHECK_EQUAL(builder.build(request).substr(0, prefix.size() + 11), prefix + "1&uploaded=");
+  BOOST_CHECK_EQUAL(builder.getEncodeCount(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
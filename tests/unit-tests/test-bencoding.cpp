@@ -289,6 +289,39 @@ BOOST_AUTO_TEST_CASE(TestDictionary)
   BOOST_CHECK_THROW(Dictionary().wireDecode(ss), bencoding::Error);
 }
 
+BOOST_AUTO_TEST_CASE(TestReader)
+{
+  const std::string input = "d4:key0i-42e4:key13:abc4:key2li0ed1:ali1eeee4:key3i7ee";
+  Reader reader(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+
+  BOOST_CHECK_EQUAL(reader.peek(), TYPE_DICTIONARY);
+  reader.enterDictionary();
+
+  size_t size;
+  const uint8_t* key = reader.readString(size);
+  BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(key), size), "key0");
+  BOOST_CHECK_EQUAL(reader.readInteger(), -42);
+
+  reader.readString(size);
+  const uint8_t* value = reader.readString(size);
+  BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(value), size), "abc");
+  BOOST_CHECK(value == reinterpret_cast<const uint8_t*>(input.data()) + 20);
+
+  reader.readString(size);
+  BOOST_CHECK_EQUAL(reader.peek(), TYPE_LIST);
+  reader.skip();
+
+  reader.readString(size);
+  BOOST_CHECK_EQUAL(reader.readInteger(), 7);
+  BOOST_CHECK_EQUAL(reader.isEnd(), true);
+  reader.leave();
+
+  const char* bad[] = {"i01e", "i-0e", "ie", "i12", "02:ab", "5:abc", "x", "l", "li1e"};
+  for (const char* input : bad) {
+    Reader badReader(reinterpret_cast<const uint8_t*>(input), strlen(input));
+    BOOST_CHECK_THROW(badReader.skip(), bencoding::Error);
+  }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
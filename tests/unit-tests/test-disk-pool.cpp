@@ -0,0 +1,53 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/disk-pool.hpp"
+
+#include <atomic>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestDiskPool)
+
+BOOST_AUTO_TEST_CASE(DoneOnLoop)
+{
+  EventLoop loop;
+  DiskPool pool(loop, 4);
+  BOOST_CHECK_EQUAL(pool.getThreadCount(), 4);
+
+  std::thread::id loopThread = std::this_thread::get_id();
+  std::atomic<int> nJobs(0);
+  int nDone = 0;
+
+  for (int i = 0; i < 16; i++) {
+    auto result = std::make_shared<int>(0);
+    pool.submit([=, &nJobs] {
+      BOOST_CHECK(std::this_thread::get_id() != loopThread);
+      *result = i * i;
+      nJobs++;
+    }, [=, &nDone, &loop] {
+      BOOST_CHECK(std::this_thread::get_id() == loopThread);
+      BOOST_CHECK_EQUAL(*result, i * i);
+      if (++nDone == 16)
+        loop.stop();
+    });
+  }
+
+  loop.run();
+  BOOST_CHECK_EQUAL(nJobs, 16);
+  BOOST_CHECK_EQUAL(nDone, 16);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/event-loop.hpp"
+
+#include <fcntl.h>
+#include <thread>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestEventLoop)
+
+static std::vector<EventLoop::Backend>
+getBackends()
+{
+  std::vector<EventLoop::Backend> backends(1, EventLoop::BACKEND_EPOLL);
+  if (IoUring::isSupported())
+    backends.push_back(EventLoop::BACKEND_IO_URING);
+  return backends;
+}
+
+BOOST_AUTO_TEST_CASE(Readable)
+{
+  for (EventLoop::Backend backend : getBackends()) {
+    EventLoop loop(backend);
+    BOOST_CHECK_EQUAL(loop.getBackend(), backend);
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+
+    int calls = 0;
+    loop.add(fds[0], EPOLLIN, [&] (uint32_t events) {
+      char c;
+      BOOST_CHECK(events & EPOLLIN);
+      BOOST_CHECK_EQUAL(read(fds[0], &c, 1), 1);
+      calls++;
+    });
+
+    loop.runOnce(0);
+    BOOST_CHECK_EQUAL(calls, 0);
+
+    BOOST_REQUIRE_EQUAL(write(fds[1], "x", 1), 1);
+    loop.runOnce(1000);
+    BOOST_CHECK_EQUAL(calls, 1);
+
+    loop.remove(fds[0]);
+    BOOST_REQUIRE_EQUAL(write(fds[1], "x", 1), 1);
+    loop.runOnce(0);
+    loop.runOnce(0);
+    BOOST_CHECK_EQUAL(calls, 1);
+
+    close(fds[0]);
+    close(fds[1]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LevelTriggered)
+{
+  for (EventLoop::Backend backend : getBackends()) {
+    EventLoop loop(backend);
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+
+    // only one byte is read per event, the rest has to be reported again
+    std::string received;
+    loop.add(fds[0], EPOLLIN, [&] (uint32_t) {
+      char c;
+      BOOST_REQUIRE_EQUAL(read(fds[0], &c, 1), 1);
+      received += c;
+    });
+
+    BOOST_REQUIRE_EQUAL(write(fds[1], "abc", 3), 3);
+    for (int i = 0; i < 10 && received.size() < 3; i++)
+      loop.runOnce(100);
+    BOOST_CHECK_EQUAL(received, "abc");
+
+    close(fds[0]);
+    close(fds[1]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ReadWriteAt)
+{
+  for (EventLoop::Backend backend : getBackends()) {
+    EventLoop loop(backend);
+    char path[] = "/tmp/sbt-event-loop-XXXXXX";
+    int fd = mkstemp(path);
+    BOOST_REQUIRE_GE(fd, 0);
+    unlink(path);
+
+    ssize_t written = 0;
+    loop.writeAt(fd, "hello", 5, 4096, [&] (ssize_t result) { written = result; });
+    // never completed synchronously
+    BOOST_CHECK_EQUAL(written, 0);
+    loop.runOnce(1000);
+    BOOST_CHECK_EQUAL(written, 5);
+
+    char buf[8] = {0};
+    ssize_t read = 0;
+    loop.readAt(fd, buf, sizeof(buf), 4096, [&] (ssize_t result) { read = result; });
+    loop.runOnce(1000);
+    BOOST_CHECK_EQUAL(read, 5);
+    BOOST_CHECK_EQUAL(std::string(buf), "hello");
+
+    loop.readAt(-1, buf, sizeof(buf), 0, [&] (ssize_t result) { read = result; });
+    loop.runOnce(1000);
+    BOOST_CHECK_EQUAL(read, -EBADF);
+
+    close(fd);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Timers)
+{
+  EventLoop loop;
+  int fired = 0;
+
+  loop.schedule(20, [&] { fired++; });
+  auto cancelled = loop.schedule(20, [&] { fired += 10; });
+  loop.cancel(cancelled);
+  loop.schedule(150, [&] { fired++; loop.stop(); });
+
+  uint64_t start = steadyNow();
+  loop.run();
+
+  BOOST_CHECK_EQUAL(fired, 2);
+  BOOST_CHECK_GE(steadyNow() - start, 150);
+}
+
+BOOST_AUTO_TEST_CASE(Post)
+{
+  EventLoop loop;
+  std::thread::id loopThread = std::this_thread::get_id();
+  int ran = 0;
+
+  std::thread worker([&] {
+    for (int i = 0; i < 3; i++) {
+      loop.post([&, i] {
+        BOOST_CHECK(std::this_thread::get_id() == loopThread);
+        ran++;
+        if (i == 2)
+          loop.stop();
+      });
+    }
+  });
+
+  // without the posted stop() the loop would block forever
+  loop.run();
+  worker.join();
+
+  BOOST_CHECK_EQUAL(ran, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
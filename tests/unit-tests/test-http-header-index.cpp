@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "http/http-header-index.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestHttpHeaderIndex)
+
+BOOST_AUTO_TEST_CASE(Parse)
+{
+  const std::string input =
+    "Content-Length:  42 \r\n"
+    "content-type: text/plain\r\n"
+    "X-Empty:\r\n"
+    "X-Folded: one\r\n"
+    "  two\r\n"
+    "CONTENT-TYPE: text/html\r\n"
+    "\r\n"
+    "body";
+
+  HttpHeaderIndex headers;
+  const char* end = headers.parse(input.data(), input.size());
+  BOOST_CHECK_EQUAL(end - input.data(), input.size() - 4);
+
+  BOOST_CHECK_EQUAL(headers.size(), 4);
+  BOOST_CHECK_EQUAL(headers.find("content-length"), "42");
+  BOOST_CHECK_EQUAL(headers.find("Content-Type"), "text/html");
+  BOOST_CHECK_EQUAL(headers.find("X-Folded"), "one\r\n  two");
+  BOOST_CHECK_EQUAL(headers.has("x-empty"), true);
+  BOOST_CHECK_EQUAL(headers.find("X-Empty").empty(), true);
+  BOOST_CHECK_EQUAL(headers.has("Connection"), false);
+  BOOST_CHECK_EQUAL(headers.getKey(1), "content-type");
+
+  // nothing is copied
+  BOOST_CHECK(headers.find("Content-Length").data() == input.data() + 17);
+
+  headers.clear();
+  BOOST_CHECK_EQUAL(headers.size(), 0);
+  BOOST_CHECK_EQUAL(headers.has("Content-Length"), false);
+}
+
+BOOST_AUTO_TEST_CASE(Malformed)
+{
+  HttpHeaderIndex headers;
+  const std::string noColon = "Content-Length 42\r\n\r\n";
+  BOOST_CHECK_THROW(headers.parse(noColon.data(), noColon.size()), ParseError);
+
+  headers.clear();
+  const std::string unterminated = "Content-Length: 42\r\n";
+  BOOST_CHECK_THROW(headers.parse(unterminated.data(), unterminated.size()), ParseError);
+
+  headers.clear();
+  const std::string folded = " one\r\n\r\n";
+  BOOST_CHECK_THROW(headers.parse(folded.data(), folded.size()), ParseError);
+
+  headers.clear();
+  std::string many;
+  for (size_t i = 0; i <= HttpHeaderIndex::MAX_FIELDS; i++)
+    many += "X-" + std::to_string(i) + ": " + std::to_string(i) + "\r\n";
+  many += "\r\n";
+  BOOST_CHECK_THROW(headers.parse(many.data(), many.size()), ParseError);
+  BOOST_CHECK_EQUAL(headers.find("X-63"), "63");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
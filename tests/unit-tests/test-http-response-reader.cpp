@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "http/http-response-reader.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestHttpResponseReader)
+
+static std::string
+getBody(const HttpResponseReader& reader)
+{
+  return std::string(reader.getBody().begin(), reader.getBody().end());
+}
+
+BOOST_AUTO_TEST_CASE(ContentLength)
+{
+  const std::string input = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+
+  // one byte at a time, so every boundary is split
+  HttpResponseReader reader;
+  for (size_t i = 0; i < input.size(); i++) {
+    BOOST_CHECK_EQUAL(reader.isComplete(), false);
+    BOOST_CHECK_EQUAL(reader.feed(&input[i], 1), 1);
+  }
+
+  BOOST_CHECK_EQUAL(reader.isComplete(), true);
+  BOOST_CHECK_EQUAL(reader.isKeepAlive(), true);
+  BOOST_CHECK_EQUAL(reader.getStatusCode(), "200");
+  BOOST_CHECK_EQUAL(getBody(reader), "hello");
+}
+
+BOOST_AUTO_TEST_CASE(BinaryBody)
+{
+  const char input[] = "HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\n\x01\x00\r\n\x00\xff";
+
+  HttpResponseReader reader;
+  reader.feed(input, sizeof(input) - 1);
+
+  BOOST_REQUIRE_EQUAL(reader.isComplete(), true);
+  BOOST_CHECK_EQUAL(getBody(reader), std::string(input + sizeof(input) - 7, 6));
+}
+
+BOOST_AUTO_TEST_CASE(Chunked)
+{
+  const std::string input =
+    "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+    "4\r\nd8:i\r\n"
+    "A;ext=1\r\nntervali5e\r\n"
+    "1\r\ne\r\n"
+    "0\r\nX-Trailer: yes\r\n\r\n";
+
+  HttpResponseReader reader;
+  for (size_t i = 0; i < input.size(); i += 3)
+    reader.feed(&input[i], std::min<size_t>(3, input.size() - i));
+
+  BOOST_CHECK_EQUAL(reader.isComplete(), true);
+  BOOST_CHECK_EQUAL(reader.isKeepAlive(), true);
+  BOOST_CHECK_EQUAL(getBody(reader), "d8:intervali5ee");
+}
+
+BOOST_AUTO_TEST_CASE(UntilClose)
+{
+  const std::string input = "HTTP/1.0 200 OK\r\n\r\nd5:peers0:e";
+
+  HttpResponseReader reader;
+  BOOST_CHECK_EQUAL(reader.feed(input.data(), input.size()), input.size());
+  BOOST_CHECK_EQUAL(reader.isComplete(), false);
+
+  reader.finish();
+  BOOST_CHECK_EQUAL(reader.isComplete(), true);
+  BOOST_CHECK_EQUAL(reader.isKeepAlive(), false);
+  BOOST_CHECK_EQUAL(getBody(reader), "d5:peers0:e");
+}
+
+BOOST_AUTO_TEST_CASE(Pipelined)
+{
+  const std::string first = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nab";
+  const std::string second = "HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n";
+  const std::string input = first + second;
+
+  HttpResponseReader reader;
+  size_t n = reader.feed(input.data(), input.size());
+  BOOST_CHECK_EQUAL(n, first.size());
+  BOOST_CHECK_EQUAL(getBody(reader), "ab");
+
+  reader.reset();
+  BOOST_CHECK_EQUAL(reader.feed(input.data() + n, input.size() - n), second.size());
+  BOOST_CHECK_EQUAL(reader.isComplete(), true);
+  BOOST_CHECK_EQUAL(reader.isKeepAlive(), false);
+  BOOST_CHECK_EQUAL(reader.getBody().size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Malformed)
+{
+  const std::string badChunk = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n";
+  HttpResponseReader reader;
+  BOOST_CHECK_THROW(reader.feed(badChunk.data(), badChunk.size()), ParseError);
+
+  const std::string badLength = "HTTP/1.1 200 OK\r\nContent-Length: many\r\n\r\n";
+  reader.reset();
+  BOOST_CHECK_THROW(reader.feed(badLength.data(), badLength.size()), ParseError);
+
+  const std::string truncated = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc";
+  reader.reset();
+  reader.feed(truncated.data(), truncated.size());
+  BOOST_CHECK_THROW(reader.finish(), ParseError);
+}
+
+BOOST_AUTO_TEST_CASE(TooLong)
+{
+  // refused from the announced size alone, nothing is allocated for it
+  const std::string hugeLength = "HTTP/1.1 200 OK\r\nContent-Length: 999999999999999999\r\n\r\n";
+  HttpResponseReader reader;
+  BOOST_CHECK_THROW(reader.feed(hugeLength.data(), hugeLength.size()), ParseError);
+
+  const std::string hugeChunk = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                "fffffffffffffff\r\n";
+  reader.reset();
+  BOOST_CHECK_THROW(reader.feed(hugeChunk.data(), hugeChunk.size()), ParseError);
+
+  const std::string untilClose = "HTTP/1.0 200 OK\r\n\r\n";
+  const std::string data(1024 * 1024, 'x');
+  reader.reset();
+  reader.feed(untilClose.data(), untilClose.size());
+  for (int i = 0; i < 4; i++)
+    reader.feed(data.data(), data.size());
+  BOOST_CHECK_THROW(reader.feed("x", 1), ParseError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
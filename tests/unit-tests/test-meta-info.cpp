@@ -196,6 +196,35 @@ BOOST_AUTO_TEST_CASE(EncodeDecode)
 
 }
 
+BOOST_AUTO_TEST_CASE(AnnounceList)
+{
+  MetaInfo info;
+  BOOST_CHECK_EQUAL(info.getAnnounceList().empty(), true);
+
+  // without announce-list, announce forms the only tier
+  info.setAnnounce("http://a.com:80/announce");
+  auto tiers = info.getAnnounceList();
+  BOOST_REQUIRE_EQUAL(tiers.size(), 1);
+  BOOST_REQUIRE_EQUAL(tiers[0].size(), 1);
+  BOOST_CHECK_EQUAL(tiers[0][0], "http://a.com:80/announce");
+
+  std::stringstream ss("d8:announce24:http://a.com:80/announce"
+                       "13:announce-listll1:b1:cel1:dee"
+                       "4:infodee");
+  info.wireDecode(ss);
+
+  tiers = info.getAnnounceList();
+  BOOST_REQUIRE_EQUAL(tiers.size(), 2);
+  BOOST_REQUIRE_EQUAL(tiers[0].size(), 2);
+  BOOST_CHECK_EQUAL(tiers[0][0], "b");
+  BOOST_CHECK_EQUAL(tiers[0][1], "c");
+  BOOST_REQUIRE_EQUAL(tiers[1].size(), 1);
+  BOOST_CHECK_EQUAL(tiers[1][0], "d");
+
+  info.setAnnounceList({{"e"}});
+  BOOST_CHECK_EQUAL(info.getAnnounceList()[0][0], "e");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace test
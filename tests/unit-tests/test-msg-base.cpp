@@ -344,6 +344,33 @@ BOOST_AUTO_TEST_CASE(TestPiece)
                                   block_raw + sizeof(block_raw));
 }
 
+BOOST_AUTO_TEST_CASE(TestPieceView)
+{
+  uint8_t encoded_piece[] = {
+    0x00, 0x00, 0x00, 0x0d,
+    0x07,
+    0x00, 0x00, 0x01, 0x00,
+    0x00, 0x00, 0x01, 0x01,
+    0x00, 0x00, 0x01, 0x02
+  };
+
+  auto encoded = make_shared<Buffer>(encoded_piece, sizeof(encoded_piece));
+
+  Piece piece;
+  BOOST_REQUIRE_NO_THROW(piece.decodeView(BufferView(encoded)));
+  BOOST_CHECK_EQUAL(piece.getIndex(), 256);
+  BOOST_CHECK_EQUAL(piece.getBegin(), 257);
+  BOOST_CHECK_EQUAL(static_cast<bool>(piece.getBlock()), false);
+
+  // the block is the tail of the encoded message itself
+  BOOST_CHECK(piece.getBlockView().data() == encoded->get() + 13);
+  BOOST_CHECK_EQUAL(piece.getBlockView().size(), 4);
+  BOOST_CHECK(piece.getBlockView().getOwner() == encoded);
+
+  BOOST_CHECK_THROW(piece.decodeView(BufferView(encoded).sub(0, 12)), Error);
+  BOOST_CHECK_THROW(piece.decodeView(BufferView(encoded).sub(0, 16)), Error);
+}
+
 BOOST_AUTO_TEST_CASE(TestCancel)
 {
   uint8_t encoded_cancel[] = {
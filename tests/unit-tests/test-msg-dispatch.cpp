@@ -0,0 +1,134 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "msg/dispatch.hpp"
+
+#include <sstream>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace msg {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestMsgDispatch)
+
+// writes down every call as a line
+struct Recorder
+{
+  std::ostringstream calls;
+  BufferView view;
+
+  void onKeepAlive() { calls << "keep-alive\n"; }
+  void onChoke() { calls << "choke\n"; }
+  void onUnchoke() { calls << "unchoke\n"; }
+  void onInterested() { calls << "interested\n"; }
+  void onNotInterested() { calls << "not-interested\n"; }
+  void onHave(uint32_t index) { calls << "have " << index << "\n"; }
+
+  void
+  onBitfield(const BufferView& bitfield)
+  {
+    calls << "bitfield " << bitfield.size() << "\n";
+    view = bitfield;
+  }
+
+  void
+  onRequest(uint32_t index, uint32_t begin, uint32_t length)
+  {
+    calls << "request " << index << " " << begin << " " << length << "\n";
+  }
+
+  void
+  onPiece(uint32_t index, uint32_t begin, const BufferView& block)
+  {
+    calls << "piece " << index << " " << begin << " " << block.size() << "\n";
+    view = block;
+  }
+
+  void
+  onCancel(uint32_t index, uint32_t begin, uint32_t length)
+  {
+    calls << "cancel " << index << " " << begin << " " << length << "\n";
+  }
+
+  void onPort(uint16_t port) { calls << "port " << port << "\n"; }
+};
+
+static bool
+dispatchEncoded(MsgBase&& msg, Recorder& recorder)
+{
+  return dispatch(BufferView(msg.encode()), recorder);
+}
+
+BOOST_AUTO_TEST_CASE(Messages)
+{
+  Recorder recorder;
+  BOOST_CHECK(dispatchEncoded(KeepAlive(), recorder));
+  BOOST_CHECK(dispatchEncoded(Choke(), recorder));
+  BOOST_CHECK(dispatchEncoded(Unchoke(), recorder));
+  BOOST_CHECK(dispatchEncoded(Interested(), recorder));
+  BOOST_CHECK(dispatchEncoded(NotInterested(), recorder));
+  BOOST_CHECK(dispatchEncoded(Have(42), recorder));
+  BOOST_CHECK(dispatchEncoded(Request(1, 16384, 16384), recorder));
+  BOOST_CHECK(dispatchEncoded(Cancel(2, 0, 100), recorder));
+
+  uint8_t port[] = {0, 0, 0, 3, MSG_ID_PORT, 0x1a, 0xe1};
+  BOOST_CHECK(dispatch(BufferView(make_shared<Buffer>(port, sizeof(port))), recorder));
+
+  // unknown ids are skipped
+  uint8_t extended[] = {0, 0, 0, 2, 20, 0};
+  BOOST_CHECK(dispatch(BufferView(make_shared<Buffer>(extended, sizeof(extended))), recorder));
+
+  BOOST_CHECK_EQUAL(recorder.calls.str(),
+                    "keep-alive\nchoke\nunchoke\ninterested\nnot-interested\nhave 42\n"
+                    "request 1 16384 16384\ncancel 2 0 100\nport 6881\n");
+}
+
+BOOST_AUTO_TEST_CASE(Views)
+{
+  Recorder recorder;
+
+  uint8_t block[] = {1, 2, 3, 4, 5};
+  ConstBufferPtr piece = Piece(3, 32768, make_shared<Buffer>(block, sizeof(block))).encode();
+  BOOST_CHECK(dispatch(BufferView(piece), recorder));
+  BOOST_CHECK_EQUAL(recorder.calls.str(), "piece 3 32768 5\n");
+  BOOST_CHECK(recorder.view.data() == piece->buf() + 13);
+  BOOST_CHECK(recorder.view.getOwner() == piece);
+
+  uint8_t bits[] = {0xff, 0x80};
+  ConstBufferPtr bitfield = Bitfield(make_shared<Buffer>(bits, sizeof(bits))).encode();
+  BOOST_CHECK(dispatch(BufferView(bitfield), recorder));
+  BOOST_CHECK(recorder.view.data() == bitfield->buf() + 5);
+  BOOST_CHECK_EQUAL(recorder.view.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(Malformed)
+{
+  Recorder recorder;
+
+  // a Have one byte short, a Request with a length prefix that does not match, a
+  // Choke with a payload and a Piece without even its header
+  uint8_t have[] = {0, 0, 0, 4, MSG_ID_HAVE, 0, 0, 1};
+  uint8_t request[] = {0, 0, 0, 13, MSG_ID_REQUEST, 0, 0, 0, 1};
+  uint8_t choke[] = {0, 0, 0, 2, MSG_ID_CHOKE, 0};
+  uint8_t piece[] = {0, 0, 0, 5, MSG_ID_PIECE, 0, 0, 0, 1};
+  uint8_t truncated[] = {0, 0};
+
+  BOOST_CHECK(!dispatch(BufferView(make_shared<Buffer>(have, sizeof(have))), recorder));
+  BOOST_CHECK(!dispatch(BufferView(make_shared<Buffer>(request, sizeof(request))), recorder));
+  BOOST_CHECK(!dispatch(BufferView(make_shared<Buffer>(choke, sizeof(choke))), recorder));
+  BOOST_CHECK(!dispatch(BufferView(make_shared<Buffer>(piece, sizeof(piece))), recorder));
+  BOOST_CHECK(!dispatch(BufferView(make_shared<Buffer>(truncated, sizeof(truncated))), recorder));
+  BOOST_CHECK_EQUAL(recorder.calls.str(), "");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace msg
+} // namespace sbt
@@ -0,0 +1,64 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "msg/wire.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace msg {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestMsgWire)
+
+static void
+checkSame(const uint8_t* wire, size_t length, MsgBase& msg)
+{
+  ConstBufferPtr encoded = msg.encode();
+  BOOST_CHECK_EQUAL_COLLECTIONS(wire, wire + length, encoded->begin(), encoded->end());
+}
+
+BOOST_AUTO_TEST_CASE(Fixed)
+{
+  KeepAlive keepAlive;
+  checkSame(wire::KEEP_ALIVE, sizeof(wire::KEEP_ALIVE), keepAlive);
+  Choke choke;
+  checkSame(wire::CHOKE, sizeof(wire::CHOKE), choke);
+  Unchoke unchoke;
+  checkSame(wire::UNCHOKE, sizeof(wire::UNCHOKE), unchoke);
+  Interested interested;
+  checkSame(wire::INTERESTED, sizeof(wire::INTERESTED), interested);
+  NotInterested notInterested;
+  checkSame(wire::NOT_INTERESTED, sizeof(wire::NOT_INTERESTED), notInterested);
+}
+
+BOOST_AUTO_TEST_CASE(Encoded)
+{
+  uint8_t buf[wire::MAX_LENGTH];
+
+  Have have(0x01020304);
+  checkSame(buf, wire::encodeHave(buf, 0x01020304), have);
+
+  Request request(256, 16384, 16384);
+  checkSame(buf, wire::encodeRequest(buf, 256, 16384, 16384), request);
+
+  Cancel cancel(256, 16384, 16384);
+  checkSame(buf, wire::encodeCancel(buf, 256, 16384, 16384), cancel);
+
+  // the header of a Piece is its encoding up to the block
+  uint8_t block[] = {1, 2, 3};
+  Piece piece(7, 32768, make_shared<Buffer>(block, sizeof(block)));
+  ConstBufferPtr encoded = piece.encode();
+  size_t length = wire::encodePieceHeader(buf, 7, 32768, sizeof(block));
+  BOOST_CHECK_EQUAL_COLLECTIONS(buf, buf + length, encoded->begin(), encoded->end() - 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace msg
+} // namespace sbt
@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/outbound-queue.hpp"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestOutboundQueue)
+
+static ConstBufferPtr
+makeMessage(size_t size, uint8_t fill)
+{
+  return make_shared<Buffer>(std::vector<uint8_t>(size, fill).data(), size);
+}
+
+static std::vector<uint8_t>
+readAll(int fd)
+{
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+    data.insert(data.end(), buf, buf + n);
+  return data;
+}
+
+BOOST_AUTO_TEST_CASE(Batched)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  // more messages than fit one sendmsg
+  OutboundQueue queue;
+  for (size_t i = 0; i < OutboundQueue::MAX_IOV + 6; i++)
+    queue.push(makeMessage(5, i));
+  queue.push(make_shared<Buffer>());
+  BOOST_CHECK_EQUAL(queue.size(), (OutboundQueue::MAX_IOV + 6) * 5);
+
+  BOOST_CHECK_EQUAL(queue.flush(fds[0]), (OutboundQueue::MAX_IOV + 6) * 5);
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(queue.size(), 0);
+
+  std::vector<uint8_t> data = readAll(fds[1]);
+  BOOST_REQUIRE_EQUAL(data.size(), (OutboundQueue::MAX_IOV + 6) * 5);
+  BOOST_CHECK_EQUAL(data[0], 0);
+  BOOST_CHECK_EQUAL(data[5 * 69], 69);
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(Partial)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  int size = 4096;
+  setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+  OutboundQueue queue;
+  std::vector<uint8_t> expected;
+  for (int i = 0; i < 64; i++) {
+    queue.push(makeMessage(16384 + 13, i));
+    expected.insert(expected.end(), 16384 + 13, i);
+  }
+
+  // the socket fills up long before the queue is empty; whatever was taken is taken
+  // exactly once and in order
+  std::vector<uint8_t> data;
+  while (!queue.empty()) {
+    ssize_t n = queue.flush(fds[0]);
+    BOOST_REQUIRE(n > 0 || n == -EAGAIN);
+    std::vector<uint8_t> chunk = readAll(fds[1]);
+    data.insert(data.end(), chunk.begin(), chunk.end());
+  }
+
+  BOOST_CHECK(data == expected);
+  BOOST_CHECK_EQUAL(queue.flush(fds[0]), 0);
+
+  close(fds[1]);
+  queue.push(makeMessage(10, 1));
+  BOOST_CHECK_EQUAL(queue.flush(fds[0]), -EPIPE);
+  BOOST_CHECK_EQUAL(queue.size(), 10);
+  close(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE(Copies)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  OutboundQueue queue;
+  uint8_t message[] = {0, 0, 0, 1, 2};
+  queue.pushCopy(message, sizeof(message));
+  message[4] = 3;
+  queue.pushCopy(message, sizeof(message));
+  queue.push(makeMessage(7, 9));
+  queue.pushCopy(message, sizeof(message));
+  BOOST_CHECK_EQUAL(queue.size(), 22);
+
+  // copies are taken at once, the buffer can change right after
+  BOOST_CHECK_EQUAL(queue.flush(fds[0]), 22);
+  std::vector<uint8_t> data = readAll(fds[1]);
+  BOOST_REQUIRE_EQUAL(data.size(), 22);
+  BOOST_CHECK_EQUAL(data[4], 2);
+  BOOST_CHECK_EQUAL(data[9], 3);
+  BOOST_CHECK_EQUAL(data[10], 9);
+  BOOST_CHECK_EQUAL(data[21], 3);
+
+  // far more than one arena's worth
+  for (size_t i = 0; i < OutboundQueue::ARENA_SIZE; i++)
+    queue.pushCopy(message, sizeof(message));
+  BOOST_CHECK_EQUAL(queue.flush(fds[0]), OutboundQueue::ARENA_SIZE * 5);
+  BOOST_CHECK_EQUAL(readAll(fds[1]).size(), OutboundQueue::ARENA_SIZE * 5);
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(Cancel)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  int size = 4096;
+  setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+  // header and block of three pieces, with a control message in between
+  OutboundQueue queue;
+  uint8_t header[] = {0, 0, 64, 9, 7};
+  uint8_t choke[] = {0, 0, 0, 1, 0};
+  for (uint64_t tag = 1; tag <= 3; tag++) {
+    queue.pushCopy(header, sizeof(header), tag);
+    queue.push(BufferView(makeMessage(16384, tag)), tag);
+    queue.pushCopy(choke, sizeof(choke));
+  }
+  BOOST_CHECK_EQUAL(queue.size(), 3 * (16384 + 10));
+
+  // not written yet, the copies around it stay
+  BOOST_CHECK_EQUAL(queue.cancel(2), 16384 + 5);
+  BOOST_CHECK_EQUAL(queue.cancel(2), 0);
+  BOOST_CHECK_EQUAL(queue.cancel(0), 0);
+
+  // partly written, it has to go out whole
+  BOOST_REQUIRE(queue.flush(fds[0]) > 0);
+  BOOST_CHECK_EQUAL(queue.cancel(1), 0);
+
+  std::vector<uint8_t> data;
+  while (!queue.empty()) {
+    BOOST_REQUIRE(queue.flush(fds[0]) != 0);
+    std::vector<uint8_t> chunk = readAll(fds[1]);
+    data.insert(data.end(), chunk.begin(), chunk.end());
+  }
+  std::vector<uint8_t> chunk = readAll(fds[1]);
+  data.insert(data.end(), chunk.begin(), chunk.end());
+
+  BOOST_REQUIRE_EQUAL(data.size(), 2 * (16384 + 5) + 3 * 5);
+  BOOST_CHECK_EQUAL(data[5], 1);
+  BOOST_CHECK_EQUAL(data[16389 + 3], 1);
+  BOOST_CHECK_EQUAL(data[16394 + 3], 1);
+  BOOST_CHECK_EQUAL(data[16399 + 4], 7);
+  BOOST_CHECK_EQUAL(data[16404], 3);
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,86 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "peer-connection.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestPeerConnection)
+
+BOOST_AUTO_TEST_CASE(Defaults)
+{
+  PeerTable peers;
+  PeerConnection& peer = peers.add(5);
+
+  BOOST_CHECK_EQUAL(peer.sockfd, 5);
+  BOOST_CHECK_EQUAL(peer.phase, PeerConnection::PHASE_HANDSHAKE);
+  BOOST_CHECK(peer.amChoking);
+  BOOST_CHECK(!peer.amInterested);
+  BOOST_CHECK(peer.peerChoking);
+  BOOST_CHECK(!peer.peerInterested);
+  BOOST_CHECK(peer.bitfield.empty());
+  BOOST_CHECK(peer.output.empty());
+  BOOST_CHECK_EQUAL(peer.input.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FindBySocket)
+{
+  PeerTable peers;
+  BOOST_CHECK(peers.find(3) == nullptr);
+  BOOST_CHECK(peers.find(-1) == nullptr);
+
+  PeerConnection& a = peers.add(7);
+  PeerConnection& b = peers.add(3);
+  PeerConnection& c = peers.add(12);
+  BOOST_CHECK_EQUAL(peers.size(), 3);
+  BOOST_CHECK(peers.find(7) == &a);
+  BOOST_CHECK(peers.find(3) == &b);
+  BOOST_CHECK(peers.find(12) == &c);
+  BOOST_CHECK(peers.find(4) == nullptr);
+  BOOST_CHECK(peers.find(100) == nullptr);
+
+  // the others stay where they are
+  peers.remove(7);
+  BOOST_CHECK_EQUAL(peers.size(), 2);
+  BOOST_CHECK(peers.find(7) == nullptr);
+  BOOST_CHECK(peers.find(3) == &b);
+  BOOST_CHECK(peers.find(12) == &c);
+
+  size_t count = 0;
+  for (PeerTable::const_iterator it = peers.begin(); it != peers.end(); it++) {
+    BOOST_CHECK((*it)->sockfd == 3 || (*it)->sockfd == 12);
+    count++;
+  }
+  BOOST_CHECK_EQUAL(count, 2);
+
+  peers.remove(7);
+  peers.remove(3);
+  peers.remove(12);
+  BOOST_CHECK(peers.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ReusedSocket)
+{
+  PeerTable peers;
+  uint64_t first = peers.add(4).serial;
+  BOOST_CHECK(peers.find(4, first) != nullptr);
+
+  // a later connection on the same socket is not taken for the first one
+  peers.remove(4);
+  uint64_t second = peers.add(4).serial;
+  BOOST_CHECK(second != first);
+  BOOST_CHECK(peers.find(4, first) == nullptr);
+  BOOST_CHECK(peers.find(4, second) != nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
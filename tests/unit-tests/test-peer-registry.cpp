@@ -0,0 +1,90 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "peer-registry.hpp"
+
+#include <arpa/inet.h>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestPeerRegistry)
+
+BOOST_AUTO_TEST_CASE(Intern)
+{
+  PeerRegistry registry;
+  PeerEndpoint a = PeerRegistry::makeEndpoint("10.0.0.1", 6881);
+  PeerEndpoint b = PeerRegistry::makeEndpoint("10.0.0.1", 6882);
+  PeerEndpoint c = PeerRegistry::makeEndpoint("10.0.0.2", 6881);
+
+  BOOST_CHECK_EQUAL(registry.find(a), PeerRegistry::INVALID_ID);
+
+  // ids are handed out densely, in order
+  BOOST_CHECK_EQUAL(registry.intern(a), 0);
+  BOOST_CHECK_EQUAL(registry.intern(b), 1);
+  BOOST_CHECK_EQUAL(registry.intern(c), 2);
+  BOOST_CHECK_EQUAL(registry.intern(b), 1);
+  BOOST_CHECK_EQUAL(registry.find(c), 2);
+  BOOST_CHECK_EQUAL(registry.size(), 3);
+
+  BOOST_CHECK_EQUAL(registry.getEndpoint(2).getIp(), "10.0.0.2");
+  BOOST_CHECK_EQUAL(registry.getEndpoint(2).getPort(), 6881);
+}
+
+BOOST_AUTO_TEST_CASE(TrackerEndpoint)
+{
+  // the same peer, as a tracker reports it and as it connects to us
+  PeerEndpoint reported;
+  memset(&reported, 0, sizeof(reported));
+  reported.family = AF_INET;
+  reported.port = htons(51413);
+  uint8_t addr[] = {192, 168, 1, 20};
+  memcpy(reported.addr, addr, sizeof(addr));
+
+  PeerRegistry registry;
+  PeerRegistry::PeerId id = registry.intern(reported);
+  BOOST_CHECK_EQUAL(registry.find(PeerRegistry::makeEndpoint("192.168.1.20", 51413)), id);
+}
+
+BOOST_AUTO_TEST_CASE(Sockets)
+{
+  PeerRegistry registry;
+  PeerRegistry::PeerId id = registry.intern(PeerRegistry::makeEndpoint("10.0.0.1", 6881));
+  BOOST_CHECK_EQUAL(registry.getSocket(id), PeerRegistry::NO_SOCKET);
+
+  registry.setSocket(id, 9);
+  registry.intern(PeerRegistry::makeEndpoint("10.0.0.3", 6881));
+  BOOST_CHECK_EQUAL(registry.getSocket(id), 9);
+  BOOST_CHECK_EQUAL(registry.getSocket(id + 1), PeerRegistry::NO_SOCKET);
+}
+
+BOOST_AUTO_TEST_CASE(Many)
+{
+  PeerRegistry registry;
+  for (uint32_t i = 0; i < 5000; i++) {
+    PeerEndpoint endpoint = PeerRegistry::makeEndpoint("10.0.0.1", 0);
+    endpoint.addr[2] = i >> 8;
+    endpoint.addr[3] = i;
+    endpoint.port = htons(6881 + i % 7);
+    BOOST_REQUIRE_EQUAL(registry.intern(endpoint), i);
+  }
+
+  for (uint32_t i = 0; i < 5000; i++) {
+    PeerEndpoint endpoint = PeerRegistry::makeEndpoint("10.0.0.1", 0);
+    endpoint.addr[2] = i >> 8;
+    endpoint.addr[3] = i;
+    endpoint.port = htons(6881 + i % 7);
+    BOOST_REQUIRE_EQUAL(registry.find(endpoint), i);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "piece-picker.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestPiecePicker)
+
+BOOST_AUTO_TEST_CASE(Blocks)
+{
+  // two full pieces of two blocks each, last piece is half a block
+  PiecePicker picker(3, 32768, 32768 * 2 + 8192);
+  uint8_t all[] = {0xE0};
+
+  BOOST_CHECK_EQUAL(picker.getPieceLength(2), 8192);
+
+  auto blocks = picker.pick(all, sizeof(all), 1, 10);
+  BOOST_REQUIRE_EQUAL(blocks.size(), 5);
+  BOOST_CHECK_EQUAL(blocks[1].index, 0);
+  BOOST_CHECK_EQUAL(blocks[1].begin, 16384);
+  BOOST_CHECK_EQUAL(blocks[1].length, 16384);
+  BOOST_CHECK_EQUAL(blocks[4].index, 2);
+  BOOST_CHECK_EQUAL(blocks[4].length, 8192);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(1), 5);
+}
+
+BOOST_AUTO_TEST_CASE(PeerBitfield)
+{
+  PiecePicker picker(3, 16384, 16384 * 3);
+  uint8_t second[] = {0x40};
+
+  auto blocks = picker.pick(second, sizeof(second), 1, 10);
+  BOOST_REQUIRE_EQUAL(blocks.size(), 1);
+  BOOST_CHECK_EQUAL(blocks[0].index, 1);
+  BOOST_CHECK_EQUAL(picker.isEndgame(), false);
+}
+
+BOOST_AUTO_TEST_CASE(Endgame)
+{
+  PiecePicker picker(2, 16384, 16384 * 2);
+  uint8_t all[] = {0xC0};
+
+  auto first = picker.pick(all, sizeof(all), 1, 1);
+  BOOST_REQUIRE_EQUAL(first.size(), 1);
+  BOOST_CHECK_EQUAL(picker.isEndgame(), false);
+
+  auto second = picker.pick(all, sizeof(all), 2, 1);
+  BOOST_REQUIRE_EQUAL(second.size(), 1);
+  BOOST_CHECK_EQUAL(picker.isEndgame(), true);
+
+  // peer 3 gets duplicates of everything still outstanding
+  auto third = picker.pick(all, sizeof(all), 3, 10);
+  BOOST_REQUIRE_EQUAL(third.size(), 2);
+
+  // asking again must not duplicate at the same peer
+  BOOST_CHECK_EQUAL(picker.pick(all, sizeof(all), 3, 10).size(), 0);
+
+  std::vector<int> cancels;
+  BOOST_CHECK_EQUAL(picker.markReceived(first[0], 3, cancels), PiecePicker::RECEIVE_PIECE_DONE);
+  BOOST_REQUIRE_EQUAL(cancels.size(), 1);
+  BOOST_CHECK_EQUAL(cancels[0], 1);
+
+  // the block is no longer outstanding anywhere
+  BOOST_CHECK_EQUAL(picker.getOutstanding(1), 0);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(2), 1);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(3), 1);
+
+  // late copy from the cancelled peer is ignored
+  BOOST_CHECK_EQUAL(picker.markReceived(first[0], 1, cancels), PiecePicker::RECEIVE_REJECTED);
+  BOOST_CHECK_EQUAL(cancels.size(), 0);
+
+  // the duplicate at peer 3 goes back to peer 2 alone
+  auto aborted = picker.abortPeer(3);
+  BOOST_REQUIRE_EQUAL(aborted.size(), 1);
+  BOOST_CHECK_EQUAL(aborted[0].index, 1);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(3), 0);
+  BOOST_CHECK_EQUAL(picker.isEndgame(), true);
+}
+
+BOOST_AUTO_TEST_CASE(AbortAndFail)
+{
+  PiecePicker picker(1, 32768, 32768);
+  uint8_t all[] = {0x80};
+
+  auto blocks = picker.pick(all, sizeof(all), 1, 10);
+  BOOST_REQUIRE_EQUAL(blocks.size(), 2);
+
+  std::vector<int> cancels;
+  BOOST_CHECK_EQUAL(picker.markReceived(blocks[0], 1, cancels), PiecePicker::RECEIVE_ACCEPTED);
+
+  BOOST_CHECK_EQUAL(picker.abortPeer(1).size(), 1);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(1), 0);
+
+  auto again = picker.pick(all, sizeof(all), 2, 10);
+  BOOST_REQUIRE_EQUAL(again.size(), 1);
+  BOOST_CHECK_EQUAL(again[0].begin, 16384);
+  BOOST_CHECK_EQUAL(picker.markReceived(again[0], 2, cancels), PiecePicker::RECEIVE_PIECE_DONE);
+
+  picker.pieceFailed(0);
+  BOOST_CHECK_EQUAL(picker.pick(all, sizeof(all), 2, 10).size(), 2);
+
+  picker.setHave(0);
+  BOOST_CHECK_EQUAL(picker.isComplete(), true);
+  BOOST_CHECK_EQUAL(picker.isEndgame(), false);
+}
+
+BOOST_AUTO_TEST_CASE(SnubReassign)
+{
+  // three pieces of two blocks; peer 2 only has the first
+  PiecePicker picker(3, 32768, 32768 * 3);
+  uint8_t all[] = {0xE0};
+  uint8_t first[] = {0x80};
+
+  auto blocks = picker.pick(all, sizeof(all), 1, 4);
+  BOOST_REQUIRE_EQUAL(blocks.size(), 4);
+  BOOST_CHECK_EQUAL(picker.pick(first, sizeof(first), 2, 4).size(), 0);
+  BOOST_CHECK_EQUAL(picker.isEndgame(), false);
+
+  // peer 1 goes silent and its blocks are taken back
+  auto aborted = picker.abortPeer(1);
+  BOOST_CHECK_EQUAL(aborted.size(), 4);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(1), 0);
+
+  // the peer that has them gets them
+  auto reassigned = picker.pick(first, sizeof(first), 2, 4);
+  BOOST_REQUIRE_EQUAL(reassigned.size(), 2);
+  BOOST_CHECK_EQUAL(reassigned[0].index, 0);
+  BOOST_CHECK_EQUAL(reassigned[1].begin, 16384);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(2), 2);
+
+  // a late block from the snubbed peer still counts, and is cancelled at the other
+  std::vector<int> cancels;
+  BOOST_CHECK_EQUAL(picker.markReceived(blocks[0], 1, cancels), PiecePicker::RECEIVE_ACCEPTED);
+  BOOST_REQUIRE_EQUAL(cancels.size(), 1);
+  BOOST_CHECK_EQUAL(cancels[0], 2);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(2), 1);
+}
+
+BOOST_AUTO_TEST_CASE(RejectUnrequested)
+{
+  // the last piece is 20000 bytes: a full block and one of 3616
+  PiecePicker picker(2, 32768, 32768 + 20000);
+  uint8_t all[] = {0xC0};
+  std::vector<int> cancels;
+
+  PiecePicker::Block block = {1, 0, 16384};
+  BOOST_CHECK_EQUAL(picker.markReceived(block, 1, cancels), PiecePicker::RECEIVE_REJECTED);
+
+  auto blocks = picker.pick(all, sizeof(all), 1, 10);
+  BOOST_REQUIRE_EQUAL(blocks.size(), 4);
+  BOOST_CHECK_EQUAL(blocks[3].length, 3616);
+
+  block = {5, 0, 16384};
+  BOOST_CHECK_EQUAL(picker.markReceived(block, 1, cancels), PiecePicker::RECEIVE_REJECTED);
+  block = {1, 16384, 16384};
+  BOOST_CHECK_EQUAL(picker.markReceived(block, 1, cancels), PiecePicker::RECEIVE_REJECTED);
+  block = {1, 16384, 100};
+  BOOST_CHECK_EQUAL(picker.markReceived(block, 1, cancels), PiecePicker::RECEIVE_REJECTED);
+  block = {1, 100, 3616};
+  BOOST_CHECK_EQUAL(picker.markReceived(block, 1, cancels), PiecePicker::RECEIVE_REJECTED);
+  BOOST_CHECK_EQUAL(picker.getOutstanding(1), 4);
+
+  BOOST_CHECK_EQUAL(picker.markReceived(blocks[3], 1, cancels), PiecePicker::RECEIVE_ACCEPTED);
+  BOOST_CHECK_EQUAL(picker.hasPiece(7), false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
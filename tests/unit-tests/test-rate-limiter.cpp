@@ -0,0 +1,78 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/rate-limiter.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestRateLimiter)
+
+BOOST_AUTO_TEST_CASE(Unlimited)
+{
+  RateLimiter limiter;
+  BOOST_CHECK_EQUAL(limiter.reserve(1 << 30, 1000), 0);
+  BOOST_CHECK_EQUAL(limiter.reserve(1 << 30, 1000), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Debt)
+{
+  RateLimiter limiter(1000);
+  BOOST_CHECK_EQUAL(limiter.reserve(500, 1000), 0);
+
+  // half of it is already spent
+  BOOST_CHECK_EQUAL(limiter.reserve(1000, 1000), 500);
+
+  // 500 ms later the debt is paid off
+  BOOST_CHECK_EQUAL(limiter.reserve(100, 1500), 100);
+
+  // a long pause refills no more than one second's worth
+  BOOST_CHECK_EQUAL(limiter.reserve(1000, 10000), 0);
+  BOOST_CHECK_EQUAL(limiter.reserve(1, 10000), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Fraction)
+{
+  RateLimiter limiter(3);
+  BOOST_CHECK_EQUAL(limiter.reserve(3, 1000), 0);
+  BOOST_CHECK_EQUAL(limiter.reserve(1, 1200), 334);
+
+  // credits one byte at 1333 ms, not 1400 ms, so the next one is due at 1667 ms
+  BOOST_CHECK_EQUAL(limiter.reserve(0, 1400), 0);
+  BOOST_CHECK_EQUAL(limiter.reserve(1, 1700), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Lease)
+{
+  RateLimiter limiter(100000);
+  std::mutex mutex;
+  RateLease busy(limiter, mutex);
+  RateLease idle(limiter, mutex);
+
+  // the first reservation takes a tenth of a second's worth, the rest comes from it
+  BOOST_CHECK_EQUAL(busy.reserve(1000, 1000), 0);
+  for (int i = 0; i < 9; i++)
+    BOOST_CHECK_EQUAL(busy.reserve(1000, 1000), 0);
+
+  // an idle lease leaves the whole rate to the busy one
+  for (int i = 0; i < 9; i++)
+    BOOST_CHECK_EQUAL(busy.reserve(10000, 1000), 0);
+  BOOST_CHECK_EQUAL(busy.reserve(10000, 1000), 100);
+
+  // both draw from the same bucket
+  BOOST_CHECK_EQUAL(idle.reserve(1000, 1000), 200);
+  BOOST_CHECK_EQUAL(idle.getRate(), 100000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,74 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/raw-buffer.hpp"
+#include "util/buffer-stream.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestRawBuffer)
+
+BOOST_AUTO_TEST_CASE(AppendAndReuse)
+{
+  RawBuffer buffer;
+  BOOST_CHECK(buffer.empty());
+
+  buffer.append("abc", 3);
+  buffer.append("defg", 4);
+  BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(buffer.data()), buffer.size()),
+                    "abcdefg");
+
+  // cleared, the memory is still there for the next message
+  const uint8_t* data = buffer.data();
+  size_t capacity = buffer.capacity();
+  buffer.clear();
+  BOOST_CHECK_EQUAL(buffer.size(), 0);
+  buffer.append("xy", 2);
+  BOOST_CHECK(buffer.data() == data);
+  BOOST_CHECK_EQUAL(buffer.capacity(), capacity);
+
+  // growing keeps the contents
+  buffer.resize(1000);
+  BOOST_CHECK_EQUAL(buffer.size(), 1000);
+  BOOST_CHECK_EQUAL(buffer.data()[0], 'x');
+  BOOST_CHECK_EQUAL(buffer.data()[1], 'y');
+
+  buffer.reserve(10);
+  BOOST_CHECK_GE(buffer.capacity(), 1000);
+
+  RawBuffer moved(std::move(buffer));
+  BOOST_CHECK_EQUAL(moved.size(), 1000);
+  BOOST_CHECK_EQUAL(buffer.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Stream)
+{
+  std::string block(10000, 'b');
+
+  OBufferStream os(4);
+  os.put('a');
+  os.write(block.data(), block.size());
+  os.write("cd", 2);
+
+  ConstBufferPtr result = os.buf();
+  BOOST_REQUIRE_EQUAL(result->size(), 10003);
+  BOOST_CHECK_EQUAL((*result)[0], 'a');
+  BOOST_CHECK_EQUAL((*result)[10000], 'b');
+  BOOST_CHECK_EQUAL((*result)[10002], 'd');
+
+  BOOST_CHECK_EQUAL(OBufferStream().buf()->size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
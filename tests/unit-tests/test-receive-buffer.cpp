@@ -0,0 +1,74 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/receive-buffer.hpp"
+
+#include <string.h>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestReceiveBuffer)
+
+static void
+receive(ReceiveBuffer& buffer, const std::string& bytes)
+{
+  memcpy(buffer.prepare(bytes.size()), bytes.data(), bytes.size());
+  buffer.commit(bytes.size());
+}
+
+static std::string
+toString(const BufferView& view)
+{
+  return std::string(reinterpret_cast<const char*>(view.data()), view.size());
+}
+
+BOOST_AUTO_TEST_CASE(ViewsOutliveGrowth)
+{
+  ReceiveBuffer buffer(8);
+  receive(buffer, "abcdef");
+  const uint8_t* chunk = buffer.data();
+
+  BufferView view = buffer.view(2, 3);
+  BOOST_CHECK(view.data() == chunk + 2);
+  buffer.consume(4);
+
+  // no room left: the unconsumed tail moves, the viewed bytes stay put
+  receive(buffer, "ghijklmn");
+  BOOST_CHECK(buffer.data() != chunk);
+  BOOST_CHECK_EQUAL(toString(buffer.view(0, buffer.size())), "efghijklmn");
+  BOOST_CHECK_EQUAL(toString(view), "cde");
+}
+
+BOOST_AUTO_TEST_CASE(Compaction)
+{
+  ReceiveBuffer buffer(8);
+  receive(buffer, "abcdef");
+  const uint8_t* chunk = buffer.data();
+  buffer.consume(4);
+
+  // nothing refers to the chunk, so the tail moves to its front
+  receive(buffer, "ghij");
+  BOOST_CHECK(buffer.data() == chunk);
+  BOOST_CHECK_EQUAL(toString(buffer.view(0, buffer.size())), "efghij");
+
+  // a fully consumed chunk starts over, unless it is still viewed
+  BufferView view = buffer.view(0, 2);
+  buffer.consume(6);
+  receive(buffer, "kl");
+  BOOST_CHECK(buffer.data() != chunk);
+  BOOST_CHECK_EQUAL(toString(view), "ef");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,68 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/resolver.hpp"
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestResolver)
+
+BOOST_AUTO_TEST_CASE(Cache)
+{
+  EventLoop loop;
+  Resolver resolver(loop);
+  int nAnswers = 0;
+
+  auto check = [&] (int rc, const sockaddr_storage& addr, socklen_t length) {
+    BOOST_REQUIRE_EQUAL(rc, 0);
+    BOOST_REQUIRE_EQUAL(addr.ss_family, AF_INET);
+    const sockaddr_in& in = reinterpret_cast<const sockaddr_in&>(addr);
+    BOOST_CHECK_EQUAL(in.sin_addr.s_addr, inet_addr("127.0.0.1"));
+    BOOST_CHECK_EQUAL(ntohs(in.sin_port), 6969);
+    if (++nAnswers == 3)
+      loop.stop();
+  };
+
+  // both share one query
+  resolver.resolve("127.0.0.1", "6969", check);
+  resolver.resolve("127.0.0.1", "6969", check);
+  BOOST_CHECK_EQUAL(nAnswers, 0); // never answered synchronously
+  loop.schedule(1, [&] { resolver.resolve("127.0.0.1", "6969", check); });
+  loop.run();
+
+  BOOST_CHECK_EQUAL(nAnswers, 3);
+  BOOST_CHECK_EQUAL(resolver.getCacheSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Failure)
+{
+  EventLoop loop;
+  Resolver resolver(loop);
+  int result = 0;
+
+  resolver.resolve("no such host.invalid", "80", [&] (int rc, const sockaddr_storage&, socklen_t) {
+    result = rc;
+    loop.stop();
+  });
+  loop.run();
+
+  BOOST_CHECK_NE(result, 0);
+  BOOST_CHECK_EQUAL(resolver.getCacheSize(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
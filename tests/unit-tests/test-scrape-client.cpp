@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "scrape-client.hpp"
+
+#include "boost-test.hpp"
+#include "local-tracker.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestScrapeClient)
+
+static std::vector<ConstBufferPtr>
+makeInfoHashes(size_t count)
+{
+  std::vector<ConstBufferPtr> infoHashes;
+  for (size_t i = 0; i < count; i++) {
+    auto infoHash = make_shared<Buffer>(20);
+    (*infoHash)[0] = i;
+    infoHashes.push_back(infoHash);
+  }
+  return infoHashes;
+}
+
+/**
+ * Runs one scrape to completion on @p loop and returns its rc.
+ */
+static int
+scrape(util::EventLoop& loop, ScrapeClient& client, const std::string& url,
+       const std::vector<ConstBufferPtr>& infoHashes, std::vector<ScrapeClient::Entry>& entries)
+{
+  int result = 1;
+  client.scrape(url, infoHashes, [&] (int rc, const std::vector<ScrapeClient::Entry>& e) {
+    result = rc;
+    entries = e;
+    loop.stop();
+  });
+
+  loop.run();
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE(ScrapeUrl)
+{
+  std::string url;
+  BOOST_REQUIRE(ScrapeClient::getScrapeUrl("http://example.com/announce", url));
+  BOOST_CHECK_EQUAL(url, "http://example.com/scrape");
+
+  BOOST_REQUIRE(ScrapeClient::getScrapeUrl("http://example.com/x/announce.php?key=a/b", url));
+  BOOST_CHECK_EQUAL(url, "http://example.com/x/scrape.php?key=a/b");
+
+  BOOST_REQUIRE(ScrapeClient::getScrapeUrl("udp://example.com:6969", url));
+  BOOST_CHECK_EQUAL(url, "udp://example.com:6969");
+
+  BOOST_CHECK(!ScrapeClient::getScrapeUrl("http://example.com/a", url));
+  BOOST_CHECK(!ScrapeClient::getScrapeUrl("http://example.com/announce/x", url));
+}
+
+BOOST_AUTO_TEST_CASE(DecodeFiles)
+{
+  auto infoHashes = makeInfoHashes(2);
+  std::string hash1(reinterpret_cast<const char*>(infoHashes[1]->buf()), 20);
+  std::string body = "d5:filesd20:" + hash1 + "d8:completei5e10:downloadedi50e10:incompletei3e"
+                     "4:name1:xeee";
+
+  std::vector<ScrapeClient::Entry> entries;
+  BOOST_REQUIRE(ScrapeClient::decodeFiles(reinterpret_cast<const uint8_t*>(body.data()), body.size(),
+                                          infoHashes, entries));
+  BOOST_REQUIRE_EQUAL(entries.size(), 2);
+  BOOST_CHECK_EQUAL(entries[0].seeders, 0);
+  BOOST_CHECK_EQUAL(entries[1].seeders, 5);
+  BOOST_CHECK_EQUAL(entries[1].completed, 50);
+  BOOST_CHECK_EQUAL(entries[1].leechers, 3);
+
+  std::string failure = "d14:failure reason4:nopee";
+  BOOST_CHECK(!ScrapeClient::decodeFiles(reinterpret_cast<const uint8_t*>(failure.data()),
+                                         failure.size(), infoHashes, entries));
+
+  std::string truncated = "d5:filesd20:" + hash1 + "d8:completei5e";
+  BOOST_CHECK_THROW(ScrapeClient::decodeFiles(reinterpret_cast<const uint8_t*>(truncated.data()),
+                                              truncated.size(), infoHashes, entries),
+                    bencoding::Error);
+}
+
+BOOST_AUTO_TEST_CASE(HttpBatches)
+{
+  auto infoHashes = makeInfoHashes(70);
+
+  // every response knows all 70 torrents; torrent i has i seeders
+  std::string files = "d5:filesd";
+  for (const auto& infoHash : infoHashes)
+    files += "20:" + std::string(reinterpret_cast<const char*>(infoHash->buf()), 20) +
+             "d8:completei" + std::to_string((*infoHash)[0]) + "ee";
+  files += "ee";
+  LocalTracker tracker(1, 2, [&] (int) { return files; });
+
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  ScrapeClient client(loop, resolver);
+
+  // 70 torrents take two requests over one connection
+  std::vector<ScrapeClient::Entry> entries;
+  BOOST_REQUIRE_EQUAL(scrape(loop, client, tracker.getUrl(), infoHashes, entries), 0);
+  BOOST_REQUIRE_EQUAL(entries.size(), 70);
+  BOOST_CHECK_EQUAL(entries[0].seeders, 0);
+  BOOST_CHECK_EQUAL(entries[63].seeders, 63);
+  BOOST_CHECK_EQUAL(entries[69].seeders, 69);
+  BOOST_CHECK_EQUAL(client.getRequestCount(), 2);
+  BOOST_CHECK_EQUAL(client.getCacheSize(), 70);
+
+  // answered from the cache
+  BOOST_REQUIRE_EQUAL(scrape(loop, client, tracker.getUrl(), makeInfoHashes(10), entries), 0);
+  BOOST_CHECK_EQUAL(entries[9].seeders, 9);
+  BOOST_CHECK_EQUAL(client.getRequestCount(), 2);
+
+  BOOST_CHECK_EQUAL(scrape(loop, client, "http://127.0.0.1/a", infoHashes, entries), RC_INVALID_URL);
+}
+
+BOOST_AUTO_TEST_CASE(UdpBatchesAndExpiry)
+{
+  LocalUdpTracker tracker;
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  ScrapeClient client(loop, resolver, 0);
+
+  // 80 torrents take two datagrams; the stand-in reports i + 1 seeders for the i-th
+  // torrent of each
+  auto infoHashes = makeInfoHashes(80);
+  std::vector<ScrapeClient::Entry> entries;
+  BOOST_REQUIRE_EQUAL(scrape(loop, client, tracker.getUrl(), infoHashes, entries), 0);
+  BOOST_REQUIRE_EQUAL(entries.size(), 80);
+  BOOST_CHECK_EQUAL(entries[73].seeders, 74);
+  BOOST_CHECK_EQUAL(entries[74].seeders, 1);
+  BOOST_CHECK_EQUAL(entries[79].completed, 60);
+  BOOST_CHECK_EQUAL(client.getRequestCount(), 2);
+
+  // with no TTL, the cached results have already expired
+  BOOST_REQUIRE_EQUAL(scrape(loop, client, tracker.getUrl(), infoHashes, entries), 0);
+  BOOST_CHECK_EQUAL(client.getRequestCount(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(UdpShortReply)
+{
+  // answers for only 3 of the torrents asked about
+  LocalUdpTracker tracker(0, 3);
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  ScrapeClient client(loop, resolver);
+
+  std::vector<ScrapeClient::Entry> entries;
+  BOOST_CHECK_EQUAL(scrape(loop, client, tracker.getUrl(), makeInfoHashes(10), entries),
+                    RC_TRACKER_RESPONSE_FAILED);
+  BOOST_CHECK(entries.empty());
+  BOOST_CHECK_EQUAL(client.getCacheSize(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
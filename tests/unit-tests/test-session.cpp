@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "session.hpp"
+
+#include <poll.h>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestSession)
+
+BOOST_AUTO_TEST_CASE(Shards)
+{
+  Session session("0", 1001, 4);
+  BOOST_REQUIRE_EQUAL(session.getShardCount(), 4);
+  BOOST_REQUIRE_EQUAL(session.listen(), 0);
+
+  uint16_t port = session.getShard(0).getAcceptor().getPort();
+  BOOST_CHECK_NE(port, 0);
+  for (size_t i = 0; i < session.getShardCount(); i++) {
+    BOOST_CHECK_EQUAL(session.getShard(i).getIndex(), i);
+    BOOST_CHECK_EQUAL(session.getShard(i).getAcceptor().getPort(), port);
+    BOOST_CHECK_EQUAL(session.getShard(i).getUploadLimiter().getRate(), 1001);
+  }
+
+  // the shared buffer pools are bounded
+  BOOST_CHECK_EQUAL(session.getBlockPool().getMaxBytes(), BLOCK_POOL_BYTES);
+  BOOST_CHECK_EQUAL(session.getChunkPool().getMaxBytes(), CHUNK_POOL_BYTES);
+}
+
+BOOST_AUTO_TEST_CASE(RunAndStop)
+{
+  Session session("0", 0, 3);
+  BOOST_REQUIRE_EQUAL(session.listen(), 0);
+  uint16_t port = session.getShard(0).getAcceptor().getPort();
+
+  std::thread thread([&] { session.run(); });
+
+  // nobody serves this torrent, so whichever shard accepts a connection closes it
+  auto infoHash = make_shared<Buffer>(20);
+  ConstBufferPtr handshake = msg::HandShake(infoHash, Session::generatePeerId()).encode();
+  std::vector<int> sockets;
+  for (int i = 0; i < 12; i++) {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    BOOST_REQUIRE_EQUAL(connect(sockfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    send(sockfd, handshake->buf(), handshake->size(), 0);
+    sockets.push_back(sockfd);
+  }
+
+  for (int sockfd : sockets) {
+    struct pollfd pfd;
+    pfd.fd = sockfd;
+    pfd.events = POLLIN;
+    BOOST_CHECK_EQUAL(poll(&pfd, 1, 5000), 1);
+
+    uint8_t byte;
+    BOOST_CHECK_EQUAL(recv(sockfd, &byte, 1, 0), 0);
+    close(sockfd);
+  }
+
+  session.stop();
+  thread.join();
+
+  size_t nRejected = 0;
+  for (size_t i = 0; i < session.getShardCount(); i++)
+    nRejected += session.getShard(i).getAcceptor().getRejectedCount();
+  BOOST_CHECK_EQUAL(nRejected, 12);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/slab-pool.hpp"
+
+#include <set>
+#include <thread>
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestSlabPool)
+
+BOOST_AUTO_TEST_CASE(Recycle)
+{
+  SlabPool pool(16384);
+  SlabPool::Cache cache(pool);
+
+  SlabPool::Slab slab = cache.acquire();
+  BOOST_REQUIRE(slab);
+  uint8_t* first = slab.get();
+  slab.reset();
+
+  // the returned slab comes back instead of a new one
+  slab = cache.acquire();
+  BOOST_CHECK(slab.get() == first);
+  BOOST_CHECK(pool.acquire().get() != first);
+  BOOST_CHECK_EQUAL(pool.getAllocatedBytes(), 2 * 16384);
+}
+
+BOOST_AUTO_TEST_CASE(Ceiling)
+{
+  SlabPool pool(1024, 2048);
+  SlabPool::Slab a = pool.acquire();
+  SlabPool::Slab b = pool.acquire();
+  BOOST_CHECK(a && b);
+  BOOST_CHECK(!pool.acquire());
+  BOOST_CHECK_EQUAL(pool.getAllocatedBytes(), 2048);
+
+  b.reset();
+  BOOST_CHECK(pool.acquire());
+
+  pool.setMaxBytes(0);
+  BOOST_CHECK(pool.acquire());
+}
+
+BOOST_AUTO_TEST_CASE(ReturnFromOtherThreads)
+{
+  SlabPool pool(64);
+  std::vector<SlabPool::Slab> slabs;
+  {
+    SlabPool::Cache cache(pool);
+    for (int i = 0; i < 1000; i++)
+      slabs.push_back(cache.acquire());
+  }
+
+  // dropped on four threads at once, the way disk jobs and other shards do
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    std::vector<SlabPool::Slab> part(slabs.begin() + t * 250, slabs.begin() + (t + 1) * 250);
+    threads.push_back(std::thread([part] () mutable { part.clear(); }));
+  }
+  slabs.clear();
+  for (auto& thread : threads)
+    thread.join();
+
+  // all of them are reused, none is handed out twice
+  SlabPool::Cache cache(pool);
+  std::set<uint8_t*> seen;
+  for (int i = 0; i < 1000; i++)
+    slabs.push_back(cache.acquire());
+  for (auto& slab : slabs)
+    seen.insert(slab.get());
+  BOOST_CHECK_EQUAL(seen.size(), 1000);
+  BOOST_CHECK_EQUAL(pool.getAllocatedBytes(), 1000 * 64);
+}
+
+BOOST_AUTO_TEST_CASE(SharedBetweenCaches)
+{
+  SlabPool pool(64, 200 * 64);
+  std::vector<SlabPool::Slab> slabs;
+  for (int i = 0; i < 200; i++)
+    slabs.push_back(pool.acquire());
+  slabs.clear();
+
+  // one cache takes no more than its share of what was returned
+  SlabPool::Cache busy(pool);
+  SlabPool::Slab kept = busy.acquire();
+
+  // so another one, at the ceiling, still gets slabs from the pool
+  SlabPool::Cache other(pool);
+  for (size_t i = 0; i < 200 - SlabPool::CACHE_SLABS; i++) {
+    slabs.push_back(other.acquire());
+    BOOST_REQUIRE(slabs.back());
+  }
+  BOOST_CHECK_EQUAL(pool.getAllocatedBytes(), 200 * 64);
+
+  // copies share the slab, which goes back once the last one is gone
+  SlabPool::Slab copy = kept;
+  uint8_t* first = kept.get();
+  kept.reset();
+  BOOST_CHECK(copy.get() == first);
+  copy.reset();
+  slabs.clear();
+  BOOST_CHECK(pool.acquire());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "util/timer-wheel.hpp"
+
+#include "boost-test.hpp"
+
+namespace sbt {
+namespace util {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestTimerWheel)
+
+BOOST_AUTO_TEST_CASE(Expiry)
+{
+  TimerWheel wheel(1000, 100);
+  std::vector<int> fired;
+
+  wheel.schedule(250, [&] { fired.push_back(1); });
+  wheel.schedule(100, [&] { fired.push_back(2); });
+  BOOST_CHECK_EQUAL(wheel.size(), 2);
+
+  wheel.advance(1150);
+  BOOST_REQUIRE_EQUAL(fired.size(), 1);
+  BOOST_CHECK_EQUAL(fired[0], 2);
+
+  wheel.advance(1299);
+  BOOST_CHECK_EQUAL(fired.size(), 1);
+  wheel.advance(1300);
+  BOOST_CHECK_EQUAL(fired.size(), 2);
+  BOOST_CHECK_EQUAL(wheel.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Levels)
+{
+  // delays that land in the second, third and fourth level of the wheel
+  TimerWheel wheel(0, 10);
+  std::vector<uint64_t> delays = {700, 45000, 3000000};
+  std::vector<uint64_t> fired;
+
+  for (auto delay : delays)
+    wheel.schedule(delay, [&fired, delay] { fired.push_back(delay); });
+
+  wheel.advance(690);
+  BOOST_CHECK_EQUAL(fired.size(), 0);
+  wheel.advance(700);
+  BOOST_REQUIRE_EQUAL(fired.size(), 1);
+
+  wheel.advance(44990);
+  BOOST_CHECK_EQUAL(fired.size(), 1);
+  wheel.advance(45000);
+  BOOST_REQUIRE_EQUAL(fired.size(), 2);
+
+  wheel.advance(2999990);
+  BOOST_CHECK_EQUAL(fired.size(), 2);
+  wheel.advance(3000000);
+  BOOST_REQUIRE_EQUAL(fired.size(), 3);
+  BOOST_CHECK_EQUAL(fired[2], 3000000);
+  BOOST_CHECK_EQUAL(wheel.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Timeout)
+{
+  TimerWheel wheel(0, 10);
+  BOOST_CHECK_EQUAL(wheel.getTimeout(0), -1);
+
+  wheel.schedule(50, [] {});
+  BOOST_CHECK_EQUAL(wheel.getTimeout(0), 50);
+
+  wheel.advance(40);
+  BOOST_CHECK_EQUAL(wheel.getTimeout(42), 8);
+}
+
+BOOST_AUTO_TEST_CASE(Cancel)
+{
+  TimerWheel wheel(0, 10);
+  bool fired = false;
+
+  auto id = wheel.schedule(50, [&] { fired = true; });
+  BOOST_CHECK_EQUAL(wheel.cancel(id), true);
+  BOOST_CHECK_EQUAL(wheel.cancel(id), false);
+
+  wheel.advance(1000);
+  BOOST_CHECK_EQUAL(fired, false);
+}
+
+BOOST_AUTO_TEST_CASE(Reschedule)
+{
+  TimerWheel wheel(0, 10);
+  int count = 0;
+
+  function<void()> tick = [&] {
+    if (++count < 3)
+      wheel.schedule(10, tick);
+  };
+  wheel.schedule(10, tick);
+
+  wheel.advance(10);
+  BOOST_CHECK_EQUAL(count, 1);
+  wheel.advance(30);
+  BOOST_CHECK_EQUAL(count, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace util
+} // namespace sbt
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "tracker-connection.hpp"
+
+#include "boost-test.hpp"
+#include "local-tracker.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestTrackerConnection)
+
+static const std::string REQUEST =
+  "GET /announce HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n";
+
+/**
+ * Runs one announce to completion on @p loop and returns its rc.
+ */
+static int
+announce(util::EventLoop& loop, TrackerConnection& connection, std::string& body)
+{
+  int result = 1;
+  connection.announce(REQUEST, [&] (int rc, const HttpResponseReader& reader) {
+    result = rc;
+    body.assign(reader.getBody().begin(), reader.getBody().end());
+    loop.stop();
+  });
+
+  BOOST_CHECK_EQUAL(connection.isBusy(), true);
+  loop.run();
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE(KeepAlive)
+{
+  LocalTracker tracker(1, 3);
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  TrackerConnection connection(loop, resolver, "127.0.0.1", tracker.getPort());
+
+  for (int i = 0; i < 3; i++) {
+    std::string body;
+    BOOST_REQUIRE_EQUAL(announce(loop, connection, body), 0);
+    BOOST_CHECK_EQUAL(body, "d8:intervali" + std::to_string(i) + "e5:peers0:e");
+  }
+
+  BOOST_CHECK_EQUAL(connection.getConnectCount(), 1);
+  BOOST_CHECK_EQUAL(connection.isConnected(), true);
+  BOOST_CHECK_EQUAL(resolver.getCacheSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Reconnect)
+{
+  // the tracker drops the connection after every response
+  LocalTracker tracker(2, 1);
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  TrackerConnection connection(loop, resolver, "127.0.0.1", tracker.getPort());
+
+  std::string body;
+  BOOST_REQUIRE_EQUAL(announce(loop, connection, body), 0);
+
+  // give the tracker time to close its end
+  usleep(50000);
+
+  BOOST_REQUIRE_EQUAL(announce(loop, connection, body), 0);
+  BOOST_CHECK_EQUAL(body, "d8:intervali0e5:peers0:e");
+  BOOST_CHECK_EQUAL(connection.getConnectCount(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(Unreachable)
+{
+  // nothing listens on port 1, the connect is refused
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  TrackerConnection connection(loop, resolver, "127.0.0.1", "1");
+
+  std::string body;
+  BOOST_CHECK_EQUAL(announce(loop, connection, body), RC_TRACKER_CONNECTION_FAILED);
+  BOOST_CHECK_EQUAL(connection.isConnected(), false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
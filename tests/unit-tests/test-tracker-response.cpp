@@ -21,6 +21,8 @@
 
 #include "tracker-response.hpp"
 #include <sstream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 
 #include "boost-test.hpp"
 
@@ -129,6 +131,76 @@ BOOST_AUTO_TEST_CASE(Basic)
   BOOST_CHECK_EQUAL(response20.getFailure(), "no torrent");
 }
 
+BOOST_AUTO_TEST_CASE(Compact)
+{
+  const char encoded[] =
+    "d"
+      "8:intervali1800e"
+      "5:peers12:"
+        "\x7f\x00\x00\x01\x1a\xe1"
+        "\x0a\x01\x02\x03\x30\x39"
+      "6:peers618:"
+        "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01\x1a\xe2"
+    "e";
+
+  std::stringstream ss(std::string(encoded, sizeof(encoded) - 1));
+  bencoding::Dictionary dict;
+  dict.wireDecode(ss);
+
+  TrackerResponse response;
+  response.decode(dict);
+
+  BOOST_CHECK_EQUAL(response.isFailure(), false);
+  BOOST_CHECK_EQUAL(response.getPeers().size(), 0);
+
+  const std::vector<PeerEndpoint>& endpoints = response.getEndpoints();
+  BOOST_REQUIRE_EQUAL(endpoints.size(), 3);
+
+  BOOST_CHECK_EQUAL(endpoints[0].family, AF_INET);
+  BOOST_CHECK_EQUAL(endpoints[0].getIp(), "127.0.0.1");
+  BOOST_CHECK_EQUAL(endpoints[0].getPort(), 6881);
+  BOOST_CHECK_EQUAL(endpoints[1].getIp(), "10.1.2.3");
+  BOOST_CHECK_EQUAL(endpoints[1].getPort(), 12345);
+
+  BOOST_CHECK_EQUAL(endpoints[2].family, AF_INET6);
+  BOOST_CHECK_EQUAL(endpoints[2].getIp(), "::1");
+  BOOST_CHECK_EQUAL(endpoints[2].getPort(), 6882);
+
+  struct sockaddr_storage ss4;
+  BOOST_CHECK_EQUAL(endpoints[0].toSockaddr(ss4), sizeof(struct sockaddr_in));
+  BOOST_CHECK_EQUAL(reinterpret_cast<struct sockaddr_in*>(&ss4)->sin_port, htons(6881));
+}
+
+BOOST_AUTO_TEST_CASE(CompactPartial)
+{
+  const char encoded[] = "d8:intervali1800e5:peers5:\x7f\x00\x00\x01\x1a" "e";
+
+  std::stringstream ss(std::string(encoded, sizeof(encoded) - 1));
+  bencoding::Dictionary dict;
+  dict.wireDecode(ss);
+
+  TrackerResponse response;
+  BOOST_CHECK_THROW(response.decode(dict), TrackerResponse::Error);
+}
+
+BOOST_AUTO_TEST_CASE(DictionaryEndpoints)
+{
+  TrackerResponse response(100);
+
+  PeerInfo info;
+  info.peerId = "abcdefghjkABCDEFGHJK";
+  info.ip = "127.0.0.1";
+  info.port = 12345;
+  response.addPeer(info);
+
+  TrackerResponse decoded;
+  decoded.decode(*response.encode());
+
+  BOOST_REQUIRE_EQUAL(decoded.getEndpoints().size(), 1);
+  BOOST_CHECK_EQUAL(decoded.getEndpoints()[0].getIp(), "127.0.0.1");
+  BOOST_CHECK_EQUAL(decoded.getEndpoints()[0].getPort(), 12345);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace test
@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "tracker-set.hpp"
+
+#include "boost-test.hpp"
+#include "local-tracker.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestTrackerSet)
+
+BOOST_AUTO_TEST_CASE(ParseUrl)
+{
+  std::string host, port, path;
+
+  BOOST_REQUIRE(TrackerSet::parseUrl("http://tracker.com:6969/announce", host, port, path));
+  BOOST_CHECK_EQUAL(host, "tracker.com");
+  BOOST_CHECK_EQUAL(port, "6969");
+  BOOST_CHECK_EQUAL(path, "announce");
+
+  BOOST_REQUIRE(TrackerSet::parseUrl("http://tracker.com/a/announce.php", host, port, path));
+  BOOST_CHECK_EQUAL(host, "tracker.com");
+  BOOST_CHECK_EQUAL(port, "80");
+  BOOST_CHECK_EQUAL(path, "a/announce.php");
+
+  BOOST_REQUIRE(TrackerSet::parseUrl("udp://tracker.com:6969", host, port, path));
+  BOOST_CHECK_EQUAL(host, "tracker.com");
+  BOOST_CHECK_EQUAL(port, "6969");
+  BOOST_CHECK_EQUAL(path, "");
+
+  BOOST_CHECK(!TrackerSet::parseUrl("udp://tracker.com", host, port, path));
+  BOOST_CHECK(!TrackerSet::parseUrl("wss://tracker.com:6969", host, port, path));
+  BOOST_CHECK(!TrackerSet::parseUrl("http:///announce", host, port, path));
+}
+
+/**
+ * Compact peer list of 10.0.0.<i>:6881 for each i in @p hosts
+ */
+static std::string
+makeBody(std::initializer_list<uint8_t> hosts)
+{
+  std::string peers;
+  for (uint8_t host : hosts) {
+    const char entry[] = {10, 0, 0, static_cast<char>(host), 0x1a, static_cast<char>(0xe1)};
+    peers.append(entry, sizeof(entry));
+  }
+  return "d8:intervali60e5:peers" + std::to_string(peers.size()) + ":" + peers + "e";
+}
+
+BOOST_AUTO_TEST_CASE(FailoverAndMerge)
+{
+  LocalTracker a(1, 1, [] (int) { return makeBody({1, 2}); });
+  LocalTracker b(1, 1, [] (int) { return makeBody({2, 3}); });
+  LocalUdpTracker c; // knows 10.0.0.1 and 10.0.0.2
+  const std::string dead = "http://127.0.0.1:1/announce"; // connection refused
+
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+
+  std::vector<std::string> peers;
+  std::vector<PeerEndpoint> endpointsSeen;
+  size_t nRequests = 0;
+  TrackerSet trackers(loop, resolver, {{dead, a.getUrl()}, {b.getUrl()}, {c.getUrl()}},
+    [&] (const TrackerSet::Tracker& tracker) {
+      BOOST_CHECK_EQUAL(tracker.isStarted, false);
+      nRequests++;
+
+      AnnounceRequest request;
+      request.infoHash = make_shared<Buffer>(20);
+      request.peerId = "-CC0001-123456789012";
+      request.port = 6881;
+      request.uploaded = request.downloaded = request.left = 0;
+      request.event = AnnounceRequest::EVENT_STARTED;
+      return request;
+    },
+    [&] (const std::vector<PeerEndpoint>& endpoints) {
+      for (const auto& endpoint : endpoints) {
+        peers.push_back(endpoint.getIp());
+        endpointsSeen.push_back(endpoint);
+      }
+    });
+
+  BOOST_REQUIRE_EQUAL(trackers.getTierCount(), 3);
+  BOOST_CHECK_EQUAL(trackers.getTier(0).size(), 2);
+
+  // run until every tier got an answer
+  util::TimerWheel::Callback check = [&] {
+    for (size_t i = 0; i < trackers.getTierCount(); i++) {
+      if (!trackers.getTier(i).front()->isStarted) {
+        loop.schedule(10, check);
+        return;
+      }
+    }
+    loop.stop();
+  };
+  loop.schedule(10, check);
+  loop.schedule(5000, [&] { loop.stop(); });
+
+  trackers.start();
+  loop.run();
+
+  // each peer is reported once even though several trackers know it
+  std::sort(peers.begin(), peers.end());
+  BOOST_REQUIRE_EQUAL(peers.size(), 3);
+  BOOST_CHECK_EQUAL(peers[0], "10.0.0.1");
+  BOOST_CHECK_EQUAL(peers[1], "10.0.0.2");
+  BOOST_CHECK_EQUAL(peers[2], "10.0.0.3");
+  BOOST_CHECK_EQUAL(trackers.getPeerCount(), 3);
+
+  // a peer whose connection is gone is reported again
+  trackers.forget(endpointsSeen[0]);
+  BOOST_CHECK_EQUAL(trackers.getPeerCount(), 2);
+
+  // the tracker that answered leads its tier from now on
+  BOOST_CHECK_EQUAL(trackers.getTier(0).front()->url, a.getUrl());
+  BOOST_CHECK_EQUAL(trackers.getTier(0).front()->isStarted, true);
+  BOOST_CHECK(trackers.getTier(2).front()->udp);
+  BOOST_CHECK_GE(nRequests, 3);
+  BOOST_CHECK_LE(nRequests, 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
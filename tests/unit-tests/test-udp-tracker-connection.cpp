@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (C) 2015 by Codifica
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ */
+
+#include "udp-tracker-connection.hpp"
+
+#include "boost-test.hpp"
+#include "local-tracker.hpp"
+
+namespace sbt {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(TestUdpTrackerConnection)
+
+static AnnounceRequest
+makeRequest(uint8_t firstByte = 0x01)
+{
+  AnnounceRequest request;
+  auto infoHash = make_shared<Buffer>(20);
+  (*infoHash)[0] = firstByte;
+  request.infoHash = infoHash;
+  request.peerId = "-CC0001-123456789012";
+  request.port = 6881;
+  request.uploaded = 0;
+  request.downloaded = 0;
+  request.left = 100;
+  request.event = AnnounceRequest::EVENT_STARTED;
+  return request;
+}
+
+/**
+ * Runs one announce to completion on @p loop and returns its rc.
+ */
+static int
+announce(util::EventLoop& loop, UdpTrackerConnection& connection, const AnnounceRequest& request,
+         UdpTrackerConnection::AnnounceResponse& response)
+{
+  int result = 1;
+  connection.announce(request, [&] (int rc, const UdpTrackerConnection::AnnounceResponse& r) {
+    result = rc;
+    response = r;
+    loop.stop();
+  });
+
+  loop.run();
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE(Announce)
+{
+  LocalUdpTracker tracker;
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  UdpTrackerConnection connection(loop, resolver, "127.0.0.1", tracker.getPort());
+
+  for (int i = 0; i < 2; i++) {
+    UdpTrackerConnection::AnnounceResponse response;
+    BOOST_REQUIRE_EQUAL(announce(loop, connection, makeRequest(), response), 0);
+    BOOST_CHECK_EQUAL(response.interval, 1800);
+    BOOST_CHECK_EQUAL(response.leechers, 1);
+    BOOST_CHECK_EQUAL(response.seeders, 2);
+    BOOST_REQUIRE_EQUAL(response.peers.size(), 2);
+    BOOST_CHECK_EQUAL(response.peers[0].getIp(), "10.0.0.1");
+    BOOST_CHECK_EQUAL(response.peers[1].getIp(), "10.0.0.2");
+    BOOST_CHECK_EQUAL(response.peers[1].getPort(), 6881);
+  }
+
+  // the second announce reused the cached connection ID
+  BOOST_CHECK_EQUAL(connection.getConnectCount(), 1);
+  BOOST_CHECK_EQUAL(tracker.getConnectCount(), 1);
+  BOOST_CHECK_EQUAL(connection.getRetransmitCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Retransmit)
+{
+  // the connect request and its first retransmission are lost
+  LocalUdpTracker tracker(2);
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  UdpTrackerConnection connection(loop, resolver, "127.0.0.1", tracker.getPort(), 50);
+
+  UdpTrackerConnection::AnnounceResponse response;
+  BOOST_REQUIRE_EQUAL(announce(loop, connection, makeRequest(), response), 0);
+  BOOST_CHECK_EQUAL(response.peers.size(), 2);
+  BOOST_CHECK_EQUAL(connection.getRetransmitCount(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(Error)
+{
+  LocalUdpTracker tracker;
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  UdpTrackerConnection connection(loop, resolver, "127.0.0.1", tracker.getPort());
+
+  UdpTrackerConnection::AnnounceResponse response;
+  BOOST_CHECK_EQUAL(announce(loop, connection, makeRequest(0xff), response),
+                    RC_TRACKER_RESPONSE_FAILED);
+  BOOST_CHECK_EQUAL(connection.getError(), "unknown torrent");
+}
+
+BOOST_AUTO_TEST_CASE(Scrape)
+{
+  LocalUdpTracker tracker;
+  util::EventLoop loop;
+  util::Resolver resolver(loop);
+  UdpTrackerConnection connection(loop, resolver, "127.0.0.1", tracker.getPort());
+
+  std::vector<ConstBufferPtr> infoHashes(3, make_shared<Buffer>(20));
+  std::vector<UdpTrackerConnection::ScrapeEntry> entries;
+  int result = 1;
+  connection.scrape(infoHashes, [&] (int rc, const std::vector<UdpTrackerConnection::ScrapeEntry>& e) {
+    result = rc;
+    entries = e;
+    loop.stop();
+  });
+  loop.run();
+
+  BOOST_REQUIRE_EQUAL(result, 0);
+  BOOST_REQUIRE_EQUAL(entries.size(), 3);
+  BOOST_CHECK_EQUAL(entries[0].seeders, 1);
+  BOOST_CHECK_EQUAL(entries[2].seeders, 3);
+  BOOST_CHECK_EQUAL(entries[2].completed, 30);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace sbt
@@ -59,6 +59,52 @@ BOOST_AUTO_TEST_CASE(Basic)
                                   input4, input4 + sizeof(input4));
 }
 
+BOOST_AUTO_TEST_CASE(LongRuns)
+{
+  // long enough for the 16-byte blocks, with escapes at and across their edges
+  std::string plain = "abcdefghijklmnopqrstuvwxyz-._~ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  std::vector<uint8_t> input(plain.begin(), plain.end());
+  input[15] = 0x00;
+  input[16] = 0xFF;
+  input[40] = '/';
+  input.push_back(0x80);
+
+  std::string expected;
+  for (uint8_t c : input) {
+    if (isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~')
+      expected += static_cast<char>(c);
+    else {
+      char escaped[4];
+      snprintf(escaped, sizeof(escaped), "%%%02X", c);
+      expected += escaped;
+    }
+  }
+
+  std::vector<char> encoded(3 * input.size());
+  char* end = url::encodeTo(input.data(), input.size(), encoded.data());
+  BOOST_CHECK_EQUAL(std::string(encoded.data(), end), expected);
+  BOOST_CHECK_EQUAL(url::encode(input.data(), input.size()), expected);
+
+  std::vector<uint8_t> decoded(expected.size());
+  uint8_t* decodedEnd = url::decodeTo(expected.data(), expected.size(), decoded.data());
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(decoded.data(), decodedEnd, input.begin(), input.end());
+}
+
+BOOST_AUTO_TEST_CASE(DecodeEdges)
+{
+  uint8_t expected1[] = {0xAB, 0xCD};
+  auto output1 = url::decode("%ab%Cd");
+  BOOST_CHECK_EQUAL_COLLECTIONS(output1->begin(), output1->end(),
+                                expected1, expected1 + sizeof(expected1));
+
+  // a truncated escape is kept as is
+  std::string input2 = "0123456789abcdef%4";
+  auto output2 = url::decode(input2);
+  BOOST_CHECK_EQUAL_COLLECTIONS(output2->begin(), output2->end(), input2.begin(), input2.end());
+
+  BOOST_CHECK_EQUAL(url::decode("")->size(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace test